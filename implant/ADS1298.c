@@ -9,12 +9,189 @@
 /*****************************************************************************/
 #include "CommADS1298.h"
 #include "ADS1298.h"			
+#include "Frame.h"
+
+/*****************************************************************************/
+/* DEFINITIONS  															 */
+/*****************************************************************************/
+#define ADS1298_MAX_FRAMES		4	// number of frames the acquisition queue can hold
+#define ADS1298_MAX_SKEW		((100u * CLOCK_TCY_PER_US) / 8)	// polls of DRDY2 (about 8 TCY each) in 100 us, before device 2 is read anyway
+
+/* The frame tick of Frame.h must match the Timer1 setup of CommADS1298.c (a 
+ * CLOCK_PLL change needs FRAME_TICK_NS changed in both Frame.h, see Clock.h) */
+typedef char ADS1298_TICK_MATCHES_FRAME[(CLOCK_TICK_NS == FRAME_TICK_NS) ? 1 : -1];
 
 /*****************************************************************************/
 /* CONSTANTS    															 */
 /*****************************************************************************/
 static unsigned char frameSize1;
 static unsigned char frameSize2;
+static unsigned char readMode = ADS1298_READMODE_MULTIPLE;
+static unsigned char channelMap[2];					// enabled channels of each device (bit 7 = channel 1)
+static unsigned char packCount;						// number of enabled channels
+static unsigned char packSource[FRAME_MAX_CHANNELS];	// offset of each enabled channel in the raw frame
+static unsigned char sampleFormat = FRAME_FORMAT_WIDTH_24;	// width and shift of the packed samples
+static unsigned char frameFlags;							// flags of the frame being packed
+static unsigned char pendingFlags;							// flags carried over to the next frame
+static unsigned char frameSequence[2];						// sequence number of the frame being packed (MSB first)
+static unsigned char frameTick[2];							// tick at DRDY of the frame being packed (MSB first)
+
+/* Latches the tick of the DRDY that was just seen (reading TMR1L latches TMR1H) */
+#define ADS1298_LATCH_TICK()	{ frameTick[1] = ADS1298_TICK_LOW; \
+								  frameTick[0] = ADS1298_TICK_HIGH; }
+
+/* Register values of both devices after a reset (ID is read-only) */
+static rom const unsigned char REGISTER_DEFAULTS[ADS1298_NUM_REGISTERS] = {
+	0x92, 0x06, 0x40, 0x40, 0x00,			// ID, CONFIG1, CONFIG2, CONFIG3, LOFF
+	0x00, 0x00, 0x00, 0x00,					// CH1SET to CH4SET
+	0x00, 0x00, 0x00, 0x00,					// CH5SET to CH8SET
+	0x00, 0x00, 0x00, 0x00, 0x00,			// RLD_SENSP, RLD_SENSN, LOFF_SENSP, LOFF_SENSN, LOFF_FLIP
+	0x00, 0x00,								// LOFF_STATP, LOFF_STATN
+	0x0F, 0x00, 0x00, 0x00, 0x00, 0x00		// GPIO, PACE, RESP, CONFIG4, WCT1, WCT2
+};
+
+/* Acquisition profiles, CONFIG1 through WCT2 in register order */
+static rom const unsigned char PROFILES[ADS1298_NUM_PROFILES][ADS1298_PROFILE_SIZE] = {
+	
+	/* ADS1298_PROFILE_TEST: internal test signal at 2 kSPS (HR mode) on every channel */
+	{
+	/* CONFIG1    */ ADS1298_CONFIG1_HR | ADS1298_CONFIG1_DR_2K,
+	/* CONFIG2    */ ADS1298_CONFIG2_WCTCHOPCONST | ADS1298_CONFIG2_INTTEST | ADS1298_CONFIG2_TESTAMP | ADS1298_CONFIG2_TESTFREQ_AC20,
+	/* CONFIG3    */ ADS1298_CONFIG3_INTREFEN | (0b1u << 6),
+	/* LOFF       */ 0x00,
+	/* CH1SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH2SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH3SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH4SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH5SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH6SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH7SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH8SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* RLD_SENSP  */ 0x00,
+	/* RLD_SENSN  */ 0x00,
+	/* LOFF_SENSP */ 0x00,
+	/* LOFF_SENSN */ 0x00,
+	/* LOFF_FLIP  */ 0x00,
+	/* LOFF_STATP */ 0x00,
+	/* LOFF_STATN */ 0x00,
+	/* GPIO       */ 0x00,
+	/* PACE       */ 0x00,
+	/* RESP       */ 0x00,
+	/* CONFIG4    */ 0x00,
+	/* WCT1       */ 0x00,
+	/* WCT2       */ 0x00
+	},
+	
+	/* ADS1298_PROFILE_SURVEY: electrodes at 500 SPS (HR mode), gain 6 */
+	{
+	/* CONFIG1    */ ADS1298_CONFIG1_HR | ADS1298_CONFIG1_DR_500,
+	/* CONFIG2    */ 0x00,
+	/* CONFIG3    */ ADS1298_CONFIG3_INTREFEN | (0b1u << 6),
+	/* LOFF       */ 0x00,
+	/* CH1SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH2SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH3SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH4SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH5SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH6SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH7SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* CH8SET     */ ADS1298_CHSET_GAIN_6 | ADS1298_CHSET_MUX_ELEC,
+	/* RLD_SENSP  */ 0x00,
+	/* RLD_SENSN  */ 0x00,
+	/* LOFF_SENSP */ 0x00,
+	/* LOFF_SENSN */ 0x00,
+	/* LOFF_FLIP  */ 0x00,
+	/* LOFF_STATP */ 0x00,
+	/* LOFF_STATN */ 0x00,
+	/* GPIO       */ 0x00,
+	/* PACE       */ 0x00,
+	/* RESP       */ 0x00,
+	/* CONFIG4    */ 0x00,
+	/* WCT1       */ 0x00,
+	/* WCT2       */ 0x00
+	},
+	
+	/* ADS1298_PROFILE_PVMAPPING: electrodes at 2 kSPS (HR mode), gain 12 */
+	{
+	/* CONFIG1    */ ADS1298_CONFIG1_HR | ADS1298_CONFIG1_DR_2K,
+	/* CONFIG2    */ 0x00,
+	/* CONFIG3    */ ADS1298_CONFIG3_INTREFEN | (0b1u << 6),
+	/* LOFF       */ 0x00,
+	/* CH1SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH2SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH3SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH4SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH5SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH6SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH7SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* CH8SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_ELEC,
+	/* RLD_SENSP  */ 0x00,
+	/* RLD_SENSN  */ 0x00,
+	/* LOFF_SENSP */ 0x00,
+	/* LOFF_SENSN */ 0x00,
+	/* LOFF_FLIP  */ 0x00,
+	/* LOFF_STATP */ 0x00,
+	/* LOFF_STATN */ 0x00,
+	/* GPIO       */ 0x00,
+	/* PACE       */ 0x00,
+	/* RESP       */ 0x00,
+	/* CONFIG4    */ 0x00,
+	/* WCT1       */ 0x00,
+	/* WCT2       */ 0x00
+	},
+	
+	/* ADS1298_PROFILE_SELFTEST: offset, test signal, temperature and supply at 500 SPS (LP mode) */
+	{
+	/* CONFIG1    */ ADS1298_CONFIG1_DR_1K,
+	/* CONFIG2    */ ADS1298_CONFIG2_INTTEST | ADS1298_CONFIG2_TESTFREQ_AC21,
+	/* CONFIG3    */ ADS1298_CONFIG3_INTREFEN | (0b1u << 6),
+	/* LOFF       */ 0x00,
+	/* CH1SET     */ ADS1298_CHSET_GAIN_1 | ADS1298_CHSET_MUX_SHORT,
+	/* CH2SET     */ ADS1298_CHSET_GAIN_1 | ADS1298_CHSET_MUX_TEST,
+	/* CH3SET     */ ADS1298_CHSET_GAIN_1 | ADS1298_CHSET_MUX_TEMP,
+	/* CH4SET     */ ADS1298_CHSET_GAIN_1 | ADS1298_CHSET_MUX_MVDD,
+	/* CH5SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_SHORT,
+	/* CH6SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* CH7SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_SHORT,
+	/* CH8SET     */ ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST,
+	/* RLD_SENSP  */ 0x00,
+	/* RLD_SENSN  */ 0x00,
+	/* LOFF_SENSP */ 0x00,
+	/* LOFF_SENSN */ 0x00,
+	/* LOFF_FLIP  */ 0x00,
+	/* LOFF_STATP */ 0x00,
+	/* LOFF_STATN */ 0x00,
+	/* GPIO       */ 0x00,
+	/* PACE       */ 0x00,
+	/* RESP       */ 0x00,
+	/* CONFIG4    */ 0x00,
+	/* WCT1       */ 0x00,
+	/* WCT2       */ 0x00
+	}
+};
+
+/*****************************************************************************/
+/* VARIABLES    															 */
+/*****************************************************************************/
+static unsigned char FRAME_QUEUE[ADS1298_MAX_FRAMES][ADS1298_MAX_FRAME_SIZE];
+static unsigned char FRAME_LENGTH[ADS1298_MAX_FRAMES];
+static volatile unsigned char FRAME_HEAD, FRAME_TAIL; // head is written by the ISR only, tail by the consumer (see FRAME_CLAIMED)
+static volatile unsigned char FRAME_CLAIMED;           // the consumer holds the tail slot (ADS1298_PeekFrame to ADS1298_ReleaseFrame)
+static volatile unsigned char FRAME_OVERRUNS;          // DRDY events that found the queue full
+static unsigned char overflowPolicy = FRAME_POLICY_DROP_NEWEST; // FRAME_POLICY_* applied to a full queue
+static FrameDrops FRAME_DROPS;                         // frames and bytes dropped under the overflow policy
+static unsigned char DECIMATION = 1;                   // backpressure: 1 of every DECIMATION conversions is read
+static unsigned char decimateCount;                    // conversions left to skip before the next read
+static unsigned char DRDY_SKEWS;                       // frames where DRDY2 had not fallen together with DRDY1
+static unsigned char DRDY_MAX_SKEW;                    // longest DRDY2 lag seen, in polls of the DRDY2 pin
+static unsigned char RESYNCS;                          // frames dropped because a status word was misaligned
+static unsigned int SEQUENCE;                          // DRDY count, sequence number of the next frame
+static volatile unsigned char DEADLINE_MISSES;         // DRDY events that found the last conversion not read yet
+static volatile unsigned char pendingMisses;           // conversions overwritten before their read started
+static volatile unsigned char frameReading;            // the read interrupt is shifting a frame in over SPI
+static volatile unsigned char frameOverwritten;        // a DRDY came while the frame was being read
+static unsigned char REGISTERS[2][ADS1298_NUM_REGISTERS]; // shadow of the registers of both devices
+static unsigned char profile = ADS1298_PROFILE_TEST;      // profile applied last
 
 /*****************************************************************************/
 /* FUNCTIONS																 */
@@ -32,7 +209,8 @@ void ADS1298_WriteSingleOpCode(unsigned char writeVal) {
 }
 
 /***************************************************************************//**
- * @brief	Writes data to the registers of the ADS1298. 
+ * @brief	Writes data to the registers of the ADS1298 and keeps the register
+ *          shadow up to date. 
  * 
  * @param 	address - Char denoting the initial address to write to.
  * @param 	writeNum - Char denoting the number of registers to write.
@@ -45,6 +223,19 @@ void ADS1298_WriteRegisters(unsigned char device,
 							unsigned char writeNum, 
 							unsigned char* regVals) {
 	unsigned char writeOpCode[2] = {0, 0};
+	unsigned char i;
+	
+	/* Daisy-chain mode: both devices sit on CS1 and take every write (see 
+	 * ADS1298_READMODE_DAISY), so both shadows follow it */
+	if ((readMode == ADS1298_READMODE_DAISY) && (device == 2)) { device = 1; }
+	
+	/* Update the register shadow */
+	if ((device == 1) || (device == 2)) {
+		for (i = 0; (i < writeNum) && ((address + i) < ADS1298_NUM_REGISTERS); i = i + 1) {
+			REGISTERS[device - 1][address + i] = regVals[i];
+			if (readMode == ADS1298_READMODE_DAISY) { REGISTERS[1][address + i] = regVals[i]; }
+		}
+	}
 	
 	/* Define the opcode */
 	writeOpCode[0] = ADS1298_WREG + address;
@@ -79,6 +270,10 @@ void ADS1298_ReadRegisters(unsigned char device,
 						   unsigned char* regVals) {
 	unsigned char readOpCode[2] = {0, 0};
 	
+	/* Daisy-chain mode: DOUT of device 2 only reaches DAISY_IN of device 1, 
+	 * so its registers are read from device 1, which takes the same writes */
+	if ((readMode == ADS1298_READMODE_DAISY) && (device == 2)) { device = 1; }
+	
 	/* Define the opcode */
 	readOpCode[0] = (unsigned char) ADS1298_RREG + address;
 	readOpCode[1] = readNum - 1;
@@ -97,6 +292,87 @@ void ADS1298_ReadRegisters(unsigned char device,
 	}
 }
 
+/***************************************************************************//**
+ * @brief	Gets the value of a register from the register shadow. No SPI
+ *          traffic is generated.
+ * 
+ * @param	device - Device (1 or 2) to get the register from.
+ * @param	address - Address of the register.
+ * 
+ * @return	Last value written to the register.
+*******************************************************************************/
+unsigned char ADS1298_GetRegister(unsigned char device,
+								  unsigned char address) {
+	return REGISTERS[device - 1][address];
+}
+
+/***************************************************************************//**
+ * @brief	Loads the reset values of every register into the register shadow
+ *          of both devices. Called after the device has been reset.
+ * 
+ * @param	None.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_ResetShadow() {
+	unsigned char i;
+	
+	for (i = 0; i < ADS1298_NUM_REGISTERS; i = i + 1) {
+		REGISTERS[0][i] = REGISTER_DEFAULTS[i];
+		REGISTERS[1][i] = REGISTER_DEFAULTS[i];
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Reads every register of a device over the bus and compares it with
+ *          the register shadow. The lead-off status registers and the GPIO
+ *          data bits change on their own and are not compared. Must not be
+ *          called while reading data continuously (RDATAC).
+ * 
+ * @param	device - Device (1 or 2) to verify.
+ * 
+ * @return	1 - registers match the shadow, 0 - mismatch.
+*******************************************************************************/
+unsigned char ADS1298_VerifyRegisters(unsigned char device) {
+	unsigned char regVals[ADS1298_NUM_REGISTERS];
+	unsigned char i;
+	
+	/* Read all the registers */
+	ADS1298_ReadRegisters(device, ADS1298_ID, ADS1298_NUM_REGISTERS, regVals);
+	
+	/* The ID register is only known after the first read */
+	REGISTERS[device - 1][ADS1298_ID] = regVals[ADS1298_ID];
+	
+	/* Compare the registers that only change when they are written */
+	for (i = ADS1298_CONFIG1; i < ADS1298_NUM_REGISTERS; i = i + 1) {
+		if ((i == ADS1298_LOFFSTATP) || (i == ADS1298_LOFFSTATN)) { continue; }
+		if (i == ADS1298_GPIO) {
+			if ((regVals[i] ^ REGISTERS[device - 1][i]) & ~ADS1298_GPIO_DATA) { return 0; }
+			continue;
+		}
+		if (regVals[i] != REGISTERS[device - 1][i]) { return 0; }
+	}
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Reads the lead-off status registers of a device over the bus. These
+ *          are the only registers that are not served from the shadow. Must 
+ *          not be called while reading data continuously (RDATAC).
+ * 
+ * @param	device - Device (1 or 2) to read.
+ * @param	pStatus - Pointer to 2 chars storing LOFF_STATP and LOFF_STATN.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_ReadLeadOffStatus(unsigned char device,
+							   unsigned char* pStatus) {
+	ADS1298_ReadRegisters(device, ADS1298_LOFFSTATP, 2, pStatus);
+	REGISTERS[device - 1][ADS1298_LOFFSTATP] = pStatus[0];
+	REGISTERS[device - 1][ADS1298_LOFFSTATN] = pStatus[1];
+}
+
 /***************************************************************************//**
  * @brief	Goes through the power-up sequencing of the device. Before device
  *          power up, all digital and analog inputs must be low. At the time of 
@@ -113,17 +389,15 @@ void ADS1298_ReadRegisters(unsigned char device,
  * @return	1 - power-up success, 0 - power-up failed.
 *******************************************************************************/
 unsigned char ADS1298_PowerUp() {
-	unsigned int i = 0;
-    
 	/* Bring the PWR pin HIGH to turn on the device */
 	ADS1298_PWR_PIN = 1;
-	for (i = 0; i < 50000; i++) {} 
+	CLOCK_DELAY_MS(ADS1298_POWERUP_MS);
 	
     /* Reset the device by toggling the RESET pin */
     ADS1298_RESET_PIN = 0;
-    for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_RESET_US); // wait at least 18 shift clock cycles
     ADS1298_RESET_PIN = 1;
-    for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_RESET_US); // wait at least 18 shift clock cycles
     
 	/* Reset the device by issuing the RESET opcode */
     CommADS1298_CS1_PIN = 0;
@@ -131,7 +405,10 @@ unsigned char ADS1298_PowerUp() {
     ADS1298_WriteSingleOpCode(ADS1298_RESET);
     CommADS1298_CS1_PIN = 1;
 	CommADS1298_CS2_PIN = 1;
-    for (i = 0; i < 500; i++) {} // wait at least 18 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_RESET_US); // wait at least 18 shift clock cycles
+    
+    /* The registers are back to their reset values */
+    ADS1298_ResetShadow();
     
     /* Stop the read data continuously mode (SDATAC) */
 	CommADS1298_CS1_PIN = 0;
@@ -139,11 +416,11 @@ unsigned char ADS1298_PowerUp() {
     ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
     CommADS1298_CS1_PIN = 1;
 	CommADS1298_CS2_PIN = 1;
-    for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_DECODE_US); // wait at least 4 shift clock cycles
     
     /* Stop the data conversion (STOP) */
     ADS1298_START_PIN = 0;
-    for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_DECODE_US); // wait at least 4 shift clock cycles
     
 	return 1;
 }
@@ -156,30 +433,31 @@ unsigned char ADS1298_PowerUp() {
  * @return	1 - power-up success, 0 - power-up failed
 *******************************************************************************/
 unsigned char ADS1298_PowerDown() {
-    unsigned char i;
-    
 	/* Stop the read data continuously mode (SDATAC) */
 	CommADS1298_CS1_PIN = 0;
     CommADS1298_CS2_PIN = 0;
     ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
     CommADS1298_CS1_PIN = 1;
 	CommADS1298_CS2_PIN = 1;
-    for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_DECODE_US); // wait at least 4 shift clock cycles
 	
 	/* Stop the data conversion (STOP) */
 	ADS1298_START_PIN = 0;
-    for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_DECODE_US); // wait at least 4 shift clock cycles
 	
 	/* Bring the PWR pin LOW in order to turn off the device */
 	ADS1298_PWR_PIN = 0;
-	for (i = 0; i < 50000; i++) {} 
+	CLOCK_DELAY_MS(ADS1298_POWERUP_MS);
 	
 	return 1;
 }
 
 /***************************************************************************//**
  * @brief	Computes the size of a single frame of data in bytes for each 
- *          device. Every frame has a 24 bit status word. 
+ *          device as it is shifted out (every frame has a 24 bit status word),
+ *          and where each enabled channel sits in that raw frame so that it 
+ *          can be packed. The channel settings come from the register shadow, 
+ *          so no SPI reads are needed.
  * 
  * @param	None.
  * 
@@ -189,17 +467,17 @@ void ADS1298_ComputeFrameSize() {
 	unsigned char i;
     unsigned char numCh1 = 0; // number of channels active in device 1
 	unsigned char numCh2 = 0; // number of channels active in device 2
-    unsigned char chRegVals[16];
-    
-    /* Read the register values containing the channel settings */
-    ADS1298_ReadRegisters(1, ADS1298_CH1SET, 8, chRegVals);
-	ADS1298_ReadRegisters(2, ADS1298_CH1SET, 8, chRegVals + 8);
     
     /* Iterate through the channel values to see which ones are powered down */
-    for (i = 0; i < 16; i = i + 1) {
-        if ((chRegVals[i] & 0b10000000) == 0x00) { // if not powered down, increment
-			if ((i >= 0) && (i < 8))  { numCh1 = i + 1; } 
-			if ((i >= 8) && (i < 16)) { numCh2 = i - 7; }
+    channelMap[0] = channelMap[1] = 0;
+    for (i = 0; i < 8; i = i + 1) {
+        if ((REGISTERS[0][ADS1298_CH1SET + i] & ADS1298_CHSET_PD) == 0x00) { // if not powered down, increment
+            numCh1 = i + 1;
+            channelMap[0] |= (0x80 >> i);
+        }
+        if ((REGISTERS[1][ADS1298_CH1SET + i] & ADS1298_CHSET_PD) == 0x00) {
+            numCh2 = i + 1;
+            channelMap[1] |= (0x80 >> i);
         }
     }
     
@@ -208,10 +486,23 @@ void ADS1298_ComputeFrameSize() {
 	else { frameSize1 = 0; } // if there are no channels active, set frame size to 0
 	if (numCh2 > 0) { frameSize2 = (numCh2 * 3) + 3; }
 	else { frameSize2 = 0; }
+	
+	/* In daisy-chain mode device 2 is shifted out behind all 8 channels of device 1 */
+	if ((readMode == ADS1298_READMODE_DAISY) && (frameSize2 != 0)) { frameSize1 = 27; }
+	
+	/* Locate the enabled channels in the raw frame (after each status word) */
+	packCount = 0;
+	for (i = 0; i < 8; i = i + 1) {
+		if (channelMap[0] & (0x80 >> i)) { packSource[packCount++] = ADS1298_RAW_OFFSET + 3 + (3 * i); }
+	}
+	for (i = 0; i < 8; i = i + 1) {
+		if (channelMap[1] & (0x80 >> i)) { packSource[packCount++] = ADS1298_RAW_OFFSET + frameSize1 + 3 + (3 * i); }
+	}
 }
 
 /***************************************************************************//**
- * @brief	Turns the specified channels on and off.
+ * @brief	Turns the specified channels on and off. Channels that are turned
+ *          on get the gain and input of the current profile.
  * 
  * @param	Pointer to 2 character array storing information on which channels
  *          to turn on and turn off.
@@ -220,16 +511,22 @@ void ADS1298_ComputeFrameSize() {
 *******************************************************************************/
 void ADS1298_SetChannels(unsigned char* channels) {
     unsigned char writeVals[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-	unsigned char i, j;
+	unsigned char i, j, mask;
+	unsigned char devices = 2;
+	
+	/* Daisy-chain mode: one write on the shared CS sets both devices, so a 
+	 * channel turned on in either device is turned on in both */
+	if (readMode == ADS1298_READMODE_DAISY) { devices = 1; }
 	
 	/* Iterate through the 2 devices */
-	for (i = 0; i < 2; i = i + 1) {
+	for (i = 0; i < devices; i = i + 1) {
+		mask = (devices == 1) ? (channels[0] | channels[1]) : channels[i];
 		
 		/* Iterate through the 8 channels of one device */
 		for (j = 0; j < 8; j = j + 1) {
 			/* Define the register values for the channel settings */
-			if (((channels[i] >> (7 - j)) & 0x01) == 0x01) { // turn channel on
-				writeVals[j] = ADS1298_CHSET_GAIN_12 | ADS1298_CHSET_MUX_TEST;
+			if (((mask >> (7 - j)) & 0x01) == 0x01) { // turn channel on
+				writeVals[j] = PROFILES[profile][ADS1298_CH1SET - ADS1298_CONFIG1 + j];
 			} else { // turn channel off
 				writeVals[j] = ADS1298_CHSET_PD | ADS1298_CHSET_MUX_SHORT;
 			}
@@ -243,6 +540,58 @@ void ADS1298_SetChannels(unsigned char* channels) {
 	ADS1298_ComputeFrameSize();
 }
 
+/***************************************************************************//**
+ * @brief	Applies an acquisition profile to both devices. Every register from 
+ *          CONFIG1 to WCT2 is written with a single burst WREG per device. 
+ *          Must not be called while reading data continuously (RDATAC).
+ * 
+ * @param	newProfile - One of the ADS1298_PROFILE_* values.
+ * @param	channels - Pointer to 2 character array storing information on 
+ *                     which channels to turn on and turn off.
+ * 
+ * @return	1 - profile applied, 0 - unknown profile.
+*******************************************************************************/
+unsigned char ADS1298_ApplyProfile(unsigned char newProfile,
+								   unsigned char* channels) {
+	unsigned char writeVals[ADS1298_PROFILE_SIZE];
+	unsigned char i, j, mask;
+	unsigned char devices = 2;
+	
+	/* Check the profile */
+	if (newProfile >= ADS1298_NUM_PROFILES) { return 0; }
+	profile = newProfile;
+	
+	/* Daisy-chain mode: one burst on the shared CS sets both devices (see 
+	 * ADS1298_SetChannels) */
+	if (readMode == ADS1298_READMODE_DAISY) { devices = 1; }
+	
+	/* Iterate through the 2 devices */
+	for (i = 0; i < devices; i = i + 1) {
+		mask = (devices == 1) ? (channels[0] | channels[1]) : channels[i];
+		
+		/* Copy the profile out of program memory */
+		for (j = 0; j < ADS1298_PROFILE_SIZE; j = j + 1) { writeVals[j] = PROFILES[profile][j]; }
+		
+		/* Select the readback mode */
+		if (readMode == ADS1298_READMODE_MULTIPLE) { writeVals[0] |= ADS1298_CONFIG1_DAISYDIS; }
+		
+		/* Power down the channels that are turned off */
+		for (j = 0; j < 8; j = j + 1) {
+			if (((mask >> (7 - j)) & 0x01) == 0x00) {
+				writeVals[ADS1298_CH1SET - ADS1298_CONFIG1 + j] = ADS1298_CHSET_PD | ADS1298_CHSET_MUX_SHORT;
+			}
+		}
+		
+		/* Send the register values in one burst */
+		ADS1298_WriteRegisters(i + 1, ADS1298_CONFIG1, ADS1298_PROFILE_SIZE, writeVals);
+	}
+	
+	/* Compute the new frame size */
+	ADS1298_ComputeFrameSize();
+	
+	return 1;
+}
+
 /***************************************************************************//**
  * @brief	Starts continuous data conversions.
  * 
@@ -276,47 +625,760 @@ void ADS1298_StopConversion() {
 }
 
 /***************************************************************************//**
- * @brief	Reads a single frame of data from the implant.
+ * @brief	Reads a single frame of data from both devices into one raw frame 
+ *          (the status word and channels of device 1 followed by the status 
+ *          word and channels of device 2) and packs it into the link frame 
+ *          format of Frame.h. The buffer must hold ADS1298_MAX_FRAME_SIZE 
+ *          bytes. The caller must already know that DRDY_NOT is low (this is 
+ *          called from the frame read interrupt raised by the DRDY interrupt 
+ *          of device 1), so no polling is done for device 1.
+ *          
+ *          Multiple readback mode: each device is read under its own CS. 
+ *          Device 2 runs from its own clock, so if its DRDY has not fallen 
+ *          yet the skew is recorded and it is waited for.
+ *          
+ *          Daisy-chain mode: DOUT of device 2 feeds DAISY_IN of device 1 and
+ *          both devices sit on CS1 (see ADS1298_READMODE_DAISY), so the frame
+ *          of device 1 and then the frame of device 2 are shifted out in one
+ *          transfer of up to 54 bytes under one CS assertion.
+ *          
+ *          The frame is stamped with the sequence number first thing. The 
+ *          tick was already latched by the caller when DRDY was seen (see 
+ *          ADS1298_LATCH_TICK), so the tick jitter is the DRDY interrupt 
+ *          latency only, however late the read itself starts. The status 
+ *          words are checked before packing. A misaligned status word drops 
+ *          the frame and resynchronises the SPI. The SSP1 interrupt is masked 
+ *          while CommADS1298_ReadFrame runs.
  * 
  * @param	pDataBuffer - Pointer to the array storing the streamed data.
  * 
+ * @return	Size of the packed frame, 0 if the frame was dropped.
+*******************************************************************************/
+unsigned char ADS1298_ReadFrame(unsigned char* pDataBuffer) {
+	unsigned char* pRawFrame = pDataBuffer;
+	unsigned char skew = 0;
+	unsigned char skewed = 0;
+	
+	/* Stamp the frame */
+	frameSequence[0] = SEQUENCE >> 8;
+	frameSequence[1] = SEQUENCE;
+	SEQUENCE = SEQUENCE + 1;
+	
+	/* Let queued register transfers finish before taking the bus, and mask 
+	 * the SSP1 interrupt: the reader polls BF, and an SSP1 interrupt for every
+	 * byte would cost about 50 TCY each at high priority */
+	CommADS1298_Wait();
+	CommADS1298_INTERRUPT_ENABLE = 0;
+	
+	/* The raw frame is read behind the space needed by the frame header */
+	pDataBuffer = pDataBuffer + ADS1298_RAW_OFFSET;
+	
+	/* Daisy-chain mode: one CS assertion, one transfer of both frames */
+	if (readMode == ADS1298_READMODE_DAISY) {
+		if ((frameSize1 + frameSize2) != 0) {
+			CommADS1298_CS1_PIN = 0;
+			CommADS1298_ReadFrame(pDataBuffer, frameSize1 + frameSize2);
+			CommADS1298_CS1_PIN = 1;
+		}
+	
+	/* Multiple readback mode: one CS assertion and one transfer per device */
+	} else {
+		
+		/* Sample DRDY of device 2 at the time of the DRDY of device 1 */
+		skewed = ADS1298_DRDY2_NOT;
+		
+		/* If frame size for device 1 is 0, do not read from device 1 */
+		if (frameSize1 != 0) { // device 1
+
+			/* Bring the CS pin low */
+			CommADS1298_CS1_PIN = 0;
+
+			/* Read all the data in the frame (header included) */
+			CommADS1298_ReadFrame(pDataBuffer, frameSize1);
+
+			/* Bring the CS pin high */
+			CommADS1298_CS1_PIN = 1;
+			
+			/* Increment the address of pDataBuffer */
+			pDataBuffer = pDataBuffer + frameSize1;
+		}
+		
+		/* If frame size for device 2 is 0, do not read from device 2 */
+		if (frameSize2 != 0) { // device 2
+			
+			/* Wait a bounded time for a lagging DRDY on device 2 */
+			while (ADS1298_DRDY2_NOT && (skew < ADS1298_MAX_SKEW)) { skew = skew + 1; }
+			if (skewed) {
+				DRDY_SKEWS = DRDY_SKEWS + 1;
+				if (skew > DRDY_MAX_SKEW) { DRDY_MAX_SKEW = skew; }
+			}
+
+			/* Bring the CS pin low */
+			CommADS1298_CS2_PIN = 0;
+
+			/* Read all the data in the frame (header included) */
+			CommADS1298_ReadFrame(pDataBuffer, frameSize2);
+
+			/* Bring the CS pin high */
+			CommADS1298_CS2_PIN = 1;
+		}
+	}
+	
+	/* The reader leaves the SSP1 flag clear, so no stray interrupt follows */
+	CommADS1298_INTERRUPT_ENABLE = 1;
+	
+	/* The conversion is out of the device, so the next DRDY no longer 
+	 * overwrites it: the check and the packing below work on the slot only */
+	frameReading = 0;
+	
+	/* Check the status words, drop the frame and resynchronise if misaligned */
+	if (!ADS1298_CheckStatus(pRawFrame)) {
+		ADS1298_Resync();
+		return 0;
+	}
+	if (skewed && (frameSize2 != 0)) { frameFlags |= FRAME_FLAGS_SKEW; }
+	
+	return ADS1298_PackFrame(pRawFrame);
+}
+
+/***************************************************************************//**
+ * @brief	Decodes the 24 bit status word of each device in a raw frame:
+ *          1100 + LOFF_STATP + LOFF_STATN + GPIO[7:4]. The lead-off bits go 
+ *          into the register shadow and into the flags of the frame.
+ * 
+ * @param	pDataBuffer - Pointer to the raw frame (as passed to ReadFrame).
+ * 
+ * @return	1 - status words aligned, 0 - sync nibble missing (misaligned).
+*******************************************************************************/
+unsigned char ADS1298_CheckStatus(unsigned char* pDataBuffer) {
+	unsigned char* pStatus;
+	unsigned char device;
+	
+	frameFlags = pendingFlags;
+	
+	for (device = 0; device < 2; device = device + 1) {
+		
+		/* Locate the status word of the device */
+		if (device == 0) {
+			if (frameSize1 == 0) { continue; }
+			pStatus = pDataBuffer + ADS1298_RAW_OFFSET;
+		} else {
+			if (frameSize2 == 0) { continue; }
+			pStatus = pDataBuffer + ADS1298_RAW_OFFSET + frameSize1;
+		}
+		
+		/* Check the sync nibble */
+		if ((pStatus[0] & ADS1298_STATUS_SYNC) != ADS1298_STATUS_SYNC_OK) { return 0; }
+		
+		/* Decode the lead-off status */
+		REGISTERS[device][ADS1298_LOFFSTATP] = (pStatus[0] << 4) | (pStatus[1] >> 4);
+		REGISTERS[device][ADS1298_LOFFSTATN] = (pStatus[1] << 4) | (pStatus[2] >> 4);
+		if (REGISTERS[device][ADS1298_LOFFSTATP] | REGISTERS[device][ADS1298_LOFFSTATN]) {
+			frameFlags |= (device == 0) ? FRAME_FLAGS_LOFF1 : FRAME_FLAGS_LOFF2;
+		}
+		
+		/* Decode the GPIO bits of device 1 */
+		if (device == 0) { frameFlags |= pStatus[2] & FRAME_FLAGS_GPIO; }
+	}
+	
+	pendingFlags = 0;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief	Realigns the SPI after a misaligned status word: the MSSP is reset
+ *          to clear its shift register and the devices leave and re-enter the
+ *          read data continuous mode. The next frame carries the resync flag.
+ * 
+ * @param	None.
+ * 
  * @return	None.
 *******************************************************************************/
-void ADS1298_ReadFrame(unsigned char* pDataBuffer) {
-	/* Wait for the DRDY_NOT line to go low */
-	while (ADS1298_DRDY1_NOT || ADS1298_DRDY2_NOT);
+void ADS1298_Resync() {
+	/* Release both devices and reset the MSSP */
+	CommADS1298_CS1_PIN = 1;
+	CommADS1298_CS2_PIN = 1;
+	CommADS1298_ENABLE = 0;
+	CommADS1298_ENABLE = 1;
 	
-	/* If frame size for device 1 is 0, do not read from device 1 */
-	if (frameSize1 != 0) { // device 1
+	/* Restart the read data continuous mode */
+	ADS1298_StopConversion();
+	CLOCK_DELAY_US(ADS1298_DECODE_US); // wait at least 4 shift clock cycles
+	ADS1298_StartConversion();
+	
+	/* Report the dropped frames */
+	RESYNCS = RESYNCS + 1;
+	pendingFlags |= FRAME_FLAGS_RESYNC;
+}
 
-		/* Bring the CS pin low */
-		CommADS1298_CS1_PIN = 0;
+/***************************************************************************//**
+ * @brief	Gets the number of frames dropped because a status word was 
+ *          misaligned.
+ * 
+ * @param	None.
+ * 
+ * @return	Number of resynchronisations since ADS1298_StartAcquisition.
+*******************************************************************************/
+unsigned char ADS1298_GetResyncs() {
+	return RESYNCS;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the sequence number the next frame will carry. The sequence 
+ *          number counts every DRDY since ADS1298_StartAcquisition, including
+ *          the conversions dropped on an overrun or a resync.
+ * 
+ * @param	None.
+ * 
+ * @return	Sequence number of the next frame.
+*******************************************************************************/
+unsigned int ADS1298_GetSequence() {
+	unsigned char enable = ADS1298_READ_INT_ENABLE;
+	unsigned int sequence;
+	
+	/* The read ISR moves the sequence number, so hold it off while copying it */
+	ADS1298_READ_INT_ENABLE = 0;
+	sequence = SEQUENCE;
+	ADS1298_READ_INT_ENABLE = enable;
+	
+	return sequence;
+}
 
-		/* Read all the data in the frame */
-		CommADS1298_Read(pDataBuffer, 3); // read the header
-		CommADS1298_Read(pDataBuffer, frameSize1 - 3); // overwrite the header
+/***************************************************************************//**
+ * @brief	Gets the lead-off status decoded from the status word of the last
+ *          frame. No SPI traffic is generated.
+ * 
+ * @param	device - Device (1 or 2) to get the status of.
+ * @param	pStatus - Pointer to 2 chars storing LOFF_STATP and LOFF_STATN.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_GetLeadOff(unsigned char device,
+						unsigned char* pStatus) {
+	pStatus[0] = REGISTERS[device - 1][ADS1298_LOFFSTATP];
+	pStatus[1] = REGISTERS[device - 1][ADS1298_LOFFSTATN];
+}	
 
-		/* Increment the address of pDataBuffer */
-		pDataBuffer = pDataBuffer + (frameSize1 - 3);
+/***************************************************************************//**
+ * @brief	Packs a raw frame (status word and channels up to the highest 
+ *          enabled one, for each device) in place into the link frame format 
+ *          of Frame.h: the channel bitmaps and sample format followed by the 
+ *          samples of the enabled channels only, reduced to the width set with
+ *          ADS1298_SetResolution. Every sample moves towards the start of the
+ *          buffer, so the copy can be done in place.
+ * 
+ * @param	pDataBuffer - Pointer to the raw frame.
+ * 
+ * @return	Size of the packed frame.
+*******************************************************************************/
+unsigned char ADS1298_PackFrame(unsigned char* pDataBuffer) {
+	unsigned char* pDest = pDataBuffer + FRAME_HEADER_SIZE;
+	unsigned char* pSource;
+	unsigned int value;
+	unsigned char i;
+	
+	/* Move the enabled channels down */
+	for (i = 0; i < packCount; i = i + 1) {
+		pSource = pDataBuffer + packSource[i];
+		
+		/* Full resolution: copy the 3 bytes */
+		if ((sampleFormat & FRAME_FORMAT_WIDTH) == FRAME_FORMAT_WIDTH_24) {
+			pDest[0] = pSource[0];
+			pDest[1] = pSource[1];
+			pDest[2] = pSource[2];
+			pDest = pDest + FRAME_SAMPLE_SIZE;
+			continue;
+		}
+		
+		/* Reduced resolution: round, shift and saturate */
+		value = ADS1298_ReduceSample(pSource);
+		
+		if ((sampleFormat & FRAME_FORMAT_WIDTH) == FRAME_FORMAT_WIDTH_16) {
+			pDest[0] = value >> 8;
+			pDest[1] = value;
+			pDest = pDest + 2;
+		} else if ((i & 0x01) == 0) { // first 12 bit sample of a pair: byte 0 and the high nibble of byte 1
+			pDest[0] = value >> 4;
+			pDest[1] = value << 4;
+			pDest = pDest + 1;
+		} else { // second 12 bit sample of a pair: the low nibble of byte 1 and byte 2
+			pDest[0] |= (value >> 8) & 0x0F;
+			pDest[1] = value;
+			pDest = pDest + 2;
+		}
+	}
+	
+	/* Write the header over the first status word */
+	pDataBuffer[FRAME_CHANNELS1]    = channelMap[0];
+	pDataBuffer[FRAME_CHANNELS2]    = channelMap[1];
+	pDataBuffer[FRAME_FORMAT]       = sampleFormat;
+	pDataBuffer[FRAME_FLAGS]        = frameFlags;
+	pDataBuffer[FRAME_SEQUENCE]     = frameSequence[0];
+	pDataBuffer[FRAME_SEQUENCE + 1] = frameSequence[1];
+	pDataBuffer[FRAME_TICK]         = frameTick[0];
+	pDataBuffer[FRAME_TICK + 1]     = frameTick[1];
+	
+	return ADS1298_GetFrameSize();
+}
 
-		/* Bring the CS pin high */
-		CommADS1298_CS1_PIN = 1;
+/***************************************************************************//**
+ * @brief	Reduces a 24 bit sample to the width of the sample format. The 
+ *          sample is rounded to the nearest value, shifted right and then 
+ *          saturated to the range of the reduced width.
+ * 
+ * @param	pSample - Pointer to the 24 bit sample (MSB first).
+ * 
+ * @return	Reduced sample (two's complement in the low 16 or 12 bits).
+*******************************************************************************/
+unsigned int ADS1298_ReduceSample(unsigned char* pSample) {
+	unsigned char shift = sampleFormat & FRAME_FORMAT_SHIFT;
+	long sample, limit;
+	
+	/* Sign extend the 24 bit sample */
+	sample = ((long) (signed char) pSample[0] << 16) | ((unsigned int) pSample[1] << 8) | pSample[2];
+	
+	/* Round and shift */
+	if (shift != 0) { sample = (sample + (1L << (shift - 1))) >> shift; }
+	
+	/* Saturate to the reduced width */
+	limit = ((sampleFormat & FRAME_FORMAT_WIDTH) == FRAME_FORMAT_WIDTH_16) ? 32767L : 2047L;
+	if (sample > limit) { sample = limit; }
+	if (sample < -limit - 1) { sample = -limit - 1; }
+	
+	if ((sampleFormat & FRAME_FORMAT_WIDTH) == FRAME_FORMAT_WIDTH_12) { return (unsigned int) sample & 0x0FFF; }
+	return (unsigned int) sample;
+}
 
-	/* If frame size for device 2 is 0, do not read from device 2 */
-	} else if (frameSize2 != 0) { // device 2
+/***************************************************************************//**
+ * @brief	Sets the width and shift of the samples in the packed frames. Use 
+ *          a shift of 8 (16 bit) or 12 (12 bit) to keep the top bits of the 
+ *          full scale, or a smaller shift to zoom in on small signals (large 
+ *          samples then saturate).
+ * 
+ * @param	width - 24, 16 or 12 bits.
+ * @param	shift - Right shift (0 to 15) applied before saturating. Ignored 
+ *                  for 24 bit samples.
+ * 
+ * @return	1 - resolution set, 0 - invalid width or shift.
+*******************************************************************************/
+unsigned char ADS1298_SetResolution(unsigned char width,
+									unsigned char shift) {
+	if (shift > FRAME_FORMAT_SHIFT) { return 0; }
+	
+	switch (width) {
+		case 24: sampleFormat = FRAME_FORMAT_WIDTH_24; break;
+		case 16: sampleFormat = FRAME_FORMAT_WIDTH_16 | shift; break;
+		case 12: sampleFormat = FRAME_FORMAT_WIDTH_12 | shift; break;
+		default: return 0;
+	}
+	
+	return 1;
+}
 
-		/* Bring the CS pin low */
-		CommADS1298_CS2_PIN = 0;
+/***************************************************************************//**
+ * @brief	Gets the number of frames where DRDY of device 2 had not fallen 
+ *          together with DRDY of device 1, and the longest lag seen.
+ * 
+ * @param	pMaxSkew - Pointer storing the longest lag (in polls of DRDY2).
+ * 
+ * @return	Number of skewed frames since ADS1298_StartAcquisition.
+*******************************************************************************/
+unsigned char ADS1298_GetSkews(unsigned char* pMaxSkew) {
+	*pMaxSkew = DRDY_MAX_SKEW;
+	return DRDY_SKEWS;
+}
 
-		/* Read all the data in the frame */
-		CommADS1298_Read(pDataBuffer, 3); // read the header
-		CommADS1298_Read(pDataBuffer, frameSize2 - 3); // overwrite the header
+/***************************************************************************//**
+ * @brief	Clears the frame queue and enables the DRDY interrupt and the frame
+ *          read interrupt so that every conversion is captured by ADS1298_ISR
+ *          and ADS1298_ReadISR. Conversions must already be running (START 
+ *          pin high and RDATAC issued). Nothing is started when a frame could
+ *          not be read within one DRDY period at the configured data rate.
+ * 
+ * @param	None.
+ * 
+ * @return	1 - acquisition started, 0 - the DRDY deadline cannot be met.
+*******************************************************************************/
+unsigned char ADS1298_StartAcquisition() {
+	/* Refuse a data rate that would overwrite conversions */
+	if (!ADS1298_isDeadlineMet()) { return 0; }
+	
+	/* Empty the frame queue */
+	FRAME_HEAD = FRAME_TAIL = 0;
+	FRAME_CLAIMED = 0;
+	FRAME_OVERRUNS = 0;
+	FRAME_DROPS.frames = FRAME_DROPS.bytes = 0;
+	DECIMATION = 1;
+	decimateCount = 0;
+	DRDY_SKEWS = DRDY_MAX_SKEW = 0;
+	RESYNCS = 0;
+	pendingFlags = 0;
+	SEQUENCE = 0;
+	DEADLINE_MISSES = pendingMisses = 0;
+	frameReading = frameOverwritten = 0;
+	
+	/* Enable the DRDY and frame read interrupts */
+	ADS1298_READ_INTERRUPT  = 0;
+	ADS1298_READ_INT_ENABLE = 1;
+	ADS1298_DRDY_INTERRUPT  = 0;
+	ADS1298_DRDY_INT_ENABLE = 1;
+	
+	return 1;
+}
 
-		/* Increment the address of pDataBuffer */
-		pDataBuffer = pDataBuffer + (frameSize2 - 3);
+/***************************************************************************//**
+ * @brief	Disables the DRDY and frame read interrupts. Frames already in the
+ *          queue can still be read with ADS1298_GetFrame.
+ * 
+ * @param	None.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_StopAcquisition() {
+	ADS1298_DRDY_INT_ENABLE = 0;
+	ADS1298_DRDY_INTERRUPT  = 0;
+	ADS1298_READ_INT_ENABLE = 0;
+	ADS1298_READ_INTERRUPT  = 0;
+}
 
-		/* Bring the CS pin high */
-		CommADS1298_CS2_PIN = 1;
+/***************************************************************************//**
+ * @brief	Checks that a frame of the current size is read before the next 
+ *          DRDY at the configured data rate, in the worst case of hold-off 
+ *          and preemption (see ADS1298_TCY_DEADLINE).
+ * 
+ * @param	None.
+ * 
+ * @return	1 - the deadline is met, 0 - conversions would be overwritten.
+*******************************************************************************/
+unsigned char ADS1298_isDeadlineMet() {
+	unsigned char config1 = REGISTERS[0][ADS1298_CONFIG1];
+	unsigned long period = ADS1298_TCY_PER_FRAME(config1 & ADS1298_CONFIG1_DR_MASK);
+	
+	/* LP mode halves the data rate */
+	if ((config1 & ADS1298_CONFIG1_HR) == 0) { period = period << 1; }
+	
+	return (ADS1298_TCY_DEADLINE((unsigned long) frameSize1 + frameSize2) <= period);
+}
+
+/***************************************************************************//**
+ * @brief	Gets the number of DRDY events that came before the previous 
+ *          conversion was read, so that it was overwritten in the ADS1298. 
+ *          Each one is also counted as a dropped frame and leaves a gap in 
+ *          the sequence numbers.
+ * 
+ * @param	None.
+ * 
+ * @return	Number of deadline misses since ADS1298_StartAcquisition.
+*******************************************************************************/
+unsigned char ADS1298_GetDeadlineMisses() {
+	return DEADLINE_MISSES;
+}
+
+/***************************************************************************//**
+ * @brief	Checks if a captured frame is waiting in the frame queue.
+ * 
+ * @param	None.
+ * 
+ * @return	1 - a frame is available, 0 - the queue is empty.
+*******************************************************************************/
+unsigned char ADS1298_isFrameAvailable() {
+	return (FRAME_HEAD != FRAME_TAIL);
+}
+
+/***************************************************************************//**
+ * @brief	Gets the free slot at the head of the frame queue, for the frame 
+ *          reader to fill in place. Producer side (frame read interrupt) only.
+ * 
+ * @param	None.
+ * 
+ * @return	Pointer to a slot of ADS1298_MAX_FRAME_SIZE bytes, 0 if the queue
+ *          is full.
+*******************************************************************************/
+unsigned char* ADS1298_GetFreeSlot() {
+	unsigned char head = FRAME_HEAD;
+	
+	if (++head == ADS1298_MAX_FRAMES) { head = 0; }
+	if (head == FRAME_TAIL) { return 0; }
+	
+	return FRAME_QUEUE[FRAME_HEAD];
+}
+
+/***************************************************************************//**
+ * @brief	Publishes the slot returned by ADS1298_GetFreeSlot with the length
+ *          of the frame written into it. A length of 0 leaves the slot free.
+ *          Producer side (frame read interrupt) only.
+ * 
+ * @param	length - Size of the packed frame in the slot.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_CommitSlot(unsigned char length) {
+	unsigned char head = FRAME_HEAD;
+	
+	if (length == 0) { return; }
+	
+	/* Store the length before the new head makes the slot visible */
+	FRAME_LENGTH[head] = length;
+	if (++head == ADS1298_MAX_FRAMES) { head = 0; }
+	FRAME_HEAD = head;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the oldest captured frame in place, without copying it. The 
+ *          slot stays valid until ADS1298_ReleaseFrame. Only the ISR moves the
+ *          head and only the consumer moves the tail while it holds the slot,
+ *          so the interrupts do not need to be disabled.
+ * 
+ * @param	pLength - Pointer to the char storing the size of the frame.
+ * 
+ * @return	Pointer to the frame, 0 if the queue is empty.
+*******************************************************************************/
+unsigned char* ADS1298_PeekFrame(unsigned char* pLength) {
+	unsigned char tail;
+	
+	/* Claim the tail before reading it, so the ISR stops dropping from it */
+	FRAME_CLAIMED = 1;
+	tail = FRAME_TAIL;
+	if (FRAME_HEAD == tail) {
+		FRAME_CLAIMED = 0;
+		return 0;
+	}
+	
+	*pLength = FRAME_LENGTH[tail];
+	return FRAME_QUEUE[tail];
+}
+
+/***************************************************************************//**
+ * @brief	Returns the slot of the oldest frame to the read interrupt once it
+ *          has been sent.
+ * 
+ * @param	None.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_ReleaseFrame() {
+	unsigned char tail = FRAME_TAIL;
+	
+	if (FRAME_CLAIMED && (FRAME_HEAD != tail)) {
+		if (++tail == ADS1298_MAX_FRAMES) { tail = 0; }
+		FRAME_TAIL = tail;
+	}
+	
+	/* Give the tail back to the ISR */
+	FRAME_CLAIMED = 0;
+}
+
+/***************************************************************************//**
+ * @brief	Copies the oldest captured frame out of the frame queue. Prefer 
+ *          ADS1298_PeekFrame and ADS1298_ReleaseFrame, which do not copy.
+ * 
+ * @param	pDataBuffer - Pointer to the array storing the frame.
+ * 
+ * @return	Number of bytes copied (0 if the queue was empty).
+*******************************************************************************/
+unsigned char ADS1298_GetFrame(unsigned char* pDataBuffer) {
+	unsigned char* pFrame;
+	unsigned char i, length;
+	
+	/* Nothing to read */
+	pFrame = ADS1298_PeekFrame(&length);
+	if (pFrame == 0) { return 0; }
+	
+	/* Copy the frame and release its slot */
+	for (i = 0; i < length; i = i + 1) { pDataBuffer[i] = pFrame[i]; }
+	ADS1298_ReleaseFrame();
+	
+	return length;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the number of conversions that were lost because the frame
+ *          queue was full when DRDY fired.
+ * 
+ * @param	None.
+ * 
+ * @return	Number of overruns since ADS1298_StartAcquisition.
+*******************************************************************************/
+unsigned char ADS1298_GetOverruns() {
+	return FRAME_OVERRUNS;
+}
+
+/***************************************************************************//**
+ * @brief	Sets what the read interrupt does when the frame queue is full. 
+ *          Frames are always dropped whole:
+ *          FRAME_POLICY_DROP_NEWEST - the new conversion is not read.
+ *          FRAME_POLICY_DROP_OLDEST - the oldest frame is dropped for the new 
+ *          one, unless it is being sent (then the new one is not read).
+ *          FRAME_POLICY_BACKPRESSURE - the new conversion is not read and only
+ *          1 of every 2, 4 then 8 conversions is read until the consumer 
+ *          catches up again.
+ * 
+ * @param	policy - FRAME_POLICY_*.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_SetOverflowPolicy(unsigned char policy) {
+	overflowPolicy = policy;
+	if (policy != FRAME_POLICY_BACKPRESSURE) { DECIMATION = 1; }
+}
+
+/***************************************************************************//**
+ * @brief	Gets the running totals of the frames and bytes dropped under the 
+ *          overflow policy (for the drop report of Frame.h). Conversions 
+ *          skipped by the backpressure decimation count as dropped.
+ * 
+ * @param	pDrops - Pointer to the structure storing the totals.
+ * 
+ * @return	Overflow policy in use.
+*******************************************************************************/
+unsigned char ADS1298_GetDrops(FrameDrops* pDrops) {
+	unsigned char enable = ADS1298_READ_INT_ENABLE;
+	
+	/* The totals are 16 bits, so hold off the read ISR while copying them */
+	ADS1298_READ_INT_ENABLE = 0;
+	*pDrops = FRAME_DROPS;
+	ADS1298_READ_INT_ENABLE = enable;
+	
+	return overflowPolicy;
+}
+
+/***************************************************************************//**
+ * @brief	Gets the current backpressure decimation.
+ * 
+ * @param	None.
+ * 
+ * @return	1 of every N conversions is read (1 when there is no backpressure).
+*******************************************************************************/
+unsigned char ADS1298_GetDecimation() {
+	return DECIMATION;
+}
+
+/***************************************************************************//**
+ * @brief	Counts a frame dropped under the overflow policy. Frame read 
+ *          interrupt only.
+ * 
+ * @param	length - Size of the dropped frame.
+ * 
+ * @return	None.
+*******************************************************************************/
+static void ADS1298_CountDrop(unsigned char length) {
+	FRAME_DROPS.frames = FRAME_DROPS.frames + 1;
+	FRAME_DROPS.bytes = FRAME_DROPS.bytes + length;
+}
+
+/***************************************************************************//**
+ * @brief	Interrupt service routine for the DRDY line (high priority). Only
+ *          latches the tick and raises the frame read interrupt, so the link
+ *          bursts on SSP2, also high priority, are never held up by a read.
+ * 
+ * @param	None.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_ISR() {
+	if (ADS1298_DRDY_INTERRUPT && ADS1298_DRDY_INT_ENABLE) {
+		
+		/* Clear the interrupt flag */
+		ADS1298_DRDY_INTERRUPT = 0;
+		
+		/* The last conversion was not read in time: it is overwritten now */
+		if (frameReading) {
+			frameOverwritten = 1; // the read in progress gets a mix of both
+			DEADLINE_MISSES = DEADLINE_MISSES + 1;
+		} else if (ADS1298_READ_INTERRUPT) {
+			pendingMisses = pendingMisses + 1; // the pending read gets the new one
+			DEADLINE_MISSES = DEADLINE_MISSES + 1;
+		}
+		
+		/* Latch the tick now and leave the read to the low priority interrupt */
+		ADS1298_LATCH_TICK();
+		ADS1298_READ_INTERRUPT = 1;
+	}
+}
+
+/***************************************************************************//**
+ * @brief	Interrupt service routine for the frame read (low priority). Reads
+ *          the frame that just became ready straight into the head slot of 
+ *          the frame queue. The SSP2 interrupt preempts it for every link 
+ *          byte, so the previous frame is clocked out to the relay while this
+ *          one is clocked in on SSP1 (the SSP1 master simply waits).
+ * 
+ * @param	None.
+ * 
+ * @return	None.
+*******************************************************************************/
+void ADS1298_ReadISR() {
+	unsigned char* pSlot;
+	unsigned char tail, length, misses;
+	
+	if (ADS1298_READ_INTERRUPT && ADS1298_READ_INT_ENABLE) {
+		
+		/* Clear the interrupt flag */
+		ADS1298_READ_INTERRUPT = 0;
+		
+		/* Account for the conversions overwritten before this read (the 
+		 * subtraction is a single SUBWF, so a DRDY in between is not lost) */
+		misses = pendingMisses;
+		if (misses != 0) {
+			pendingMisses = pendingMisses - misses;
+			SEQUENCE = SEQUENCE + misses;
+			while (misses-- != 0) { ADS1298_CountDrop((unsigned char) ADS1298_GetFrameSize()); }
+		}
+		
+		/* Under backpressure, skip the conversions between two reads */
+		if (decimateCount != 0) {
+			decimateCount = decimateCount - 1;
+			ADS1298_CountDrop((unsigned char) ADS1298_GetFrameSize());
+			SEQUENCE = SEQUENCE + 1; // leave a gap in the sequence numbers
+			return;
+		}
+		decimateCount = DECIMATION - 1;
+		
+		/* If the queue is full, drop whole frames as the policy says */
+		pSlot = ADS1298_GetFreeSlot();
+		if (pSlot == 0) {
+			FRAME_OVERRUNS = FRAME_OVERRUNS + 1;
+			
+			/* Drop the oldest frame, unless the consumer is sending it */
+			if ((overflowPolicy == FRAME_POLICY_DROP_OLDEST) && !FRAME_CLAIMED) {
+				tail = FRAME_TAIL;
+				ADS1298_CountDrop(FRAME_LENGTH[tail]);
+				if (++tail == ADS1298_MAX_FRAMES) { tail = 0; }
+				FRAME_TAIL = tail;
+				pSlot = ADS1298_GetFreeSlot();
+			}
+			
+			/* Ask for fewer conversions until the consumer catches up */
+			else if ((overflowPolicy == FRAME_POLICY_BACKPRESSURE) && (DECIMATION < ADS1298_MAX_DECIMATION)) {
+				DECIMATION = DECIMATION << 1;
+				decimateCount = DECIMATION - 1;
+			}
+		}
+		
+		/* Drop this conversion */
+		if (pSlot == 0) {
+			ADS1298_CountDrop((unsigned char) ADS1298_GetFrameSize());
+			SEQUENCE = SEQUENCE + 1; // leave a gap in the sequence numbers
+			return;
+		}
+		
+		/* The consumer caught up, so ease the backpressure */
+		if ((FRAME_HEAD == FRAME_TAIL) && (DECIMATION > 1)) { DECIMATION = DECIMATION >> 1; }
+		
+		/* Read the frame into the slot (ADS1298_ReadFrame clears the flag
+		 * once the SPI transfer is done) */
+		frameReading = 1;
+		length = ADS1298_ReadFrame(pSlot);
+		
+		/* Drop the frame if the next DRDY overwrote it during the read */
+		if (frameOverwritten) {
+			frameOverwritten = 0;
+			if (length != 0) { ADS1298_CountDrop(length); }
+			length = 0;
+		}
+		
+		/* Publish the frame (unless it was dropped) */
+		ADS1298_CommitSlot(length);
 	}
 }
 
@@ -331,6 +1393,7 @@ void ADS1298_ReadFrame(unsigned char* pDataBuffer) {
 *******************************************************************************/
 void ADS1298_ReadData(unsigned char* pDataBuffer, 
 					  unsigned long frameCnt) {
+	unsigned char* pRawFrame;
 	unsigned char i;
 	
 	/* Bring the START pin high to start converting data */
@@ -338,15 +1401,27 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
 	
     /* If you just want to read a single frame of data */
     if (frameCnt == 1) { 
+        pRawFrame = pDataBuffer;
+        pDataBuffer = pDataBuffer + ADS1298_RAW_OFFSET;
+        
+        /* Daisy-chain mode: both frames in one transfer on the shared CS */
+        if (readMode == ADS1298_READMODE_DAISY) {
+            CommADS1298_CS1_PIN = 0;
+            while (ADS1298_DRDY1_NOT);
+            ADS1298_LATCH_TICK();
+            ADS1298_WriteSingleOpCode(ADS1298_RDATA);
+            CommADS1298_Read(pDataBuffer, frameSize1 + frameSize2);
+            CommADS1298_CS1_PIN = 1;
         
         /* If frame size for device 1 is 0, do not read from device 1 */
-        if (frameSize1 != 0) {
+        } else if (frameSize1 != 0) {
             
             /* Bring the CS pin low */
             CommADS1298_CS1_PIN = 0;
 
             /* Wait for the DRDY_NOT line to go low */
             while (ADS1298_DRDY1_NOT);
+            ADS1298_LATCH_TICK();
 
             /* Issue the RDATA opcode to read a single frame of data */
             ADS1298_WriteSingleOpCode(ADS1298_RDATA);
@@ -354,14 +1429,15 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
             /* Read the data in the frame */
             CommADS1298_Read(pDataBuffer, frameSize1);
 
-            /* Issue the STOP opcode to stop converting data */
-            ADS1298_WriteSingleOpCode(ADS1298_STOP);
-
             /* Exit from the current device by bringing CS high */
             CommADS1298_CS1_PIN = 1;
-
+            
+            /* Increment the address of pDataBuffer */
+            pDataBuffer = pDataBuffer + frameSize1;
+        }
+        
         /* If frame size for device 2 is 0, do not read from device 2 */
-        } else if (frameSize2 != 0) {
+        if ((readMode != ADS1298_READMODE_DAISY) && (frameSize2 != 0)) {
 
             /* Bring the CS pin low */
             CommADS1298_CS2_PIN = 0;
@@ -379,6 +1455,10 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
             CommADS1298_CS2_PIN = 1;
         }
         
+        /* Decode the status words and pack the frame */
+        ADS1298_CheckStatus(pRawFrame);
+        ADS1298_PackFrame(pRawFrame);
+        
         /* Bring the START pin low to stop the data conversions */
         ADS1298_START_PIN = 0;
         return;
@@ -394,41 +1474,12 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
     /* Iterate through the specified number of frames */
 	for (i = 0; i < frameCnt; i = i + 1) {
 		
-        /* Wait for the DRDY_NOT line to go low */
-        while (ADS1298_DRDY1_NOT || ADS1298_DRDY2_NOT);
+        /* Wait for the DRDY_NOT line of device 1 to go low */
+        while (ADS1298_DRDY1_NOT);
+        ADS1298_LATCH_TICK();
         
-        /* If frame size for device 1 is 0, do not read from device 1 */
-        if (frameSize1 != 0) { // device 1
-
-            /* Bring the CS pin low */
-            CommADS1298_CS1_PIN = 0;
-
-            /* Read all the data in the frame */
-            CommADS1298_Read(pDataBuffer, 3); // read the header
-            CommADS1298_Read(pDataBuffer, frameSize1 - 3); // overwrite the header
-
-            /* Increment the address of pDataBuffer */
-            pDataBuffer = pDataBuffer + (frameSize1 - 3);
-
-            /* Bring the CS pin high */
-            CommADS1298_CS1_PIN = 1;
-
-        /* If frame size for device 2 is 0, do not read from device 2 */
-        } else if (frameSize2 != 0) { // device 2
-
-            /* Bring the CS pin low */
-            CommADS1298_CS2_PIN = 0;
-
-            /* Read all the data in the frame */
-            CommADS1298_Read(pDataBuffer, 3); // read the header
-            CommADS1298_Read(pDataBuffer, frameSize2 - 3); // overwrite the header
-
-            /* Increment the address of pDataBuffer */
-            pDataBuffer = pDataBuffer + (frameSize2 - 3);
-
-            /* Bring the CS pin high */
-            CommADS1298_CS2_PIN = 1;
-        }
+        /* Read both devices and increment the address of pDataBuffer */
+        pDataBuffer = pDataBuffer + ADS1298_ReadFrame(pDataBuffer);
 	}
     
     /* Issue the SDATAC opcode to stop reading data */
@@ -437,77 +1488,40 @@ void ADS1298_ReadData(unsigned char* pDataBuffer,
     ADS1298_WriteSingleOpCode(ADS1298_SDATAC);
     CommADS1298_CS1_PIN = 1;
 	CommADS1298_CS2_PIN = 1;
-    for (i = 0; i < 50; i++) {} // wait at least 4 shift clock cycles
+    CLOCK_DELAY_US(ADS1298_DECODE_US); // wait at least 4 shift clock cycles
     
     /* Bring the START pin low to stop the data conversions */
     ADS1298_START_PIN = 0;
 }
 
 /***************************************************************************//**
- * @brief	Gets the total frame size.
+ * @brief	Gets the size of a packed frame.
  * 
  * @param	None.
  * 
- * @return	Total frame size (sum of the frame sizes from both devices).
+ * @return	Frame size (header and the samples of enabled channels).
 *******************************************************************************/
 unsigned long ADS1298_GetFrameSize() {
-	return (frameSize1 + frameSize2);
-}
-
-/***************************************************************************//**
- * @brief Initialize the ADS1298 registers for testing. 
- * 
- * @param None.
- * 
- * @return 1 - initialization success, 0 - initialization failed
-*******************************************************************************/
-unsigned char ADS1298_RegistersForTesting(unsigned char* channels) {
-	unsigned char writeVals[25] = {0, 0, 0, 0, 0, \
-                                   0, 0, 0, 0, 0, \
-                                   0, 0, 0, 0, 0, \
-								   0, 0, 0, 0, 0, \
-								   0, 0, 0, 0, 0};
-	
-	/* Define the common register values to write*/
-	/* CONFIG1    */ writeVals[0]  = ADS1298_CONFIG1_HR | ADS1298_CONFIG1_DR_2K; // 0x84
-	/* CONFIG2    */ writeVals[1]  = ADS1298_CONFIG2_WCTCHOPCONST | ADS1298_CONFIG2_INTTEST | ADS1298_CONFIG2_TESTAMP | ADS1298_CONFIG2_TESTFREQ_AC20;
-	/* CONFIG3    */ writeVals[2]  = ADS1298_CONFIG3_INTREFEN | (0b1u << 6);
-	/* LOFF       */ writeVals[3]  = 0x00;
-	/* CHXSET     */ // channel settings in index values 4 to 11
-	/* RLD_SENSP  */ writeVals[12] = 0x00;
-	/* RLD_SENSN  */ writeVals[13] = 0x00;
-	/* LOFF_SENSP */ writeVals[14] = 0x00;
-	/* LOFF_SENSN */ writeVals[15] = 0x00;
-	/* LOFF_FLIP  */ writeVals[16] = 0x00;
-	/* LOFF_STATP */ writeVals[17] = 0x00;
-	/* LOFF_STATN */ writeVals[18] = 0x00;
-	/* GPIO       */ writeVals[19] = 0x00;
-	/* PACE       */ writeVals[20] = 0x00;
-	/* RESP       */ writeVals[21] = 0x00;
-	/* CONFIG4    */ writeVals[22] = 0x00;
-	/* WCT1       */ writeVals[23] = 0x00;
-	/* WCT2       */ writeVals[24] = 0x00;
-	
-    /* Write the standard configuration registers */
-    ADS1298_WriteRegisters(1, ADS1298_CONFIG1, 4, writeVals);
-    ADS1298_WriteRegisters(2, ADS1298_CONFIG1, 4, writeVals);
-    
-	/* Set the channels */
-	ADS1298_SetChannels(channels);
-	
-	return 1;
+	return FRAME_HEADER_SIZE + FRAME_SAMPLES_SIZE(sampleFormat, packCount);
 }
 
 /***************************************************************************//**
  * @brief Initialize the ADS1298 registers. 
  * 
  * @param channels - 2 bytes (16 bits) denoting the channels we want to turn on.
+ * @param mode - ADS1298_READMODE_MULTIPLE (one CS per device) or 
+ *               ADS1298_READMODE_DAISY (both devices on CS1, one transfer per
+ *               frame). The board must be wired for the mode (see ADS1298.h).
  * 
  * @return 1 - initialization success, 0 - initialization failed
 *******************************************************************************/
-unsigned char ADS1298_Initialize(unsigned char* channels) {
+unsigned char ADS1298_Initialize(unsigned char* channels,
+								 unsigned char mode) {
 	unsigned char status = 0;
 	
+	/* Select how the frames are read back */
+	readMode = mode;
+	
 	/* Initialize the device */
 	status = CommADS1298_Initialize();
 	if (!status) { return 0; } // if initialization was unsuccessful, return 0
@@ -516,12 +1530,9 @@ unsigned char ADS1298_Initialize(unsigned char* channels) {
 	status = ADS1298_PowerUp(); // if initialization was successful, power up the device
 	if (!status) { return 0; } // if the power up was unsuccessful, return 0
 	
-	/* Set the registers for testing */
-	status = ADS1298_RegistersForTesting(channels);
+	/* Apply the test profile */
+	status = ADS1298_ApplyProfile(ADS1298_PROFILE_TEST, channels);
 	if (!status) { return 0; }
-	
-    /* Compute the frame size */
-    ADS1298_ComputeFrameSize();
     
 	return 1;
 }
\ No newline at end of file
@@ -7,6 +7,12 @@
 #ifndef ADS1298_H
 #define ADS1298_H
 
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include "Clock.h"
+#include "Frame.h"
+
 /******************************************************************************/
 /* ADS1298 OPCODE COMMANDS													  */
 /******************************************************************************/
@@ -63,6 +69,8 @@
 #define ADS1298_WCT1			0x18
 #define ADS1298_WCT2			0x19
 
+#define ADS1298_NUM_REGISTERS	26		// ID through WCT2
+
 /******************************************************************************/
 /* ADS1298 REGISTER VALUES													  */
 /******************************************************************************/
@@ -93,6 +101,7 @@
 #define ADS1298_CONFIG1_DR_2K		(0b100u << 0)	//	100 = HR: 2kSPS,  LP: 1kSPS
 #define ADS1298_CONFIG1_DR_1K		(0b101u << 0)	//	101 = HR: 1kSPS,  LP: 500kSPS
 #define ADS1298_CONFIG1_DR_500		(0b110u << 0)	//	110 = HR: 500SPS, LP: 250kSPS
+#define ADS1298_CONFIG1_DR_MASK		(0b111u << 0)
 
 /******************************************************************************/
 /* ADS1298 Configuration Register 2											  */
@@ -352,6 +361,144 @@
 #define ADS1298_WCT2_WCTC_CH4POS		(0b110u << 0)	//	110 = Channel 4 positive input connected to WCTC amplifier
 #define ADS1298_WCT2_WCTC_CH4NEG		(0b111u << 0)	//	111 = Channel 4 negative input connected to WCTC amplifier
 
+/******************************************************************************/
+/* ADS1298 ACQUISITION														  */
+/******************************************************************************/
+#define ADS1298_MAX_FRAME_SIZE		59	// raw frame: 2 devices x (24 bit status word + 8 channels x 24 bits)
+#define ADS1298_RAW_OFFSET			5	// raw frame starts 5 bytes in so that the 8 byte frame header fits in front of the samples
+#define ADS1298_MAX_DECIMATION		8	// backpressure reads at least 1 of every 8 conversions
+
+#define ADS1298_POWERUP_MS			150	// tPOR = 2^18 tCLK (128 ms) after PWDN and RESET go high
+#define ADS1298_RESET_US			20	// 18 tCLK (8.8 us) after a reset
+#define ADS1298_DECODE_US			4	// 4 tCLK (2 us) to decode a command
+
+#define ADS1298_STATUS_SYNC			(0b1111u << 4)	// Sync nibble in the first status byte
+#define ADS1298_STATUS_SYNC_OK		(0b1100u << 4)	//	1100 = Status word is aligned
+
+/* Frame readback mode. The two modes need different board wiring:
+ *
+ *	Signal		Multiple readback					Daisy-chain
+ *	CS			RA2 to device 1, RA3 to device 2	RA2 to both devices, RA3 not connected
+ *	DOUT		DOUT1 and DOUT2 to RC4 (SDI1)		DOUT1 to RC4 (SDI1), DOUT2 to DAISY_IN1 only
+ *	DAISY_IN1	to ground							to DOUT2
+ *	SCLK, DIN	RC3 and RC5, shared					RC3 and RC5, shared
+ *	DRDY		DRDY1 to RA0 and RB0 (INT0),		DRDY1 to RA0 and RB0 (INT0),
+ *				DRDY2 to RA1						DRDY2 not used
+ *
+ * With daisy-chain wiring every register write on CS1 reaches both devices,
+ * so they share one configuration: a channel turned on in either device is 
+ * turned on in both, and the registers of device 2 read back as those of 
+ * device 1. A frame is one transfer of up to 54 bytes under CS1. */
+#define ADS1298_READMODE_MULTIPLE	0		//	0 = Multiple readback, one CS and one transfer per device
+#define ADS1298_READMODE_DAISY		1		//	1 = Daisy-chain, DOUT2 feeds DAISY_IN1 and both devices are read in one transfer under CS1
+
+/******************************************************************************/
+/* ADS1298 Acquisition Profiles												  */
+/******************************************************************************/
+#define ADS1298_PROFILE_SIZE		25	// CONFIG1 through WCT2
+#define ADS1298_NUM_PROFILES		4
+											// Profiles stored in program memory
+#define ADS1298_PROFILE_TEST		0		//	0 = Internal test signal, HR 2 kSPS, gain 12
+#define ADS1298_PROFILE_SURVEY		1		//	1 = Electrodes, HR 500 SPS, gain 6
+#define ADS1298_PROFILE_PVMAPPING	2		//	2 = Electrodes, HR 2 kSPS, gain 12
+#define ADS1298_PROFILE_SELFTEST	3		//	3 = Shorted, test, temperature and supply inputs, LP 500 SPS
+
+/******************************************************************************/
+/* ADS1298 Acquisition Timing Model											  */
+/******************************************************************************/
+/* Instruction cycles (TCY) available between two DRDY events and spent in the 
+ * DRDY interrupt. The SPI shift clock runs at FOSC/4, so shifting one byte 
+ * takes 8 TCY and the assembly loop of CommADS1298_ReadFrame adds 4 TCY, as
+ * simulated by test/ReaderSim.c (the polled CommADS1298_Read loop it replaced
+ * added about 12 TCY). The SSP1 interrupt is masked while it runs, so no 
+ * interrupt is taken per byte (see ADS1298_ReadFrame). Entering and leaving
+ * the high priority interrupt costs about 50 TCY. The ISR costs the same TCY
+ * at any FOSC, so the 4x PLL (see Clock.h) gives 4x the TCY per frame. The 
+ * read itself runs in the low priority frame read interrupt that the DRDY 
+ * interrupt raises (about 30 TCY on top of the ISR TCY below), and the link 
+ * bytes on SSP2 preempt it, which stretches it but does not add to it.
+ * 
+ * The tables below are printed by test/TimingModel.c from the ADS1298_TCY_*
+ * macros, which also checks that they are still the ones here. The TCY per
+ * byte is simulated (test/ReaderSim.c). The interrupt overheads are estimated
+ * by hand from the instructions, not measured on the PIC.
+ * 
+ *	DR (HR mode)	TCY/frame (16 / 64 MHz)		ISR TCY (8 ch)	TCY freed/frame at 64 MHz
+ *	DR_32K  		  125 / 500  				374				  126 (25%), not sustainable at 16 MHz
+ *	DR_16K  		  250 / 1000 				374				  626 (63%), not sustainable at 16 MHz
+ *	DR_8K   		  500 / 2000 				374				 1626 (81%)
+ *	DR_4K   		 1000 / 4000 				374				 3626 (91%)
+ *	DR_2K   		 2000 / 8000 				374				 7626 (95%)
+ *	DR_1K   		 4000 / 16000				374				15626 (98%)
+ *	DR_500  		 8000 / 32000				374				31626 (99%)
+ * 
+ * With the old busy-wait in ADS1298_ReadFrame none of these cycles were free,
+ * and with the CommADS1298_Read loop (590 TCY) DR_8K was not sustainable at
+ * 16 MHz. In LP mode the data rate is halved, which doubles the TCY per frame.
+ * 
+ * Readback mode comparison for a full 16 channel frame (54 bytes). The read
+ * TCY are the simulated ones of CommADS1298_ReadFrame (332 TCY for 27 bytes,
+ * 656 TCY for 54 bytes, see test/ReaderSim.c). The rest is estimated by hand:
+ * each call costs about 8 TCY, each CS edge 1 TCY and the DRDY2 check and the
+ * pointer step of multiple readback about 10 and 6 TCY.
+ * 
+ *	Mode		CS edges	Read calls	DRDY2 check		TCY/frame
+ *	MULTIPLE	4			2			~10				2 x 332 + 2 x 8 + 4 + 10 + 6 = 700
+ *	DAISY		2			1			none			656 + 8 + 2                  = 666
+ * 
+ * Daisy-chain mode must shift all 8 channels of device 1 to reach device 2, 
+ * so with few channels enabled on device 1 multiple readback is cheaper.
+ * 
+ * DRDY deadline. The ADS1298 overwrites its output register at the next DRDY,
+ * so a frame must be read within one DRDY period. The worst case adds up 
+ * what can delay or stretch the read:
+ * 
+ *	Term					Bound									Macro
+ *	DRDY latency			one link byte interrupt (50 TCY)		ADS1298_TCY_LINK_BYTE
+ *	low priority hold-off	one byte of a TX FIFO refill (40 TCY)	ADS1298_TCY_LOW_HOLDOFF
+ *	read					ISR TCY below							ADS1298_TCY_ISR
+ *	link byte interrupts	up to 50 of every 134 TCY				ADS1298_TCY_LINK_PERIOD
+ *	SSP1 interrupts			none, masked while the reader runs		-
+ * 
+ * The DRDY interrupt only latches the tick and raises the frame read. The 
+ * read runs at low priority behind whatever low priority work is running:
+ * CC110L_StreamISR yields to a pending read between two bytes of its refill,
+ * so it holds the read off by one byte at most. The link byte interrupts on 
+ * SSP2 (see CommCC110L_StartBurst) stretch both the hold-off and the read by 
+ * 134 / 84. Link and radio modes are exclusive, so adding the link bytes to 
+ * the refill over-counts. Register transfers queued on SSP1 also delay the
+ * read (CommADS1298_Wait), but they are only issued while acquisition is 
+ * stopped. Only the SPI transfer counts: the status check and the packing 
+ * (ADS1298_PackFrame) work on the slot after it, and a DRDY during them 
+ * only raises the next read. ADS1298_StartAcquisition refuses a rate where
+ * the bound does not fit (a negative slack below), and a DRDY that comes 
+ * before the previous frame was read is counted as a deadline miss and a 
+ * dropped frame, so a conversion is never lost silently. The frame queue (ADS1298_MAX_FRAMES slots) does the job of a 
+ * ping-pong buffer: the read fills the head slot while the consumer sends the
+ * tail slot, and the spare slots absorb a late consumer.
+ * 
+ *	DR (HR mode)	TCY/frame	Deadline, slack 8 ch	Deadline, slack 16 ch
+ *	DR_32K  		  500		 710,   -210 refused	1227,   -727 refused
+ *	DR_16K  		 1000		 710,    290			1227,   -227 refused
+ *	DR_8K   		 2000		 710,   1290			1227,    773
+ *	DR_4K   		 4000		 710,   3290			1227,   2773
+ *	DR_2K   		 8000		 710,   7290			1227,   6773
+ *	DR_1K   		16000		 710,  15290			1227,  14773
+ *	DR_500  		32000		 710,  31290			1227,  30773
+ */
+#define ADS1298_TCY_PER_SECOND			CLOCK_TCY_HZ	// FOSC / 4
+#define ADS1298_TCY_PER_BYTE			12u			// 8 TCY shift + 4 TCY of the reader loop (test/ReaderSim.c)
+#define ADS1298_TCY_ISR_OVERHEAD		50u			// context save/restore and bookkeeping
+#define ADS1298_HR_RATE(dr)				(32000ul >> (dr))	// samples per second for a CONFIG1_DR_* value
+#define ADS1298_TCY_PER_FRAME(dr)		(ADS1298_TCY_PER_SECOND / ADS1298_HR_RATE(dr))
+#define ADS1298_TCY_ISR(bytes)			(ADS1298_TCY_ISR_OVERHEAD + ((bytes) * ADS1298_TCY_PER_BYTE))
+#define ADS1298_TCY_FREED(dr, bytes)	(ADS1298_TCY_PER_FRAME(dr) - ADS1298_TCY_ISR(bytes))
+#define ADS1298_TCY_LINK_BYTE			50u			// SSP2 link byte interrupt that preempts a read
+#define ADS1298_TCY_LINK_PERIOD			134u		// TCY between two link bytes
+#define ADS1298_TCY_LOW_HOLDOFF			40u			// one byte of CC110L_StreamRefill before it yields
+#define ADS1298_TCY_DEADLINE(bytes)		((((ADS1298_TCY_ISR(bytes) + ADS1298_TCY_LOW_HOLDOFF) * ADS1298_TCY_LINK_PERIOD) / \
+										  (ADS1298_TCY_LINK_PERIOD - ADS1298_TCY_LINK_BYTE)) + ADS1298_TCY_LINK_BYTE)
+
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
 /******************************************************************************/
@@ -371,6 +518,20 @@ void ADS1298_ReadRegisters(unsigned char device,
 						   unsigned char writeNum, 
 						   unsigned char* regVals);
 
+/* Gets a register value from the register shadow */
+unsigned char ADS1298_GetRegister(unsigned char device,
+								  unsigned char address);
+
+/* Loads the reset values into the register shadow */
+void ADS1298_ResetShadow();
+
+/* Compares the registers of the ADS1298 with the register shadow */
+unsigned char ADS1298_VerifyRegisters(unsigned char device);
+
+/* Reads the lead-off status registers of the ADS1298 */
+void ADS1298_ReadLeadOffStatus(unsigned char device,
+							   unsigned char* pStatus);
+
 /* Powers up the ADS1298 chip */
 unsigned char ADS1298_PowerUp();						   
 						
@@ -383,26 +544,105 @@ void ADS1298_ComputeFrameSize();
 /* Sets the channels for the ADS1298 chip */
 void ADS1298_SetChannels(unsigned char* channels);
 
+/* Applies an acquisition profile to the ADS1298 chips */
+unsigned char ADS1298_ApplyProfile(unsigned char newProfile,
+								   unsigned char* channels);
+
 /* Start data conversions */
 void ADS1298_StartConversion();
 
 /* Stop data conversions */
 void ADS1298_StopConversion();
 
-/* Read a single frame of data */
-void ADS1298_ReadFrame(unsigned char* pDataBuffer);
+/* Read a single frame of data from both devices */
+unsigned char ADS1298_ReadFrame(unsigned char* pDataBuffer);
+
+/* Packs a raw frame into the link frame format */
+unsigned char ADS1298_PackFrame(unsigned char* pDataBuffer);
+
+/* Gets the sequence number the next frame will carry */
+unsigned int ADS1298_GetSequence();
+
+/* Checks the status words of a raw frame */
+unsigned char ADS1298_CheckStatus(unsigned char* pDataBuffer);
+
+/* Resynchronises the SPI after a misaligned frame */
+void ADS1298_Resync();
+
+/* Gets the number of times the SPI was resynchronised */
+unsigned char ADS1298_GetResyncs();
+
+/* Gets the lead-off status of the last frame */
+void ADS1298_GetLeadOff(unsigned char device,
+						unsigned char* pStatus);
+
+/* Reduces a 24 bit sample to the packed sample width */
+unsigned int ADS1298_ReduceSample(unsigned char* pSample);
+
+/* Sets the width and shift of the packed samples */
+unsigned char ADS1298_SetResolution(unsigned char width,
+									unsigned char shift);
+
+/* Gets the number of frames with skewed DRDY lines */
+unsigned char ADS1298_GetSkews(unsigned char* pMaxSkew);
+
+/* Starts capturing frames on the DRDY interrupt */
+unsigned char ADS1298_StartAcquisition();
+
+/* Stops capturing frames on the DRDY interrupt */
+void ADS1298_StopAcquisition();
+
+/* Checks that a frame is read before the next DRDY at the configured data rate */
+unsigned char ADS1298_isDeadlineMet();
+
+/* Gets the number of conversions overwritten before they were read */
+unsigned char ADS1298_GetDeadlineMisses();
+
+/* Checks if a captured frame is available */
+unsigned char ADS1298_isFrameAvailable();
+
+/* Gets the oldest captured frame */
+unsigned char ADS1298_GetFrame(unsigned char* pDataBuffer);
+
+/* Gets the free slot at the head of the frame queue (frame read interrupt only) */
+unsigned char* ADS1298_GetFreeSlot();
+
+/* Publishes a filled slot with the length of its frame (frame read interrupt only) */
+void ADS1298_CommitSlot(unsigned char length);
+
+/* Gets the oldest frame in place */
+unsigned char* ADS1298_PeekFrame(unsigned char* pLength);
+
+/* Releases the slot of the oldest frame */
+void ADS1298_ReleaseFrame();
+
+/* Gets the number of conversions lost to a full frame queue */
+unsigned char ADS1298_GetOverruns();
+
+/* Sets what the frame read interrupt does when the frame queue is full */
+void ADS1298_SetOverflowPolicy(unsigned char policy);
+
+/* Gets the frames and bytes dropped under the overflow policy */
+unsigned char ADS1298_GetDrops(FrameDrops* pDrops);
+
+/* Gets the current backpressure decimation */
+unsigned char ADS1298_GetDecimation();
+
+/* Interrupt service routine for the DRDY line */
+void ADS1298_ISR();
+
+/* Interrupt service routine for the frame read (low priority) */
+void ADS1298_ReadISR();
 
 /* Reads data from the ADS1298 */
 void ADS1298_ReadData(unsigned char* pDataBuffer,
 					  unsigned long frameCnt);
 
-/* Gets the total frame size */
+/* Gets the size of a packed frame */
 unsigned long ADS1298_GetFrameSize();
 
-/* Sets the registers for testing */
-unsigned char ADS1298_RegistersForTesting(unsigned char* channels);
-
 /* Initializes the ADS1298 */
-unsigned char ADS1298_Initialize(unsigned char* channels);
+unsigned char ADS1298_Initialize(unsigned char* channels,
+								 unsigned char mode);
 
 #endif /* ADS1298_H */
\ No newline at end of file
@@ -9,18 +9,263 @@
 /******************************************************************************/
 #include "CommCC110L.h"
 #include "CC110L.h"
+#include "CommADS1298.h"
+#include "ADS1298.h"
+#include "Frame.h"
+#include "RingBuffer.h"
 
 /******************************************************************************/
 /* DEFINITIONS  															  */
 /******************************************************************************/
-#define MAX_TX_SIZE     64
+#define MAX_TX_SIZE     128 // two frames of FRAME_MAX_SIZE
 #define MAX_RC_SIZE     64
+#define PA_POWER        0x8E // PATABLE entry for 0 dBm at 915 MHz
+#define RESET_US        40   // CS high time before the SRES strobe of a manual reset
+#define ARQ_FREE        0    // retransmit window slot states
+#define ARQ_PENDING     1    // waiting to be sent
+#define ARQ_SENT        2    // waiting for an acknowledgement
+#define ARQ_LOST        3    // waiting to be sent again
 
 /******************************************************************************/
 /* GLOBAL VARIABLES															  */
 /******************************************************************************/
-unsigned char TX_BUFFER[MAX_TX_SIZE], RC_BUFFER[MAX_RC_SIZE];
-unsigned char TX_HEAD, TX_TAIL, RC_HEAD, RC_TAIL;
+RING_DECLARE(TX, MAX_TX_SIZE);
+RING_DECLARE(RC, MAX_RC_SIZE);
+static FrameDrops TX_DROPS; // frames and bytes that did not fit in the TX buffer (producer only)
+static unsigned char preset = CC110L_PRESET_38K4; // preset applied last
+
+/* Frame being streamed by the GDO0 interrupt (see CC110L_StartStream) */
+static unsigned char* streamData;				// next byte of the frame
+static unsigned char streamLeft;				// bytes of the frame still to write
+static volatile unsigned int STREAM_FRAMES;		// frames written whole to the TX FIFO
+
+/* Radio packet being batched (see CC110L_TX_SendBatch) */
+static unsigned char PACKET[CC110L_MAX_PAYLOAD];
+static unsigned char packetLength;				// bytes in the packet, 0 while it is empty
+static unsigned char packetReady;				// the packet is closed and waits for the radio
+static unsigned char batchWindow = CC110L_BATCH_FULL; // most frames in a packet
+static unsigned char packetNumber;				// number of the next packet
+
+/* Retransmit window (see CC110L_ARQ_Service) */
+static unsigned char ARQ_PACKETS[CC110L_ARQ_MAX_DEPTH][CC110L_MAX_PAYLOAD];
+static unsigned char ARQ_LENGTH[CC110L_ARQ_MAX_DEPTH];	// size of the packet in each slot
+static unsigned char ARQ_STATE[CC110L_ARQ_MAX_DEPTH];	// ARQ_FREE, ARQ_PENDING, ARQ_SENT or ARQ_LOST
+static unsigned char arqDepth = CC110L_ARQ_OFF;	// slots in use at most
+static unsigned int arqDeadline;				// frames after which a packet is given up
+static unsigned int arqAckTimeout;				// ticks to wait for an acknowledgement
+static unsigned char arqPolling;				// a burst was sent and its acknowledgement is due
+static unsigned int arqPollTick;				// tick at which its last packet (the poll) was sent
+static FrameDrops ARQ_DROPS;					// frames and bytes given up
+static unsigned int ARQ_RETRANSMISSIONS;		// packets sent more than once
+
+/* Radio presets, IOCFG2 through TEST0 in register order (the reserved registers
+ * in between get their recommended values, so the table goes out in one burst) */
+static rom const unsigned char PRESETS[CC110L_NUM_PRESETS][CC110L_CONFIG_SIZE] = {
+	
+	/* CC110L_PRESET_38K4: GFSK at 38.4 kBaud (DRATE_E 10, DRATE_M 131) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x06,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0xCA,
+	/* MDMCFG3  */ 0x83,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_GFSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x35,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x16,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0x43,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0x91,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0x56,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xE9,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x81,
+	/* TEST1    */ 0x35,
+	/* TEST0    */ 0x09
+	},
+	
+	/* CC110L_PRESET_76K8: GFSK at 76.8 kBaud (DRATE_E 11, DRATE_M 131) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x08,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0x7B,
+	/* MDMCFG3  */ 0x83,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_GFSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x42,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x16,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0x43,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0x91,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0x56,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xE9,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x81,
+	/* TEST1    */ 0x35,
+	/* TEST0    */ 0x09
+	},
+	
+	/* CC110L_PRESET_250K: GFSK at 250 kBaud (DRATE_E 13, DRATE_M 59) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x0C,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0x2D,
+	/* MDMCFG3  */ 0x3B,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_GFSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x62,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x1D,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0xC7,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0xB0,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0xB6,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xEA,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x88,
+	/* TEST1    */ 0x31,
+	/* TEST0    */ 0x09
+	},
+	
+	/* CC110L_PRESET_500K: 2-FSK at 500 kBaud (DRATE_E 14, DRATE_M 59) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x0E,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0x0E,
+	/* MDMCFG3  */ 0x3B,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_2FSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x62,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x1D,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0xC7,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0xB0,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0xB6,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xEA,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x88,
+	/* TEST1    */ 0x31,
+	/* TEST0    */ 0x09
+	}
+};
 
 /******************************************************************************/
 /* FUNCTIONS																  */
@@ -35,41 +280,460 @@ unsigned char TX_HEAD, TX_TAIL, RC_HEAD, RC_TAIL;
  *
  * @param None.
  * 
- * @return None.
+ * @return 0 - the SPI did not initialize, 1 - initialized.
 *******************************************************************************/
 unsigned char CC110L_Initialize() {
     unsigned char status, i;
     
     /* Initialize the SPI communication */
     status = CommCC110L_Initialize();
+    if (!status) { return 0; }
     
     /* Initialize the RC and TX buffers */
-    RC_HEAD = RC_TAIL = TX_HEAD = TX_TAIL = 0;
+    RING_CLEAR(RC);
+    RING_CLEAR(TX);
     for (i = 0; i < MAX_RC_SIZE; i = i + 1) { RC_BUFFER[i] = 0; }
     
     return 1;
 }
 
+/******************************************************************************/
+/* Register Functions														  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Sends a command strobe to the CC110L (radio mode).
+ *
+ * @param strobe - One of the CC110L command strobes (CC110L_SRES to CC110L_SNOP).
+ * 
+ * @return Chip status byte (state in bits 6-4, FIFO bytes in bits 3-0).
+*******************************************************************************/
+unsigned char CC110L_Strobe(unsigned char strobe) {
+	unsigned char status;
+	
+	CommCC110L_Select();
+	status = CommCC110L_Exchange(strobe);
+	CommCC110L_Deselect();
+	
+	return status;
+}
+
+/***************************************************************************//**
+ * @brief Writes data to the registers of the CC110L (radio mode). More than 
+ *        one register is written in a single burst: one header byte with the
+ *        burst bit and then the values, under one CS. For the 47 registers of
+ *        a preset that is 48 bytes instead of 94 bytes and 47 CS cycles.
+ *
+ * @param address - Char denoting the initial address to write to.
+ * @param writeNum - Char denoting the number of registers to write.
+ * @param regVals - Pointer to the array containing the values to write.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_WriteRegisters(unsigned char address, 
+						   unsigned char writeNum, 
+						   unsigned char* regVals) {
+	unsigned char i;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(address | ((writeNum > 1) ? CC110L_WRITE_BURST : CC110L_WRITE_SINGLE));
+	for (i = 0; i < writeNum; i = i + 1) { CommCC110L_Exchange(regVals[i]); }
+	CommCC110L_Deselect();
+}
+
+/***************************************************************************//**
+ * @brief Reads data from the registers of the CC110L (radio mode), in a 
+ *        single burst when there is more than one.
+ *
+ * @param address - Char denoting the initial address to read from.
+ * @param readNum - Char denoting the number of registers to read.
+ * @param regVals - Pointer to the array storing the read register data.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_ReadRegisters(unsigned char address, 
+						  unsigned char readNum, 
+						  unsigned char* regVals) {
+	unsigned char i;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(address | ((readNum > 1) ? CC110L_READ_BURST : CC110L_READ_SINGLE));
+	for (i = 0; i < readNum; i = i + 1) { regVals[i] = CommCC110L_Exchange(0x00); }
+	CommCC110L_Deselect();
+}
+
+/***************************************************************************//**
+ * @brief Reads a status register of the CC110L (radio mode). The status 
+ *        registers share their addresses with the command strobes, so they
+ *        are read with the burst bit set.
+ *
+ * @param address - One of the status registers (CC110L_PARTNUM to CC110L_RXBYTES).
+ * 
+ * @return Value of the status register.
+*******************************************************************************/
+unsigned char CC110L_ReadStatus(unsigned char address) {
+	unsigned char value;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(address | CC110L_READ_BURST);
+	value = CommCC110L_Exchange(0x00);
+	CommCC110L_Deselect();
+	
+	return value;
+}
+
+/***************************************************************************//**
+ * @brief Resets the CC110L (radio mode) with the manual power-on sequence: CS
+ *        is strobed low and held high for 40 us before the SRES strobe. The 
+ *        next access waits for the chip to be ready again.
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_Reset() {
+	CommCC110L_Select();
+	CommCC110L_Deselect();
+	CLOCK_DELAY_US(RESET_US);
+	CC110L_Strobe(CC110L_SRES);
+}
+
+/***************************************************************************//**
+ * @brief Configures the CC110L radio: switches SSP2 to radio mode, resets 
+ *        the chip and writes a preset from IOCFG2 to TEST0 with a single 
+ *        burst, then the output power. The chip is left in the Idle state.
+ *
+ * @param newPreset - One of the CC110L_PRESET_* values.
+ * @param verify - 1 to read the registers back and compare them.
+ * 
+ * @return 1 - preset applied (and verified), 0 - unknown preset or mismatch.
+*******************************************************************************/
+unsigned char CC110L_ApplyPreset(unsigned char newPreset,
+								 unsigned char verify) {
+	unsigned char writeVals[CC110L_CONFIG_SIZE];
+	unsigned char paPower = PA_POWER;
+	unsigned char i;
+	
+	/* Check the preset */
+	if (newPreset >= CC110L_NUM_PRESETS) { return 0; }
+	preset = newPreset;
+	
+	/* Take the SPI as master and start from the reset values */
+	CommCC110L_InitializeRadio();
+	CC110L_Reset();
+	
+	/* Copy the preset out of program memory and send it in one burst */
+	for (i = 0; i < CC110L_CONFIG_SIZE; i = i + 1) { writeVals[i] = PRESETS[preset][i]; }
+	CC110L_WriteRegisters(CC110L_IOCFG2, CC110L_CONFIG_SIZE, writeVals);
+	CC110L_WriteRegisters(CC110L_PATABLE, 1, &paPower);
+	
+	/* Read the registers back */
+	if (verify) { return CC110L_VerifyRegisters(); }
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Reads the configuration registers back in one burst and compares 
+ *        them with the preset applied last. FSCAL3 to FSCAL0 hold the results
+ *        of the frequency synthesizer calibration and are not compared.
+ *
+ * @param None.
+ * 
+ * @return 1 - registers match the preset, 0 - mismatch.
+*******************************************************************************/
+unsigned char CC110L_VerifyRegisters() {
+	unsigned char regVals[CC110L_CONFIG_SIZE];
+	unsigned char i;
+	
+	/* Read all the configuration registers */
+	CC110L_ReadRegisters(CC110L_IOCFG2, CC110L_CONFIG_SIZE, regVals);
+	
+	/* Compare the registers that only change when they are written */
+	for (i = 0; i < CC110L_CONFIG_SIZE; i = i + 1) {
+		if ((i >= CC110L_FSCAL3) && (i <= CC110L_FSCAL0)) { continue; }
+		if (regVals[i] != PRESETS[preset][i]) { return 0; }
+	}
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Writes bytes to the TX FIFO of the CC110L (radio mode) in one burst:
+ *        a single header byte (0x7F) and then the bytes, under one CS. A byte 
+ *        at a time costs a header per byte (100% command overhead); a full 
+ *        packet of 61 bytes and its length byte costs one header in 63 bytes
+ *        (under 2%).
+ *
+ * @param data - Data represents the write buffer.
+ * @param bytesNumber - Number of bytes to write (the TX FIFO holds 64).
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_WriteFifo(unsigned char* data, 
+					  unsigned char bytesNumber) {
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_WRITE_BURST);
+	while (bytesNumber-- != 0) { CommCC110L_Exchange(*data++); }
+	CommCC110L_Deselect();
+}
+
+/***************************************************************************//**
+ * @brief Reads bytes from the RX FIFO of the CC110L (radio mode) in one burst:
+ *        a single header byte (0xFF) and then the bytes, under one CS.
+ *
+ * @param data - Data represents the read buffer.
+ * @param bytesNumber - Number of bytes to read (check RXBYTES first).
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_ReadFifo(unsigned char* data, 
+					 unsigned char bytesNumber) {
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_READ_BURST);
+	while (bytesNumber-- != 0) { *data++ = CommCC110L_Exchange(0x00); }
+	CommCC110L_Deselect();
+}
+
+/***************************************************************************//**
+ * @brief Checks if the CC110L is back in the Idle state, which the presets 
+ *        enter once a packet has been sent or received (TXOFF_MODE and 
+ *        RXOFF_MODE). A TX FIFO underflow or RX FIFO overflow is flushed 
+ *        here, which also returns the chip to Idle.
+ *
+ * @param None.
+ * 
+ * @return 1 - the chip is idle, 0 - the chip is busy.
+*******************************************************************************/
+unsigned char CC110L_isIdle() {
+	unsigned char state = CC110L_ReadStatus(CC110L_MARCSTATE);
+	
+	if (state == CC110L_MARCSTATE_TXFIFO_UNDERFLOW) {
+		CC110L_Strobe(CC110L_SFTX);
+		return 1;
+	}
+	if (state == CC110L_MARCSTATE_RXFIFO_OVERFLOW) {
+		CC110L_Strobe(CC110L_SFRX);
+		return 1;
+	}
+	
+	return (state == CC110L_MARCSTATE_IDLE);
+}
+
+/******************************************************************************/
+/* Streaming Functions														  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Writes the next CC110L_STREAM_REFILL bytes of the stream to the TX 
+ *        FIFO in one burst. Each frame goes out as its length byte and then
+ *        its bytes, and may be split across refills. When the frame queue is
+ *        empty a zero length byte is written instead, so the FIFO is always 
+ *        topped up by the same amount and never runs dry.
+ *        
+ *        The refill runs in the low priority interrupt, like the frame read,
+ *        and takes about 100 us. A frame read raised meanwhile is run between
+ *        two bytes of the burst (the CC110L keeps CSn low and waits for SCLK), 
+ *        so the refill holds a read off by one byte at most (see 
+ *        ADS1298_TCY_LOW_HOLDOFF).
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+static void CC110L_StreamRefill() {
+	unsigned char i;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_WRITE_BURST);
+	for (i = 0; i < CC110L_STREAM_REFILL; i = i + 1) {
+		
+		/* Yield to a pending frame read */
+		if (ADS1298_READ_INTERRUPT) { ADS1298_ReadISR(); }
+		
+		/* Continue the frame */
+		if (streamLeft != 0) {
+			CommCC110L_Exchange(*streamData++);
+			
+			/* The frame is all in the FIFO, so its slot can be reused */
+			if (--streamLeft == 0) {
+				ADS1298_ReleaseFrame();
+				STREAM_FRAMES = STREAM_FRAMES + 1;
+			}
+			continue;
+		}
+		
+		/* Start the next frame, or fill in while there is none */
+		streamData = ADS1298_PeekFrame(&streamLeft);
+		if (streamData == 0) { streamLeft = 0; }
+		CommCC110L_Exchange((streamData == 0) ? CC110L_STREAM_FILLER : streamLeft);
+	}
+	CommCC110L_Deselect();
+}
+
+/***************************************************************************//**
+ * @brief Starts streaming the ADS1298 frame queue over the CC110L (radio mode)
+ *        as one packet of infinite length. The TX FIFO is filled and GDO0 is
+ *        set to the TX FIFO threshold: it falls when the FIFO drains below 
+ *        CC110L_STREAM_THRESHOLD bytes and the INT1 interrupt writes 
+ *        CC110L_STREAM_REFILL more, which takes the FIFO back up to 63 bytes
+ *        and GDO0 back high. TXBYTES is never polled.
+ *
+ *        At 500 kBaud the 32 bytes left at the interrupt last 512 us, which 
+ *        covers the refill (about 100 us at the SPI clock of CLOCK_RADIO_SCLK_MAX)
+ *        with frame reads run in between its bytes. INT1 is low priority,
+ *        like the frame read interrupt, so only one of them touches the frame
+ *        queue at a time; the main loop must not use ADS1298_PeekFrame or the
+ *        radio while streaming.
+ *
+ * @param None.
+ * 
+ * @return 1 - streaming, 0 - the chip is busy.
+*******************************************************************************/
+unsigned char CC110L_StartStream() {
+	unsigned char regVal;
+	
+	if (!CC110L_isIdle()) { return 0; }
+	
+	/* GDO0 follows the TX FIFO threshold, the packet never ends */
+	regVal = CC110L_GDOCFG_TXFIFO_THR;
+	CC110L_WriteRegisters(CC110L_IOCFG0, 1, &regVal);
+	regVal = CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_LENGTH_INFINITE;
+	CC110L_WriteRegisters(CC110L_PKTCTRL0, 1, &regVal);
+	
+	/* Fill the TX FIFO before starting to transmit */
+	CC110L_Strobe(CC110L_SFTX);
+	streamLeft = 0;
+	STREAM_FRAMES = 0;
+	CC110L_StreamRefill();
+	CC110L_StreamRefill();
+	
+	/* Refill on the falling edge of GDO0 */
+	CommCC110L_GDO_INT_EDGE     = 0;
+	CommCC110L_GDO_INT_PRIORITY = 0;
+	CommCC110L_GDO_INTERRUPT    = 0;
+	CommCC110L_GDO_INT_ENABLE   = 1;
+	CC110L_Strobe(CC110L_STX);
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Stops streaming: the transmission is cut off, the TX FIFO is flushed
+ *        and the packet mode of the preset is restored. A frame that was only
+ *        partly written is lost.
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_StopStream() {
+	unsigned char regVal;
+	
+	CommCC110L_GDO_INT_ENABLE = 0;
+	CC110L_Strobe(CC110L_SIDLE);
+	CC110L_Strobe(CC110L_SFTX);
+	
+	/* Give the slot of a partly written frame back */
+	if (streamLeft != 0) {
+		ADS1298_ReleaseFrame();
+		streamLeft = 0;
+	}
+	
+	/* Back to the packets of the preset */
+	regVal = PRESETS[preset][CC110L_IOCFG0];
+	CC110L_WriteRegisters(CC110L_IOCFG0, 1, &regVal);
+	regVal = PRESETS[preset][CC110L_PKTCTRL0];
+	CC110L_WriteRegisters(CC110L_PKTCTRL0, 1, &regVal);
+}
+
 /***************************************************************************//**
- * @brief Increment the specified index and check if the end of the buffer has
- *        been reached. If the end has been reached, the index is wrapped back 
- *        around to the beginning of the buffer.
+ * @brief Gets the number of frames written whole to the TX FIFO since 
+ *        CC110L_StartStream.
  *
- * @param idx - Index that you desire to increment.
- * @param max - Maximum index that you can go to (buffer size).
+ * @param None.
  * 
- * @return Incremented index value.
+ * @return Number of frames streamed.
 *******************************************************************************/
-unsigned char CC110L_IncrementIndex(unsigned char idx, 
-									unsigned char max) {
-	if (++idx == max) { idx = 0; } // increment index; and if buffer end reached, start from beginning
-	return idx; // return the index
+unsigned int CC110L_GetStreamFrames() {
+	unsigned int frames, check;
+	
+	/* A refill can change the count between its two bytes, so read it until it is stable */
+	frames = STREAM_FRAMES;
+	do {
+		check = frames;
+		frames = STREAM_FRAMES;
+	} while (frames != check);
+	
+	return frames;
+}
+
+/***************************************************************************//**
+ * @brief Interrupt service routine for the TX FIFO threshold on GDO0 (INT1).
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_StreamISR() {
+	if (CommCC110L_GDO_INTERRUPT & CommCC110L_GDO_INT_ENABLE) {
+		CommCC110L_GDO_INTERRUPT = 0;
+		CC110L_StreamRefill();
+	}
 }
 
 /******************************************************************************/
 /* Receive Functions														  */
 /******************************************************************************/
 
+/***************************************************************************//**
+ * @brief Reads a packet from the RX FIFO of the CC110L (radio mode): the 
+ *        length byte, the payload and the 2 appended status bytes in one 
+ *        burst. The packet is only read once the chip is back in Idle, so it
+ *        is all in the FIFO. A packet that does not fit the buffer or fails 
+ *        the CRC is dropped.
+ *
+ * @param pData - Pointer to the buffer storing the payload.
+ * @param maxLength - Size of the buffer.
+ * 
+ * @return Size of the payload, 0 if there was no whole packet or it was dropped.
+*******************************************************************************/
+unsigned char CC110L_RC_ReadPacket(unsigned char* pData, 
+								   unsigned char maxLength) {
+	unsigned char count, check, length, status;
+	
+	/* Wait for the end of the packet */
+	if (!CC110L_isIdle()) { return 0; }
+	
+	/* RXBYTES can change while it is read, so read it until it is stable */
+	count = CC110L_ReadStatus(CC110L_RXBYTES);
+	do {
+		check = count;
+		count = CC110L_ReadStatus(CC110L_RXBYTES);
+	} while (count != check);
+	if (count & CC110L_BYTES_OVERFLOW) { CC110L_isIdle(); return 0; }
+	if (count == 0) { return 0; }
+	
+	/* Read the length and, if the packet is all there, the rest of it */
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_READ_BURST);
+	length = CommCC110L_Exchange(0x00);
+	if ((length > maxLength) || (length > CC110L_MAX_PAYLOAD) || (count < (length + 3))) {
+		CommCC110L_Deselect();
+		CC110L_Strobe(CC110L_SFRX); // drop the rest of the packet
+		return 0;
+	}
+	for (count = 0; count < length; count = count + 1) { pData[count] = CommCC110L_Exchange(0x00); }
+	CommCC110L_Exchange(0x00); // RSSI
+	status = CommCC110L_Exchange(0x00); // LQI and CRC_OK
+	CommCC110L_Deselect();
+	
+	/* Drop a packet with a bad CRC */
+	if ((status & CC110L_LQI_CRCOK) == 0) { return 0; }
+	
+	return length;
+}
+
 /***************************************************************************//**
  * @brief Stores the new character that is received on the serial communication
  *        into the input buffer.
@@ -79,14 +743,8 @@ unsigned char CC110L_IncrementIndex(unsigned char idx,
  * @return None.
 *******************************************************************************/
 void CC110L_RC_WriteBuffer(unsigned char data) {
-	/* Write the data to the current head of the buffer */
-	RC_BUFFER[RC_HEAD] = data;
-	
-	/* Increment the head of the buffer */
-	RC_HEAD = CC110L_IncrementIndex(RC_HEAD, MAX_RC_SIZE);
-	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (RC_HEAD == RC_TAIL) { RC_TAIL = CC110L_IncrementIndex(RC_TAIL, MAX_RC_SIZE); }
+	/* Write the data to the head of the buffer (the byte is dropped when full) */
+	RING_PUT(RC, data);
 }
 
 /***************************************************************************//**
@@ -99,17 +757,8 @@ void CC110L_RC_WriteBuffer(unsigned char data) {
 unsigned char CC110L_RC_ReadBuffer() {
 	unsigned char data;
 	
-	/* Temporarily disable the interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
 	/* Read the data from the end of the buffer */
-	data = RC_BUFFER[RC_TAIL];
-	
-	/* Increment the tail of the buffer */
-	RC_TAIL = CC110L_IncrementIndex(RC_TAIL, MAX_RC_SIZE);
-	
-	/* Re-enable the interrupt */
-	INTERRUPT_GLOBAL = 1;
+	RING_GET(RC, data);
 	
 	return data;
 }
@@ -141,7 +790,7 @@ unsigned char CC110L_RC_ReadByte() {
  * @return 1 - data is available to be read, 0 - data is not available.
 *******************************************************************************/
 unsigned char CC110L_RC_isDataAvailable() {
-	return (RC_HEAD != RC_TAIL);
+	return !RING_isEMPTY(RC);
 }
 
 /***************************************************************************//**
@@ -152,7 +801,7 @@ unsigned char CC110L_RC_isDataAvailable() {
  * @return None.
 *******************************************************************************/
 void CC110L_RC_Clear() {
-	RC_HEAD = RC_TAIL = 0; // reset the head and the tail to the beginning of the buffer
+	RING_FLUSH(RC); // drop the unread data (the consumer moves the tail up to the head)
 }
 
 /******************************************************************************/
@@ -167,69 +816,524 @@ void CC110L_RC_Clear() {
  * @return None.
 *******************************************************************************/
 void CC110L_TX_WriteBuffer(unsigned char data) {
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
+	/* Write the data to the head of the buffer (the byte is dropped when full) */
+	RING_PUT(TX, data);
+}
+
+/***************************************************************************//**
+ * @brief Puts multiple bytes of data into the transmit buffer. The bytes are
+ *        queued whole or not at all, so a full buffer never cuts a frame.
+ *
+ * @param data - Pointer to the bytes to write.
+ * @param bytesNumber - Number of bytes to write.
+ * 
+ * @return 1 - the bytes were queued, 0 - the bytes did not fit and were dropped.
+*******************************************************************************/
+unsigned char CC110L_TX_WriteBufferMultiple(unsigned char* data,
+											unsigned char bytesNumber) {
+	/* Frames are binary, so the length is explicit (a 0x00 sample is data) */
+	if (bytesNumber > RING_SPACE(TX)) { return 0; }
 	
-	/* Write the data to the current head of the buffer */
-	TX_BUFFER[TX_HEAD] = data;
+	/* Copy the bytes to the head of the buffer in at most two runs */
+	RING_WRITE(TX, data, bytesNumber);
 	
-	/* Increment the head of the buffer */
-	TX_HEAD = CC110L_IncrementIndex(TX_HEAD, MAX_TX_SIZE);
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Queues one frame in the transmit buffer, for CC110L_TX_SendFrames 
+ *        to send to the relay as one length-prefixed burst. The frame goes in 
+ *        whole or not at all: a frame that does not fit is dropped and added
+ *        to the transmit drops (see CC110L_TX_GetDrops). The copy is at most
+ *        two block copies and the head is stored once after it, so the 
+ *        consumer never sees part of a frame and no interrupts are masked.
+ *
+ * @param data - Pointer to the frame.
+ * @param frameSize - Size of the frame.
+ * 
+ * @return 1 - the frame was queued, 0 - the frame did not fit and was dropped.
+*******************************************************************************/
+unsigned char CC110L_TX_WriteBufferFrame(unsigned char* data,  
+										 unsigned char frameSize) {
+	/* The frame goes in whole or not at all */
+	if (frameSize > RING_SPACE(TX)) {
+		TX_DROPS.frames = TX_DROPS.frames + 1;
+		TX_DROPS.bytes = TX_DROPS.bytes + frameSize;
+		return 0;
+	}
 	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (TX_HEAD == TX_TAIL) { TX_TAIL = CC110L_IncrementIndex(TX_TAIL, MAX_RC_SIZE); }
+	/* Copy the frame and publish it with a single store of the head */
+	RING_WRITE(TX, data, frameSize);
 	
-	/* Re-enable the interrupts */
-	INTERRUPT_GLOBAL = 1;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Gets the running totals of the frames and bytes that did not fit in
+ *        the transmit buffer.
+ *
+ * @param pDrops - Pointer to the structure storing the totals.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_TX_GetDrops(FrameDrops* pDrops) {
+	*pDrops = TX_DROPS;
+}
+
+/***************************************************************************//**
+ * @brief Sends one frame straight from its ADS1298 frame slot as one burst,
+ *        without going through the TX buffer.
+ *
+ * @param pFrame - Pointer to the frame (see ADS1298_PeekFrame).
+ * @param frameSize - Number of bytes in the frame.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_TX_SendFrame(unsigned char* pFrame, 
+						 unsigned char frameSize) {
+	/* Announce the burst and wait for the relay to start clocking it */
+	CommCC110L_BeginBurst(frameSize);
+	
+	/* Clock the frame out of the slot as the relay reads it */
+	CommCC110L_WriteBurst(pFrame, frameSize);
+}
+
+/***************************************************************************//**
+ * @brief Starts sending a frame straight from its frame slot. The SSP2 
+ *        interrupt clocks it out, so the slot must not be released before
+ *        CC110L_TX_isBusy returns 0.
+ *
+ * @param pFrame - Pointer to the frame.
+ * @param frameSize - Size of the frame.
+ * 
+ * @return 1 - the frame is being sent, 0 - the last frame is still being sent.
+*******************************************************************************/
+unsigned char CC110L_TX_StartFrame(unsigned char* pFrame, 
+								   unsigned char frameSize) {
+	return CommCC110L_StartBurst(pFrame, frameSize);
+}
+
+/***************************************************************************//**
+ * @brief Checks if a frame started with CC110L_TX_StartFrame is still being 
+ *        sent.
+ *
+ * @param None.
+ * 
+ * @return 1 - the frame is being sent, 0 - the link is free.
+*******************************************************************************/
+unsigned char CC110L_TX_isBusy() {
+	return CommCC110L_isBusy();
+}
+
+/***************************************************************************//**
+ * @brief Sends a packet over the CC110L (radio mode): the length byte and the
+ *        payload go into the TX FIFO with one burst write (one header byte 
+ *        for the whole packet), then STX starts the transmission. The chip 
+ *        returns to Idle by itself once the packet is out.
+ *
+ * @param pData - Pointer to the payload (an aggregated packet of frames).
+ * @param length - Size of the payload (up to CC110L_MAX_PAYLOAD).
+ * 
+ * @return 1 - the packet is being sent, 0 - too long or the last one is still 
+ *         being sent.
+*******************************************************************************/
+unsigned char CC110L_TX_SendPacket(unsigned char* pData, 
+								   unsigned char length) {
+	if ((length == 0) || (length > CC110L_MAX_PAYLOAD)) { return 0; }
+	if (!CC110L_isIdle()) { return 0; }
+	
+	/* Fill the TX FIFO in one burst and start transmitting */
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_WRITE_BURST);
+	CommCC110L_Exchange(length);
+	while (length-- != 0) { CommCC110L_Exchange(*pData++); }
+	CommCC110L_Deselect();
+	CC110L_Strobe(CC110L_STX);
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Sets the batching window: the number of frames a radio packet waits
+ *        for before it is sent. Preamble, sync word, length and CRC take 11 
+ *        bytes of airtime for every packet, so one frame per packet spends 
+ *        more time on them than on the samples of a small frame, while every
+ *        frame in the window adds one conversion period of latency to the
+ *        first one. A packet also goes out early once the next frame does 
+ *        not fit, or starts a new batch (see the packet format in Frame.h).
+ *
+ * @param window - Frames per packet, 1 for the lowest latency up to 
+ *                 CC110L_BATCH_FULL for the most frames per packet.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_SetBatchWindow(unsigned char window) {
+	batchWindow = (window == 0) ? 1 : window;
 }
 
 /***************************************************************************//**
- * @brief Puts multiple bytes of data into the transmit buffer.
+ * @brief Empties the radio packet being batched, for a new acquisition.
  *
  * @param None.
  * 
  * @return None.
 *******************************************************************************/
-void CC110L_TX_WriteBufferMultiple(unsigned char* data) {
-	/* Iterate through the data */
-	while (*data != 0x00) { // while there is still data in the vector
+void CC110L_TX_ClearBatch() {
+	PACKET[FRAME_PACKET_COUNT] = 0;
+	packetLength = 0;
+	packetReady = 0;
+}
+
+/***************************************************************************//**
+ * @brief Moves queued frames into the radio packet being batched and sends 
+ *        it with CC110L_TX_SendPacket once the batching window is reached, 
+ *        the next frame does not fit or belongs to a new batch. Each frame
+ *        is copied without its channel bitmaps and sequence number, which 
+ *        the packet header holds once, and its slot is released right away.
+ *        A frame that has to wait for the next packet stays claimed at the
+ *        tail of the queue. Call it from the main loop; it does not block.
+ *
+ * @param flush - 1 to send the packet without waiting for the window.
+ * 
+ * @return Number of frames in the packet sent, 0 if none was sent.
+*******************************************************************************/
+unsigned char CC110L_TX_SendBatch(unsigned char flush) {
+	unsigned char* pFrame;
+	unsigned char length, count;
+	unsigned int sequence;
+	
+	/* Fill the packet until the window is reached */
+	while (!packetReady && (PACKET[FRAME_PACKET_COUNT] < batchWindow)) {
+		pFrame = ADS1298_PeekFrame(&length);
+		if (pFrame == 0) { break; }
+		sequence = FRAME_GET_WORD(pFrame, FRAME_SEQUENCE);
+		count = PACKET[FRAME_PACKET_COUNT];
 		
-		/* Write the data to the buffer */
-		CC110L_TX_WriteBuffer(*data);
+		/* Start a packet with the header of its first frame */
+		if (packetLength == 0) {
+			FRAME_SET_WORD(PACKET, FRAME_PACKET_SEQUENCE, sequence);
+			PACKET[FRAME_PACKET_COUNT] = count = 0;
+			PACKET[FRAME_PACKET_CHANNELS1] = pFrame[FRAME_CHANNELS1];
+			PACKET[FRAME_PACKET_CHANNELS2] = pFrame[FRAME_CHANNELS2];
+			PACKET[FRAME_PACKET_NUMBER] = packetNumber & FRAME_PACKET_NUMBER_MASK;
+			packetLength = FRAME_PACKET_HEADER_SIZE;
+		}
 		
-		/* Increment the data address */
-		data = data + 1;
+		/* Close the packet when the frame belongs to the next one */
+		else if ((sequence != (FRAME_GET_WORD(PACKET, FRAME_PACKET_SEQUENCE) + count)) ||
+				 (pFrame[FRAME_CHANNELS1] != PACKET[FRAME_PACKET_CHANNELS1]) ||
+				 (pFrame[FRAME_CHANNELS2] != PACKET[FRAME_PACKET_CHANNELS2]) ||
+				 ((packetLength + FRAME_PACKED_SIZE(length)) > CC110L_MAX_PAYLOAD)) {
+			packetReady = 1;
+			break;
+		}
+		
+		/* Copy the format, flags, tick and samples and free the slot */
+		PACKET[packetLength++] = pFrame[FRAME_FORMAT];
+		PACKET[packetLength++] = pFrame[FRAME_FLAGS];
+		for (pFrame = pFrame + FRAME_TICK; length > FRAME_TICK; length = length - 1) {
+			PACKET[packetLength++] = *pFrame++;
+		}
+		ADS1298_ReleaseFrame();
+		PACKET[FRAME_PACKET_COUNT] = count + 1;
 	}
+	
+	/* Send the packet once it is closed, as soon as the radio (or the 
+	 * retransmit window) is free */
+	if (packetLength == 0) { return 0; }
+	if (flush || (PACKET[FRAME_PACKET_COUNT] >= batchWindow)) { packetReady = 1; }
+	if (!packetReady) { return 0; }
+	if (arqDepth == CC110L_ARQ_OFF) {
+		if (!CC110L_TX_SendPacket(PACKET, packetLength)) { return 0; }
+	} else {
+		if (!CC110L_ARQ_Send(PACKET, packetLength)) { return 0; }
+	}
+	
+	count = PACKET[FRAME_PACKET_COUNT];
+	packetNumber = packetNumber + 1;
+	CC110L_TX_ClearBatch();
+	return count;
+}
+
+/******************************************************************************/
+/* Retransmission Functions													  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Sets up the selective-repeat retransmission of the radio packets and
+ *        empties the retransmit window. Call it after CC110L_ApplyPreset: the
+ *        radio is set to go from TX straight to RX, so the acknowledgement 
+ *        of the relay (see Frame.h) is not missed, and back to Idle once it 
+ *        is in.
+ *
+ *        A packet stays in the window until the relay acknowledges it or it
+ *        falls more than the deadline behind the live data, when it is given
+ *        up (and counted as dropped) so that a bad link never stalls the 
+ *        stream. The deadline is the data latency the host can accept, in 
+ *        conversion periods. The acknowledgement timeout covers the airtime 
+ *        of the longest packet and of the acknowledgement and the turnaround
+ *        of the relay, about 25 ms at 38.4 kBaud and 3 ms at 500 kBaud; it is
+ *        at most 32 ms (the frame tick wraps).
+ *
+ * @param depth - Packets kept for retransmission (up to CC110L_ARQ_MAX_DEPTH),
+ *                CC110L_ARQ_OFF to send every packet once.
+ * @param deadline - Frames after which a packet is given up.
+ * @param ackTimeout - Ticks to wait for an acknowledgement 
+ *                     (CC110L_ARQ_TICKS_PER_MS per millisecond).
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_ARQ_Configure(unsigned char depth, 
+						  unsigned int deadline, 
+						  unsigned int ackTimeout) {
+	unsigned char regVal = PRESETS[preset][CC110L_MCSM1];
+	
+	arqDepth = (depth > CC110L_ARQ_MAX_DEPTH) ? CC110L_ARQ_MAX_DEPTH : depth;
+	arqDeadline = deadline;
+	arqAckTimeout = ackTimeout;
+	CC110L_ARQ_Clear();
+	
+	/* Listen for the acknowledgement as soon as the packet is out */
+	if (arqDepth != CC110L_ARQ_OFF) { regVal = regVal | CC110L_MCSM1_TXOFFMODE_RX; } // 11 sets both TXOFF_MODE bits
+	CC110L_WriteRegisters(CC110L_MCSM1, 1, &regVal);
 }
 
 /***************************************************************************//**
- * @brief Puts one frame of ADS1298 data into the transmit buffer.
+ * @brief Empties the retransmit window and resets its totals, for a new 
+ *        acquisition.
  *
  * @param None.
  * 
  * @return None.
 *******************************************************************************/
-void CC110L_TX_WriteBufferFrame(unsigned char* data,  
-								unsigned char frameSize) {
-	unsigned char dummyIdx, i;
+void CC110L_ARQ_Clear() {
+	unsigned char slot;
 	
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
+	for (slot = 0; slot < CC110L_ARQ_MAX_DEPTH; slot = slot + 1) { ARQ_STATE[slot] = ARQ_FREE; }
+	arqPolling = 0;
+	ARQ_DROPS.frames = ARQ_DROPS.bytes = 0;
+	ARQ_RETRANSMISSIONS = 0;
+}
+
+/***************************************************************************//**
+ * @brief Gives up a packet of the retransmit window and counts its frames
+ *        and bytes as dropped.
+ *
+ * @param slot - Slot of the packet.
+ * 
+ * @return None.
+*******************************************************************************/
+static void CC110L_ARQ_Drop(unsigned char slot) {
+	ARQ_DROPS.frames = ARQ_DROPS.frames + ARQ_PACKETS[slot][FRAME_PACKET_COUNT];
+	ARQ_DROPS.bytes = ARQ_DROPS.bytes + ARQ_LENGTH[slot];
+	ARQ_STATE[slot] = ARQ_FREE;
+}
+
+/***************************************************************************//**
+ * @brief Gives up the packets of the retransmit window that fell more than 
+ *        the deadline behind the live data.
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+static void CC110L_ARQ_Expire() {
+	unsigned int live = ADS1298_GetSequence();
+	unsigned char slot;
 	
-	/* Say that data is not ready */
-	CommCC110L_DRDY_NOT = 1;
+	for (slot = 0; slot < arqDepth; slot = slot + 1) {
+		if (ARQ_STATE[slot] == ARQ_FREE) { continue; }
+		if ((live - FRAME_GET_WORD(ARQ_PACKETS[slot], FRAME_PACKET_SEQUENCE)) <= arqDeadline) { continue; }
+		
+		CC110L_ARQ_Drop(slot);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Frees the packets an acknowledgement holds and marks the other 
+ *        packets sent so far as lost. The acknowledgement answers the poll,
+ *        the last packet of the burst, so every packet sent before it has 
+ *        had its chance.
+ *
+ * @param pAck - Pointer to the acknowledgement (see Frame.h), 0 when it did
+ *               not come or was corrupt.
+ * 
+ * @return None.
+*******************************************************************************/
+static void CC110L_ARQ_Acknowledge(unsigned char* pAck) {
+	unsigned char slot, ahead;
 	
-	/* Check if space is available in the transmit buffer */
-    dummyIdx = TX_HEAD;
-    for (i = 0; i < frameSize; i = i + 1) {
-        dummyIdx = CC110L_IncrementIndex(dummyIdx, MAX_TX_SIZE);
-    }
+	for (slot = 0; slot < arqDepth; slot = slot + 1) {
+		if (ARQ_STATE[slot] != ARQ_SENT) { continue; }
+		if (pAck == 0) {
+			ARQ_STATE[slot] = ARQ_LOST;
+			continue;
+		}
+		
+		/* Packets before the next expected one or set in the bitmap are in */
+		ahead = (ARQ_PACKETS[slot][FRAME_PACKET_NUMBER] - pAck[FRAME_ACK_NEXT]) & FRAME_PACKET_NUMBER_MASK;
+		if ((ahead >= 0x40) || 
+			((ahead != 0) && (ahead < FRAME_ACK_SPAN) && ((pAck[FRAME_ACK_BITMAP] >> (ahead - 1)) & 1))) {
+			ARQ_STATE[slot] = ARQ_FREE;
+		} else {
+			ARQ_STATE[slot] = ARQ_LOST;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief Puts a packet in the retransmit window, numbered as it is. Packets
+ *        past their deadline are given up first to make room, and so are 
+ *        packets FRAME_ACK_SPAN or more numbers behind the new one: an 
+ *        acknowledgement only covers FRAME_ACK_SPAN numbers, and the relay 
+ *        moves its next expected number past them once it sees the new one.
+ *
+ * @param pData - Pointer to the packet (see the radio packets of Frame.h).
+ * @param length - Size of the packet.
+ * 
+ * @return 1 - the packet will be sent, 0 - the window is full.
+*******************************************************************************/
+unsigned char CC110L_ARQ_Send(unsigned char* pData, 
+							  unsigned char length) {
+	unsigned char slot, i, behind;
+	
+	CC110L_ARQ_Expire();
+	for (slot = 0; slot < arqDepth; slot = slot + 1) {
+		if (ARQ_STATE[slot] == ARQ_FREE) { continue; }
+		
+		behind = (pData[FRAME_PACKET_NUMBER] - ARQ_PACKETS[slot][FRAME_PACKET_NUMBER]) & FRAME_PACKET_NUMBER_MASK;
+		if ((behind >= FRAME_ACK_SPAN) && (behind < 0x40)) { CC110L_ARQ_Drop(slot); }
+	}
 	
-	/* Set the DRDY to data ready */
-	CommCC110L_DRDY_NOT = 0;
+	for (slot = 0; slot < arqDepth; slot = slot + 1) {
+		if (ARQ_STATE[slot] != ARQ_FREE) { continue; }
+		
+		for (i = 0; i < length; i = i + 1) { ARQ_PACKETS[slot][i] = pData[i]; }
+		ARQ_LENGTH[slot] = length;
+		ARQ_STATE[slot] = ARQ_PENDING;
+		return 1;
+	}
 	
-	/* Re-enable the interrupts */
-	INTERRUPT_GLOBAL = 1;
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Runs the selective-repeat retransmission from the main loop without
+ *        blocking. The packets of the window that were not sent yet or were
+ *        lost go out back to back, oldest first, so up to the depth of the
+ *        window is in flight at once. The last one of the burst carries the
+ *        poll flag (see Frame.h) and only its acknowledgement is waited for:
+ *        it frees the packets the relay holds and marks the others of the 
+ *        burst as lost, as does a corrupt acknowledgement or its timeout. 
+ *        The relay drops duplicates. Between the packets of a burst the 
+ *        radio enters RX by itself (TXOFF_MODE), so it is put back in Idle.
+ *
+ * @param None.
+ * 
+ * @return 1 - a packet was sent, 0 - waiting for the radio or nothing to send.
+*******************************************************************************/
+unsigned char CC110L_ARQ_Service() {
+	unsigned char ack[FRAME_ACK_SIZE];
+	unsigned char slot, oldest, age, maxAge, waiting;
+	unsigned int now;
+	
+	if (arqDepth == CC110L_ARQ_OFF) { return 0; }
+	
+	/* The tick reads low byte first, which latches the high byte */
+	now = ADS1298_TICK_LOW;
+	now = now | ((unsigned int) ADS1298_TICK_HIGH << 8);
+	
+	/* Wait for the acknowledgement of the burst sent last */
+	if (arqPolling) {
+		if (!CC110L_isIdle()) {
+			if ((now - arqPollTick) < arqAckTimeout) { return 0; }
+			CC110L_Strobe(CC110L_SIDLE);
+			CC110L_Strobe(CC110L_SFRX);
+			CC110L_ARQ_Acknowledge(0);
+		} else if (CC110L_RC_ReadPacket(ack, FRAME_ACK_SIZE) == FRAME_ACK_SIZE) {
+			CC110L_ARQ_Acknowledge(ack);
+		} else {
+			CC110L_ARQ_Acknowledge(0);
+		}
+		arqPolling = 0;
+	}
+	
+	/* No acknowledgement is due after a packet without the poll flag */
+	else if (CC110L_ReadStatus(CC110L_MARCSTATE) == CC110L_MARCSTATE_RX) {
+		CC110L_Strobe(CC110L_SIDLE);
+		CC110L_Strobe(CC110L_SFRX);
+	}
+	
+	/* Drop the stale packets and find the oldest of the others */
+	CC110L_ARQ_Expire();
+	oldest = CC110L_ARQ_MAX_DEPTH;
+	maxAge = 0;
+	waiting = 0;
+	for (slot = 0; slot < arqDepth; slot = slot + 1) {
+		if ((ARQ_STATE[slot] != ARQ_PENDING) && (ARQ_STATE[slot] != ARQ_LOST)) { continue; }
+		waiting = waiting + 1;
+		age = (packetNumber - ARQ_PACKETS[slot][FRAME_PACKET_NUMBER]) & FRAME_PACKET_NUMBER_MASK;
+		if (age >= maxAge) {
+			maxAge = age;
+			oldest = slot;
+		}
+	}
+	if (oldest == CC110L_ARQ_MAX_DEPTH) { return 0; }
+	
+	/* Send it, with the poll flag when it ends the burst */
+	ARQ_PACKETS[oldest][FRAME_PACKET_NUMBER] &= FRAME_PACKET_NUMBER_MASK;
+	if (waiting == 1) { ARQ_PACKETS[oldest][FRAME_PACKET_NUMBER] |= FRAME_PACKET_POLL; }
+	if (!CC110L_TX_SendPacket(ARQ_PACKETS[oldest], ARQ_LENGTH[oldest])) { return 0; }
+	
+	if (ARQ_STATE[oldest] == ARQ_LOST) { ARQ_RETRANSMISSIONS = ARQ_RETRANSMISSIONS + 1; }
+	ARQ_STATE[oldest] = ARQ_SENT;
+	if (waiting == 1) {
+		arqPollTick = now;
+		arqPolling = 1;
+	}
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Checks if the retransmit window still holds packets, waiting to be
+ *        sent or acknowledged.
+ *
+ * @param None.
+ * 
+ * @return 0 - the window is empty (or off), 1 - packets are left.
+*******************************************************************************/
+unsigned char CC110L_ARQ_isPending() {
+	unsigned char slot;
+	
+	for (slot = 0; slot < arqDepth; slot = slot + 1) {
+		if (ARQ_STATE[slot] != ARQ_FREE) { return 1; }
+	}
+	
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Gets the running totals of the frames and bytes given up after their
+ *        deadline (the bytes are those of the packets).
+ *
+ * @param pDrops - Pointer to the structure storing the totals.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_ARQ_GetDrops(FrameDrops* pDrops) {
+	*pDrops = ARQ_DROPS;
+}
+
+/***************************************************************************//**
+ * @brief Gets the number of packets sent again after they were lost.
+ *
+ * @param None.
+ * 
+ * @return Number of retransmissions since CC110L_ARQ_Configure.
+*******************************************************************************/
+unsigned int CC110L_ARQ_GetRetransmissions() {
+	return ARQ_RETRANSMISSIONS;
 }
 
 /***************************************************************************//**
@@ -240,57 +1344,41 @@ void CC110L_TX_WriteBufferFrame(unsigned char* data,
  * @return None.
 *******************************************************************************/
 void CC110L_TX_SendByte() {
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
 	/* Write the data at the end of the transmit buffer to the transmit register */
-	CommCC110L_Write(&TX_BUFFER[TX_TAIL], 1);
+	CommCC110L_Write(&RING_PEEK(TX, 0), 1);
 	
 	/* Increment the tail of the buffer */
-	TX_TAIL = CC110L_IncrementIndex(TX_TAIL, MAX_TX_SIZE);
-	
-	/* Re-enable interrupts */
-	INTERRUPT_GLOBAL = 1;
+	RING_SKIP(TX, 1);
 }
 
 /***************************************************************************//**
- * @brief Outputs a frame of data to the Serial communication line.
+ * @brief Outputs queued frames of data to the relay, one burst per frame.
  *
- * @param None.
+ * @param frameCnt - Maximum number of frames to send.
+ * @param frameSize - Size of each frame.
  * 
  * @return None.
 *******************************************************************************/
 void CC110L_TX_SendFrames(unsigned char frameCnt, unsigned char frameSize) {
-	unsigned char i, j;
-	
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
-	/* Set the DRDY to data not ready */
-	CommCC110L_DRDY_NOT = 1;
+	unsigned char i, tail, run;
 	
 	/* Iterate through the frames */
 	for (i = 0; i < frameCnt; i = i + 1) {
 		
-		/* Iterate through the bytes in the frame */
-		for (j = 0; j < frameSize; j = j + 1) {
-			
-			/* Write the data at the end of the transmit buffer to the transmit register */
-			CommCC110L_Write(&TX_BUFFER[TX_TAIL], 1);
-			
-			/* Increment the tail of the buffer */
-			TX_TAIL = CC110L_IncrementIndex(TX_TAIL, MAX_TX_SIZE);
-			
-			/* If you are overflowing, no data is available */
-			if (!CC110L_TX_isDataAvailable()) {
-				INTERRUPT_GLOBAL = 1;
-				return;
-			}
-		}
+		/* Only whole frames are queued */
+		if (RING_COUNT(TX) < frameSize) { break; }
+		
+		/* Send the frame straight from the buffer in at most two runs */
+		tail = TX_TAIL;
+		run = MAX_TX_SIZE - tail;
+		if (run > frameSize) { run = frameSize; }
+		CommCC110L_BeginBurst(frameSize);
+		CommCC110L_WriteBurst(&TX_BUFFER[tail], run);
+		if (run < frameSize) { CommCC110L_WriteBurst(&TX_BUFFER[0], frameSize - run); }
+		
+		/* Release the frame with a single store of the tail */
+		RING_SKIP(TX, frameSize);
 	}
-	
-	/* Re-enable interrupts */
-	INTERRUPT_GLOBAL = 1;
 }
 
 /***************************************************************************//**
@@ -301,7 +1389,7 @@ void CC110L_TX_SendFrames(unsigned char frameCnt, unsigned char frameSize) {
  * @return 1 - data is available to be transmitted, 0 - data is not available..
 *******************************************************************************/
 unsigned char CC110L_TX_isDataAvailable() {
-	return (TX_HEAD != TX_TAIL);
+	return !RING_isEMPTY(TX);
 }
 
 /***************************************************************************//**
@@ -312,7 +1400,10 @@ unsigned char CC110L_TX_isDataAvailable() {
  * @return None.
 *******************************************************************************/
 void CC110L_TX_Clear() {
-	TX_HEAD = TX_TAIL = 0; // reset the head and the tail to the beginning of the buffer
+	/* The producer may not move the tail, so hold off the consumer */
+	INTERRUPT_GLOBAL = 0;
+	RING_CLEAR(TX); // reset the head and the tail to the beginning of the buffer
+	INTERRUPT_GLOBAL = 1;
 }
 
 /******************************************************************************/
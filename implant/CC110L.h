@@ -7,6 +7,12 @@
 #ifndef CC110L_H
 #define CC110L_H
 
+/******************************************************************************/
+/* INCLUDE FILES        													  */
+/******************************************************************************/
+#include "Clock.h"
+#include "Frame.h"
+
 /******************************************************************************/
 /* CC110L COMMAND STROBES													  */
 /******************************************************************************/
@@ -82,6 +88,67 @@
 #define CC110L_TXBYTES		0x3A
 #define CC110L_RXBYTES		0x3B
 
+/******************************************************************************/
+/* CC110L Multi-byte Registers												  */
+/******************************************************************************/
+#define CC110L_PATABLE		0x3E
+#define CC110L_FIFO			0x3F	// TX FIFO when written, RX FIFO when read
+
+/******************************************************************************/
+/* CC110L STATUS REGISTER BITS												  */
+/******************************************************************************/
+#define CC110L_MARCSTATE_IDLE				0x01	// Main radio control state: Idle
+#define CC110L_MARCSTATE_RX					0x0D	// Main radio control state: RX
+#define CC110L_MARCSTATE_RXFIFO_OVERFLOW	0x11	// Main radio control state: RX FIFO overflow (flush with SFRX)
+#define CC110L_MARCSTATE_TXFIFO_UNDERFLOW	0x16	// Main radio control state: TX FIFO underflow (flush with SFTX)
+#define CC110L_BYTES_OVERFLOW				0x80	// RX FIFO overflow (RXBYTES) or TX FIFO underflow (TXBYTES)
+#define CC110L_BYTES_MASK					0x7F	// Number of bytes in the FIFO
+#define CC110L_LQI_CRCOK					0x80	// CRC of the received packet is OK (second appended status byte)
+
+/******************************************************************************/
+/* CC110L FIFO SIZES														  */
+/******************************************************************************/
+#define CC110L_FIFO_SIZE	64	// bytes in each of the TX and RX FIFOs
+#define CC110L_MAX_PAYLOAD	61	// largest packet that fits the RX FIFO with its length byte and 2 status bytes
+
+/******************************************************************************/
+/* CC110L STREAMING															  */
+/******************************************************************************/
+#define CC110L_STREAM_THRESHOLD	33	// TX FIFO threshold of the presets (FIFOTHR_THRESHOLD_RX32_TX33)
+#define CC110L_STREAM_REFILL	(CC110L_FIFO_SIZE - CC110L_STREAM_THRESHOLD) // bytes written on each GDO0 interrupt
+#define CC110L_STREAM_FILLER	0x00	// zero length byte sent when there is no frame to send
+
+/******************************************************************************/
+/* CC110L PACKET BATCHING													  */
+/******************************************************************************/
+#define CC110L_BATCH_FULL		0xFF	// batching window that only sends full packets (see CC110L_SetBatchWindow)
+
+/******************************************************************************/
+/* CC110L RETRANSMISSION													  */
+/******************************************************************************/
+#define CC110L_ARQ_MAX_DEPTH	4		// packets kept for retransmission (the window fits one 256 byte data bank)
+#define CC110L_ARQ_OFF			0		// window depth that sends every packet once
+#define CC110L_ARQ_TICKS_PER_MS	(1000000ul / CLOCK_TICK_NS)	// frame ticks per millisecond (acknowledgement timeout)
+
+/******************************************************************************/
+/* CC110L SPI HEADER BITS													  */
+/******************************************************************************/
+#define CC110L_WRITE_SINGLE	0x00	// Write one register
+#define CC110L_WRITE_BURST	0x40	// Write registers from the address up, until CS goes high
+#define CC110L_READ_SINGLE	0x80	// Read one register
+#define CC110L_READ_BURST	0xC0	// Read registers from the address up (status registers need it too)
+
+/******************************************************************************/
+/* CC110L CONFIGURATION PRESETS												  */
+/******************************************************************************/
+#define CC110L_CONFIG_SIZE		47	// IOCFG2 through TEST0, reserved registers included
+#define CC110L_NUM_PRESETS		4
+									// Presets stored in program memory (915 MHz, 26 MHz crystal)
+#define CC110L_PRESET_38K4		0	//	0 = GFSK 38.4 kBaud, 20 kHz deviation, 101 kHz RX filter
+#define CC110L_PRESET_76K8		1	//	1 = GFSK 76.8 kBaud, 32 kHz deviation, 232 kHz RX filter
+#define CC110L_PRESET_250K		2	//	2 = GFSK 250 kBaud, 127 kHz deviation, 541 kHz RX filter
+#define CC110L_PRESET_500K		3	//	3 = 2-FSK 500 kBaud, 127 kHz deviation, 812 kHz RX filter (GFSK stops at 250 kBaud)
+
 /******************************************************************************/
 /* CC110L CONFIGURATION REGISTER BITS										  */
 /******************************************************************************/
@@ -102,6 +169,19 @@
 /******************************************************************************/
 #define CC110L_IOCFG0_INV		(0b1 << 6)	// Invert output, select active low (1)	
 
+/******************************************************************************/
+/* CC110L GDO Signal Selection (GDOx_CFG in any IOCFG register)				  */
+/******************************************************************************/
+#define CC110L_GDOCFG_RXFIFO_THR		0x00	// Asserts at or above the RX FIFO threshold
+#define CC110L_GDOCFG_RXFIFO_THR_PKT	0x01	// Asserts at or above the RX FIFO threshold or at the end of a packet
+#define CC110L_GDOCFG_TXFIFO_THR		0x02	// Asserts at or above the TX FIFO threshold, de-asserts below it
+#define CC110L_GDOCFG_TXFIFO_FULL		0x03	// Asserts when the TX FIFO is full
+#define CC110L_GDOCFG_RXFIFO_OVERFLOW	0x04	// Asserts when the RX FIFO has overflowed
+#define CC110L_GDOCFG_TXFIFO_UNDERFLOW	0x05	// Asserts when the TX FIFO has underflowed
+#define CC110L_GDOCFG_SYNC_WORD			0x06	// Asserts at the sync word, de-asserts at the end of the packet
+#define CC110L_GDOCFG_CHIP_RDYN			0x29	// Low when the crystal is running
+#define CC110L_GDOCFG_HIGH_Z			0x2E	// High impedance
+
 /******************************************************************************/
 /* CC110L RX FIFO and TX FIFO Thresholds									  */
 /******************************************************************************/
@@ -354,8 +434,62 @@
 /* Initialize the CC110L chip */
 unsigned char CC110L_Initialize();
 
-/* Increments the index value */
-unsigned char CC110L_IncrementIndex(unsigned char idx, unsigned char max);
+/******************************************************************************/
+/* Register Functions														  */
+/******************************************************************************/
+
+/* Sends a command strobe to the CC110L */
+unsigned char CC110L_Strobe(unsigned char strobe);
+
+/* Writes values to the registers of the CC110L */
+void CC110L_WriteRegisters(unsigned char address, 
+						   unsigned char writeNum, 
+						   unsigned char* regVals);
+
+/* Reads values from the registers of the CC110L */
+void CC110L_ReadRegisters(unsigned char address, 
+						  unsigned char readNum, 
+						  unsigned char* regVals);
+
+/* Reads a status register of the CC110L */
+unsigned char CC110L_ReadStatus(unsigned char address);
+
+/* Resets the CC110L */
+void CC110L_Reset();
+
+/* Configures the CC110L with a preset */
+unsigned char CC110L_ApplyPreset(unsigned char newPreset,
+								 unsigned char verify);
+
+/* Compares the registers of the CC110L with the preset applied last */
+unsigned char CC110L_VerifyRegisters();
+
+/* Writes bytes to the TX FIFO of the CC110L in one burst */
+void CC110L_WriteFifo(unsigned char* data, 
+					  unsigned char bytesNumber);
+
+/* Reads bytes from the RX FIFO of the CC110L in one burst */
+void CC110L_ReadFifo(unsigned char* data, 
+					 unsigned char bytesNumber);
+
+/* Checks if the CC110L is back in the Idle state */
+unsigned char CC110L_isIdle();
+
+/******************************************************************************/
+/* Streaming Functions														  */
+/******************************************************************************/
+
+/* Starts streaming the frame queue in infinite packet length mode */
+unsigned char CC110L_StartStream();
+
+/* Stops streaming and restores the packet mode of the preset */
+void CC110L_StopStream();
+
+/* Gets the number of frames streamed */
+unsigned int CC110L_GetStreamFrames();
+
+/* Interrupt service routine for the TX FIFO threshold on GDO0 */
+void CC110L_StreamISR();
 
 /******************************************************************************/
 /* Receive Functions														  */
@@ -364,6 +498,10 @@ unsigned char CC110L_IncrementIndex(unsigned char idx, unsigned char max);
 /* Stores new character to the RC buffer */
 void CC110L_RC_WriteBuffer(unsigned char data);
 
+/* Reads a packet from the RX FIFO of the CC110L */
+unsigned char CC110L_RC_ReadPacket(unsigned char* pData, 
+								   unsigned char maxLength);
+
 /* Reads a byte of data from the RC buffer */
 unsigned char CC110L_RC_ReadBuffer();
 
@@ -384,11 +522,39 @@ void CC110L_RC_Clear();
 void CC110L_TX_WriteBuffer(unsigned char data);
 
 /* Stores multiple new characters to the TX buffer */
-void CC110L_TX_WriteBufferMultiple(unsigned char* data);
+unsigned char CC110L_TX_WriteBufferMultiple(unsigned char* data,
+											unsigned char bytesNumber);
+
+/* Stores a whole frame of data to the TX buffer (or drops it whole) */
+unsigned char CC110L_TX_WriteBufferFrame(unsigned char* data, 
+										 unsigned char frameSize);
 
-/* Stores a frame of data to the TX buffer */
-void CC110L_TX_WriteBufferFrame(unsigned char* data, 
-								unsigned char frameSize);
+/* Gets the frames and bytes that did not fit in the TX buffer */
+void CC110L_TX_GetDrops(FrameDrops* pDrops);
+
+/* Sends out a frame straight from its frame slot */
+void CC110L_TX_SendFrame(unsigned char* pFrame, 
+						 unsigned char frameSize);
+
+/* Sends a packet over the CC110L with one burst write of the TX FIFO */
+unsigned char CC110L_TX_SendPacket(unsigned char* pData, 
+								   unsigned char length);
+
+/* Sets the number of frames batched into a radio packet */
+void CC110L_SetBatchWindow(unsigned char window);
+
+/* Empties the radio packet being batched */
+void CC110L_TX_ClearBatch();
+
+/* Batches queued frames into a radio packet and sends it once the window is reached */
+unsigned char CC110L_TX_SendBatch(unsigned char flush);
+
+/* Starts sending a frame straight from its frame slot on the SSP2 interrupt */
+unsigned char CC110L_TX_StartFrame(unsigned char* pFrame, 
+								   unsigned char frameSize);
+
+/* Checks if a frame started with CC110L_TX_StartFrame is still being sent */
+unsigned char CC110L_TX_isBusy();
 
 /* Sends out a byte on the TX register */
 void CC110L_TX_SendByte();
@@ -402,6 +568,34 @@ unsigned char CC110L_TX_isDataAvailable();
 /* Resets the TX buffer */
 void CC110L_TX_Clear();
 
+/******************************************************************************/
+/* Retransmission Functions													  */
+/******************************************************************************/
+
+/* Sets the retransmit window depth, give-up deadline and acknowledgement timeout */
+void CC110L_ARQ_Configure(unsigned char depth, 
+						  unsigned int deadline, 
+						  unsigned int ackTimeout);
+
+/* Empties the retransmit window */
+void CC110L_ARQ_Clear();
+
+/* Puts a packet in the retransmit window */
+unsigned char CC110L_ARQ_Send(unsigned char* pData, 
+							  unsigned char length);
+
+/* Sends the packets of the retransmit window and handles the acknowledgements */
+unsigned char CC110L_ARQ_Service();
+
+/* Checks if the retransmit window still holds packets */
+unsigned char CC110L_ARQ_isPending();
+
+/* Gets the frames and bytes given up after their deadline */
+void CC110L_ARQ_GetDrops(FrameDrops* pDrops);
+
+/* Gets the number of packets sent again */
+unsigned int CC110L_ARQ_GetRetransmissions();
+
 /******************************************************************************/
 /* General Functions Part 2													  */
 /******************************************************************************/
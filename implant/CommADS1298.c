@@ -45,6 +45,21 @@
 /******************************************************************************/
 #include "CommADS1298.h"
 
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+
+/* Transfer queue of the SSP1 interrupt, the tail transfer is the one running */
+static CommADS1298_Transfer TRANSFERS[CommADS1298_MAX_TRANSFERS];
+static volatile unsigned char TRANSFER_HEAD;
+static volatile unsigned char TRANSFER_TAIL;
+static volatile unsigned char TRANSFER_INDEX;		// next byte of the running transfer
+
+/* Arguments of the frame reader, in the access bank for its assembly loop */
+static near unsigned char READER_FSR0L;			// destination, low byte
+static near unsigned char READER_FSR0H;			// destination, high byte
+static near unsigned char READER_COUNT;			// bytes left to shift in
+
 /***************************************************************************//**
  * @brief Initializes the SPI communication peripheral for the ADS1298 chip.
  *
@@ -67,7 +82,7 @@ unsigned char CommADS1298_Initialize() {
 	CommADS1298_CLKPOL = 0; // idle state for clock is low
 	//CommADS1298_CLKPOL = 1; // idle state for clock is high
 	
-	CommADS1298_FOSC = 0000; // set frequency of the shift clock (divide clock frequency by 4)
+	CommADS1298_FOSC = CLOCK_SPI_SSPM(CLOCK_ADS1298_SCLK_MAX); // shift clock at FOSC/4 (16 MHz at 64 MHz)
 	
 	CommADS1298_ENABLE = 1; // enable the SPI
 
@@ -85,7 +100,10 @@ unsigned char CommADS1298_Initialize() {
 	
     ADS1298_DRDY2_DIR   = 1; // DRDY on ADS1298 is input into PIC (device 2)
 	ADS1298_DRDY2_ANSEL = 0;	// clear analog select bit for DRDY (device 2)
-    
+
+	ADS1298_DRDY_INT_DIR   = 1; // DRDY interrupt line is input into PIC
+	ADS1298_DRDY_INT_ANSEL = 0; // clear analog select bit for the DRDY interrupt line
+
 	CommADS1298_CS1_DIR = 0; // CS on ADS1298 is output from PIC (device 1)
     
 	CommADS1298_CS2_DIR = 0; // CS on ADS1298 is output from PIC (device 2)
@@ -98,11 +116,193 @@ unsigned char CommADS1298_Initialize() {
 
 	ADS1298_PWR_DIR = 0; // PWRDN on ADS1298 is output from PIC
 
+	/* Start the free-running frame tick (CLOCK_TICK_NS per tick) */
+	ADS1298_TICK_ENABLE   = 0;
+	ADS1298_TICK_SOURCE   = 0b00; // instruction clock (FOSC/4)
+	ADS1298_TICK_PRESCALE = 0b11; // 1:8 prescaler
+	ADS1298_TICK_RD16     = 1;
+	ADS1298_TICK_HIGH     = 0;    // TMR1H is written with TMR1L in 16 bit mode
+	ADS1298_TICK_LOW      = 0;
+	ADS1298_TICK_ENABLE   = 1;
+
+	/* Define the SSP1 interrupt bits (one interrupt per byte of a queued transfer) */
+	TRANSFER_HEAD = TRANSFER_TAIL = 0;
+	CommADS1298_INTERRUPT_PRIORITY = 1;
+	CommADS1298_INTERRUPT          = 0;
+	CommADS1298_INTERRUPT_ENABLE   = 1;
+
+	/* Define the frame read interrupt bits (enabled only while acquiring) */
+	ADS1298_READ_INT_PRIORITY = 0;
+	ADS1298_READ_INT_ENABLE   = 0;
+	ADS1298_READ_INTERRUPT    = 0;
+
+	/* Define the global interrupt bits */
+	INTERRUPT_PRIORITY   = 1;
+	INTERRUPT_GLOBAL     = 1;
+	INTERRUPT_PERIPHERAL = 1;
+
+	/* Define the DRDY interrupt bits (enabled only while acquiring) */
+	ADS1298_DRDY_INT_EDGE   = 0; // interrupt on the falling edge of DRDY_NOT
+	ADS1298_DRDY_INT_ENABLE = 0;
+	ADS1298_DRDY_INTERRUPT  = 0;
+
 	return 1;
 }
 
 /***************************************************************************//**
- * @brief Writes data to SPI of the ADS1298 chip.
+ * @brief Starts a transfer: brings its CS lines low and sends the first byte.
+ *
+ * @param pTransfer - Transfer to start.
+ *
+ * @return None.
+*******************************************************************************/
+static void CommADS1298_Start(CommADS1298_Transfer* pTransfer)
+{
+    if (pTransfer->cs & CommADS1298_CS_1) { CommADS1298_CS1_PIN = 0; }
+    if (pTransfer->cs & CommADS1298_CS_2) { CommADS1298_CS2_PIN = 0; }
+    
+    TRANSFER_INDEX = 0;
+    CommADS1298_DATABUFFER = (pTransfer->pTx != 0) ? pTransfer->pTx[0] : 0x00;
+}
+
+/***************************************************************************//**
+ * @brief Queues a transfer on the ADS1298 bus. The transfer runs from the 
+ *        SSP1 interrupt, one byte per interrupt, right after the transfers
+ *        already queued, so a register write followed by a read goes out 
+ *        back to back without the main loop. The buffers must stay valid 
+ *        until the completion hook is called. Entering the interrupt costs 
+ *        more than the 8 TCY shift of a byte at FOSC/4, so this is meant 
+ *        for register traffic and command sequences; frames are read with 
+ *        CommADS1298_ReadFrame.
+ *
+ * @param cs - CommADS1298_CS_* lines to hold low during the transfer.
+ * @param pTx - Bytes to send, 0 to send 0x00 (reads).
+ * @param pRx - Buffer for the received bytes, 0 to drop them (writes).
+ * @param length - Number of bytes to transfer.
+ * @param pDone - Called from the interrupt when the transfer is done, or 0.
+ *
+ * @return 1 - transfer queued, 0 - queue full or empty transfer.
+*******************************************************************************/
+unsigned char CommADS1298_Submit(unsigned char cs,
+                                 unsigned char* pTx,
+                                 unsigned char* pRx,
+                                 unsigned char length,
+                                 void (*pDone)(void))
+{
+    CommADS1298_Transfer* pTransfer;
+    unsigned char head = TRANSFER_HEAD;
+    unsigned char next = (head + 1) & (CommADS1298_MAX_TRANSFERS - 1);
+    
+    if ((length == 0) || (next == TRANSFER_TAIL)) {
+        return 0;
+    }
+    
+    /* Fill the descriptor */
+    pTransfer = &TRANSFERS[head];
+    pTransfer->cs = cs;
+    pTransfer->pTx = pTx;
+    pTransfer->pRx = pRx;
+    pTransfer->length = length;
+    pTransfer->pDone = pDone;
+    
+    /* Publish it, and start it if the engine is idle (the SSP1 interrupt is
+     * masked so that it cannot go idle between the check and the publish) */
+    CommADS1298_INTERRUPT_ENABLE = 0;
+    TRANSFER_HEAD = next;
+    if (head == TRANSFER_TAIL) {
+        CommADS1298_Start(pTransfer);
+    }
+    CommADS1298_INTERRUPT_ENABLE = 1;
+    
+    return 1;
+}
+
+/***************************************************************************//**
+ * @brief Checks if transfers are queued or running.
+ *
+ * @param None.
+ *
+ * @return 1 - busy, 0 - idle.
+*******************************************************************************/
+unsigned char CommADS1298_isBusy()
+{
+    return TRANSFER_HEAD != TRANSFER_TAIL;
+}
+
+/***************************************************************************//**
+ * @brief Waits until all the queued transfers are done. With the high 
+ *        priority interrupts disabled (including inside an interrupt) the 
+ *        SSP1 flag is polled instead.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommADS1298_Wait()
+{
+    while (TRANSFER_HEAD != TRANSFER_TAIL) {
+        if (!INTERRUPT_GLOBAL) {
+            CommADS1298_ISR();
+        }
+    }
+}
+
+/***************************************************************************//**
+ * @brief Services the SSP1 interrupt: stores the received byte and sends the 
+ *        next one, or finishes the transfer (CS high, completion hook) and 
+ *        starts the next queued one. Called from the high priority interrupt.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommADS1298_ISR()
+{
+    CommADS1298_Transfer* pTransfer;
+    void (*pDone)(void);
+    unsigned char data;
+    
+    if (!CommADS1298_INTERRUPT) {
+        return;
+    }
+    CommADS1298_INTERRUPT = 0;
+    
+    /* Nothing queued: a stray flag (CommADS1298_ReadFrame runs with the 
+     * interrupt masked and clear the flag when they are done) */
+    if (TRANSFER_HEAD == TRANSFER_TAIL) {
+        return;
+    }
+    
+    /* Store the received byte and send the next one */
+    pTransfer = &TRANSFERS[TRANSFER_TAIL];
+    data = CommADS1298_DATABUFFER;
+    if (pTransfer->pRx != 0) { pTransfer->pRx[TRANSFER_INDEX] = data; }
+    TRANSFER_INDEX = TRANSFER_INDEX + 1;
+    if (TRANSFER_INDEX < pTransfer->length) {
+        CommADS1298_DATABUFFER = (pTransfer->pTx != 0) ? pTransfer->pTx[TRANSFER_INDEX] : 0x00;
+        return;
+    }
+    
+    /* Finish the transfer */
+    if ((pTransfer->cs & CommADS1298_CS_HOLD) == 0) {
+        if (pTransfer->cs & CommADS1298_CS_1) { CommADS1298_CS1_PIN = 1; }
+        if (pTransfer->cs & CommADS1298_CS_2) { CommADS1298_CS2_PIN = 1; }
+    }
+    pDone = pTransfer->pDone;
+    TRANSFER_TAIL = (TRANSFER_TAIL + 1) & (CommADS1298_MAX_TRANSFERS - 1);
+    
+    /* Start the next transfer before the hook so the bus does not go idle */
+    if (TRANSFER_HEAD != TRANSFER_TAIL) {
+        CommADS1298_Start(&TRANSFERS[TRANSFER_TAIL]);
+    }
+    if (pDone != 0) {
+        pDone();
+    }
+}
+
+/***************************************************************************//**
+ * @brief Writes data to SPI of the ADS1298 chip. Blocking wrapper of 
+ *        CommADS1298_Submit, CS is driven by the caller.
  *
  * @param data - data represents the write buffer.
  * @param bytesNumber - Number of bytes to write.
@@ -112,19 +312,18 @@ unsigned char CommADS1298_Initialize() {
 unsigned char CommADS1298_Write(unsigned char* data,
                                 unsigned char bytesNumber)
 {
-    unsigned char i;
-    
-    for(i = 0; i < bytesNumber; i++) {
-        CommADS1298_DATABUFFER = *data++;
-        while (!CommADS1298_BUFFERFULL);
-        CommADS1298_INTERRUPT = 0; // reset the interrupt flag
+    CommADS1298_Wait();
+    if (!CommADS1298_Submit(CommADS1298_CS_NONE, data, 0, bytesNumber, 0)) {
+        return 0;
     }
+    CommADS1298_Wait();
     
 	return bytesNumber;
 }
 
 /***************************************************************************//**
- * @brief Reads data from SPI of the ADS1298 chip.
+ * @brief Reads data from SPI of the ADS1298 chip. Blocking wrapper of 
+ *        CommADS1298_Submit, CS is driven by the caller.
  *
  * @param data - Data represents the read buffer.
  * @param bytesNumber - Number of bytes to read.
@@ -134,14 +333,71 @@ unsigned char CommADS1298_Write(unsigned char* data,
 unsigned char CommADS1298_Read(unsigned char* data,
                                unsigned char bytesNumber)
 {
-    unsigned char i;
-    
-    for(i = 0; i < bytesNumber; i++) {  
-        CommADS1298_DATABUFFER = 0x00; // write 0's to the data buffer to shift bits in
-        while (!CommADS1298_BUFFERFULL); // while transmission has yet to be completed, wait
-        *data++ = CommADS1298_DATABUFFER; 
-        CommADS1298_INTERRUPT = 0; // reset the interrupt flag
+    CommADS1298_Wait();
+    if (!CommADS1298_Submit(CommADS1298_CS_NONE, 0, data, bytesNumber, 0)) {
+        return 0;
     }
+    CommADS1298_Wait();
     
     return bytesNumber;
-}
\ No newline at end of file
+}
+
+/***************************************************************************//**
+ * @brief Reads one ADS1298 frame. The loop is written in assembly so that 
+ *        the store and the byte count run while the next byte is shifting:
+ *        as soon as BF is set the byte is taken into WREG and the next shift 
+ *        is started, then the byte is stored through FSR0. The cycles of the
+ *        loop are simulated by test/ReaderSim.c, which runs the block below:
+ *
+ *	Frame size			TCY of the block
+ *	6  (1 channel)		 80
+ *	9  (2 channels)		116
+ *	12 (3 channels)		152
+ *	15 (4 channels)		188
+ *	18 (5 channels)		224
+ *	21 (6 channels)		260
+ *	24 (7 channels)		296
+ *	27 (8 channels)		332
+ *	54 (daisy chain)	656
+ *
+ *        That is 12 TCY a byte (ADS1298_TCY_PER_BYTE) and 8 TCY to set up the
+ *        pointer and the first shift, in about 20 words of program memory.
+ *        The loop polls BF, so it must only run while the transfer queue is 
+ *        idle (see CommADS1298_Wait) and with the SSP1 interrupt masked (see
+ *        ADS1298_ReadFrame). Otherwise every byte also raises a high priority
+ *        SSP1 interrupt that only clears the flag, about 50 TCY a byte.
+ *
+ * @param data - Data represents the read buffer.
+ * @param bytesNumber - Number of bytes to read (at least 2).
+ *
+ * @return None.
+*******************************************************************************/
+void CommADS1298_ReadFrame(unsigned char* data,
+						   unsigned char bytesNumber)
+{
+    READER_FSR0L = (unsigned char) ((unsigned int) data);
+    READER_FSR0H = ((unsigned int) data) >> 8;
+    READER_COUNT = bytesNumber - 1;
+    
+	_asm
+		MOVFF	READER_FSR0L, FSR0L
+		MOVFF	READER_FSR0H, FSR0H
+		CLRF	SSP1BUF, 0				/* start the first shift */
+	CommADS1298_Shift:
+		BTFSS	SSP1STAT, 0, 0			/* wait for BF */
+		BRA		CommADS1298_Shift
+		MOVF	SSP1BUF, 0, 0			/* take the byte, clears BF */
+		CLRF	SSP1BUF, 0				/* start the next shift */
+		MOVWF	POSTINC0, 0				/* store while it is shifting */
+		NOP								/* puts a BF poll at the end of the shift */
+		DECFSZ	READER_COUNT, 1, 0		/* skip once the last shift is started */
+		BRA		CommADS1298_Shift
+	CommADS1298_Last:
+		BTFSS	SSP1STAT, 0, 0			/* wait for the last byte */
+		BRA		CommADS1298_Last
+		MOVF	SSP1BUF, 0, 0
+		MOVWF	POSTINC0, 0
+	_endasm
+    
+    CommADS1298_INTERRUPT = 0;
+}
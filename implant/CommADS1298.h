@@ -47,6 +47,7 @@
 /* INCLUDE FILES															  */
 /******************************************************************************/
 #include <p18f46k22.h>                                                   
+#include "Clock.h"
 
 /******************************************************************************/
 /* DEFINE VARIABLES															  */
@@ -67,6 +68,8 @@
 
 /* Define the bit for the SSP1 Interrupt Flag */
 #define CommADS1298_INTERRUPT       PIR1bits.SSP1IF
+#define CommADS1298_INTERRUPT_ENABLE	PIE1bits.SSP1IE
+#define CommADS1298_INTERRUPT_PRIORITY	IPR1bits.SSP1IP
 
 /* Define the pins of the SPI for the ADS1298 in the PIC */
 #define CommADS1298_SCLK_DIR		TRISCbits.RC3       // SCLK on RC3 direction
@@ -92,6 +95,31 @@
 #define ADS1298_DRDY2_ANSEL		ANSELAbits.ANSA1    // DRDY pin analog select bit
 #define ADS1298_DRDY2_NOT		PORTAbits.RA1       // DRDY pin (input)
 
+#define ADS1298_DRDY_INT_DIR	TRISBbits.RB0       // DRDY (device 1) is also routed to INT0 on RB0
+#define ADS1298_DRDY_INT_ANSEL	ANSELBbits.ANSB0    // INT0 pin analog select bit
+#define ADS1298_DRDY_INT_EDGE	INTCON2bits.INTEDG0 // INT0 edge select bit (0 = falling edge)
+#define ADS1298_DRDY_INT_ENABLE	INTCONbits.INT0IE   // INT0 interrupt enable bit
+#define ADS1298_DRDY_INTERRUPT	INTCONbits.INT0IF   // INT0 interrupt flag bit (INT0 is always high priority)
+
+/* Define the bits of the low priority frame read interrupt, raised in software
+ * by the DRDY interrupt (Timer5 is never turned on, so its flag is free) */
+#define ADS1298_READ_INTERRUPT		PIR5bits.TMR5IF
+#define ADS1298_READ_INT_ENABLE		PIE5bits.TMR5IE
+#define ADS1298_READ_INT_PRIORITY	IPR5bits.TMR5IP
+
+/* Define the Timer1 bits of the free-running frame tick */
+#define ADS1298_TICK_SOURCE		T1CONbits.TMR1CS    // clock source (00 = FOSC/4)
+#define ADS1298_TICK_PRESCALE	T1CONbits.T1CKPS    // prescaler (11 = 1:8)
+#define ADS1298_TICK_RD16		T1CONbits.T1RD16    // 16 bit read/write mode (reading TMR1L latches TMR1H)
+#define ADS1298_TICK_ENABLE		T1CONbits.TMR1ON    // Timer1 on bit
+#define ADS1298_TICK_LOW		TMR1L
+#define ADS1298_TICK_HIGH		TMR1H
+
+/* Define the interrupt bits */
+#define INTERRUPT_PRIORITY		RCONbits.IPEN
+#define INTERRUPT_GLOBAL		INTCONbits.GIEH
+#define INTERRUPT_PERIPHERAL	INTCONbits.PEIE     // GIEL when priorities are enabled
+
 #define ADS1298_START_DIR		TRISAbits.RA4       // RESET pin direction
 #define ADS1298_START_PIN   	LATAbits.LATA4      // RESET pin (output)
 
@@ -101,6 +129,23 @@
 #define ADS1298_PWR_DIR			TRISEbits.RE0		// PWDN pin direction
 #define ADS1298_PWR_PIN			LATEbits.LATE0		// PWDN pin (output)
 
+/* Chip select lines of a transfer */
+#define CommADS1298_CS_NONE		0x00	// CS is driven by the caller
+#define CommADS1298_CS_1		0x01	// CS of device 1 is held low during the transfer
+#define CommADS1298_CS_2		0x02	// CS of device 2 is held low during the transfer
+#define CommADS1298_CS_HOLD		0x80	// CS stays low after the transfer (the next transfer continues the command)
+
+#define CommADS1298_MAX_TRANSFERS	4	// transfer queue depth (power of 2)
+
+/* Transfer descriptor of the interrupt-driven SSP1 engine */
+typedef struct {
+	unsigned char cs;			// CommADS1298_CS_* lines
+	unsigned char* pTx;			// bytes to send, 0 to send 0x00
+	unsigned char* pRx;			// buffer for the received bytes, 0 to drop them
+	unsigned char length;		// number of bytes (at least 1)
+	void (*pDone)(void);		// completion hook (called from the interrupt), 0 for none
+} CommADS1298_Transfer;
+
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
 /******************************************************************************/
@@ -108,6 +153,22 @@
 /* Initializes the SPI communication peripheral. */
 unsigned char CommADS1298_Initialize();
 
+/* Queues a transfer for the SSP1 interrupt. */
+unsigned char CommADS1298_Submit(unsigned char cs,
+								 unsigned char* pTx,
+								 unsigned char* pRx,
+								 unsigned char length,
+								 void (*pDone)(void));
+
+/* Checks if transfers are queued or running. */
+unsigned char CommADS1298_isBusy();
+
+/* Waits until all the queued transfers are done. */
+void CommADS1298_Wait();
+
+/* Services the SSP1 interrupt. */
+void CommADS1298_ISR();
+
 /* Writes data to SPI. */
 unsigned char CommADS1298_Write(unsigned char* data,
 								unsigned char bytesNumber);
@@ -116,4 +177,8 @@ unsigned char CommADS1298_Write(unsigned char* data,
 unsigned char CommADS1298_Read(unsigned char* data,
 							   unsigned char bytesNumber);
 
+/* Reads one ADS1298 frame with the SSP1 flag polled in an assembly loop. */
+void CommADS1298_ReadFrame(unsigned char* data,
+						   unsigned char bytesNumber);
+
 #endif	// CommADS1298_H
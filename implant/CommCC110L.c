@@ -45,6 +45,15 @@
 /******************************************************************************/
 #include "CommCC110L.h"
 
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+
+/* Burst clocked out by the SSP2 interrupt (see CommCC110L_StartBurst) */
+static unsigned char* BURST_DATA;				// next byte to load
+static volatile unsigned char BURST_LEFT;		// bytes still to load
+static volatile unsigned char BURST_BUSY;		// the burst has not ended yet
+
 /***************************************************************************//**
  * @brief Initializes the SPI communication peripheral for the CC110L chip.
  *
@@ -88,8 +97,9 @@ unsigned char CommCC110L_Initialize() {
     INTERRUPT_GLOBAL     = 1;
     INTERRUPT_PERIPHERAL = 1;
     
-    /* Define the MSSP 2 Interrupt bits */
-    CommCC110L_SSPINT_ENABLE   = 1;
+    /* Define the MSSP 2 Interrupt bits (enabled only during a burst) */
+    BURST_BUSY = 0;
+    CommCC110L_SSPINT_ENABLE   = 0;
     CommCC110L_SSPINT_PRIORITY = 1;
     CommCC110L_SSPINTERRUPT    = 0;
     
@@ -138,4 +148,278 @@ unsigned char CommCC110L_Read(unsigned char* data,
     }
     
     return bytesNumber;
+}
+
+/***************************************************************************//**
+ * @brief Announces a burst to the relay: the length is loaded as the first 
+ *        byte to be clocked out and DRDY is brought low. Returns once the 
+ *        relay has clocked the length (with CS held low for the rest of the 
+ *        burst), leaving DRDY high again. The bytes must follow right away 
+ *        with CommCC110L_WriteBurst.
+ *
+ *        Link protocol (the implant is the SPI slave):
+ *          1. The implant loads the length into SSP2BUF and drives DRDY low.
+ *          2. The relay brings CS low and clocks the length byte.
+ *          3. The relay clocks exactly that many bytes under the same CS.
+ *          4. The relay brings CS high, which also aborts a short burst.
+ *
+ *        Sustained rate at 64 MHz (SCLK = 4 MHz), simulated for both PICs 
+ *        by test/LinkSim.c from instruction counts of each step, with the
+ *        relay reading back to back and a frame always queued here:
+ *
+ *          Frame				Per frame		Rate
+ *          8 ch (32 bytes)	4678 TCY		3420 frames/s, 113 kB/s
+ *          16 ch (56 bytes)	8016 TCY		1996 frames/s, 114 kB/s
+ *
+ *        The byte gap of the relay (CommCC110L_BYTE_GAP_US) takes 84 of the
+ *        ~133 TCY per byte, so 16 channels fall just short of DR_2K. The 
+ *        relay passes the frames on at 115200 baud (~11.5 kB/s), and holds a
+ *        longer stream to that with Serial_TX_isFrameSpace.
+ *
+ * @param length - Number of bytes in the burst.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_BeginBurst(unsigned char length)
+{
+    unsigned char dummy;
+    
+    /* Load the length as the first byte of the burst */
+    dummy = CommCC110L_DATABUFFER; // clear BF from the last burst
+    CommCC110L_SSPINTERRUPT = 0;
+    CommCC110L_DATABUFFER = length;
+    
+    /* Set the DRDY to data ready and wait for the relay to clock the length */
+    CommCC110L_DRDY_NOT = 0;
+    while (!CommCC110L_SSPINTERRUPT);
+    CommCC110L_SSPINTERRUPT = 0;
+    CommCC110L_DRDY_NOT = 1; // the relay holds CS low until the end of the burst
+}
+
+/***************************************************************************//**
+ * @brief Sends the bytes of a burst started with CommCC110L_BeginBurst. Each
+ *        byte is loaded as soon as the previous one was clocked, and the 
+ *        write stops early if the relay ends the burst (CS high).
+ *
+ * @param data - Data represents the write buffer.
+ * @param bytesNumber - Number of bytes to write.
+ *
+ * @return Number of written bytes.
+*******************************************************************************/
+unsigned char CommCC110L_WriteBurst(unsigned char* data,
+                                    unsigned char bytesNumber)
+{
+    unsigned char i, dummy;
+    
+    for(i = 0; i < bytesNumber; i++) {
+        CommCC110L_DATABUFFER = *data++;
+        while (!CommCC110L_SSPINTERRUPT) {
+            if (CommCC110L_CS_PIN) { return i; } // the relay ended the burst
+        }
+        CommCC110L_SSPINTERRUPT = 0; // reset the interrupt flag
+        dummy = CommCC110L_DATABUFFER; // drop the byte clocked in so BF is clear
+    }
+    
+	return bytesNumber;
+}
+
+/***************************************************************************//**
+ * @brief Initializes the SPI communication peripheral as the master of a 
+ *        CC110L radio, instead of the slave of the wired link to the relay.
+ *        SPI mode 0 (data changes on the falling edge of SCLK and is sampled
+ *        on the rising edge), SCLK up to the 6.5 MHz of burst access.
+ *
+ * @param None.
+ *
+ * @return 0 - Initialization failed, 1 - Initialization succeeded.
+*******************************************************************************/
+unsigned char CommCC110L_InitializeRadio() {
+	
+	/* Re-initialize the SSP2 control register 1 and the status register */
+	SSP2CON1 = 0x00;
+	SSP2STAT = 0x00;
+	
+	/* SSP2 Status Register bits */
+	CommCC110L_SAMPLING = 0; // input data sampled at the middle of data output time
+	CommCC110L_CLKEDGE  = 1; // transmit occurs on transition from active to idle clock state
+	
+	/* SSP2 Control Register 1 bits */
+	CommCC110L_CLKPOL = 0; // idle state for clock is low
+	CommCC110L_MODE   = CLOCK_SPI_SSPM(CLOCK_RADIO_SCLK_MAX);
+	CommCC110L_ENABLE = 1;
+	
+	/* Properly configure the SPI/communication pins */
+	CommCC110L_SCLK_DIR   = 0; // SCLK is output from the PIC
+	CommCC110L_SCLK_ANSEL = 0;
+	
+	CommCC110L_DIN_DIR   = 1; // SO on CC110L is input into the PIC
+	CommCC110L_DIN_ANSEL = 0;
+	
+	CommCC110L_DOUT_DIR = 0; // SI on CC110L is output from the PIC
+	
+	CommCC110L_CS_DPIN  = 1; // CS is high before it is driven
+	CommCC110L_CS_DIR   = 0; // CS on CC110L is output from the PIC
+	CommCC110L_CS_ANSEL = 0;
+	
+	/* The SSP2 flag is polled */
+	BURST_BUSY = 0;
+	CommCC110L_SSPINT_ENABLE = 0;
+	CommCC110L_SSPINTERRUPT  = 0;
+	
+	/* GDO0 is an input, its interrupt is only enabled while streaming */
+	CommCC110L_GDO0_DIR   = 1;
+	CommCC110L_GDO0_ANSEL = 0;
+	CommCC110L_GDO_INT_ENABLE = 0;
+	CommCC110L_GDO_INTERRUPT  = 0;
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Brings CS low and waits for the CC110L to pull SO low (CHIP_RDYn), 
+ *        which it does once its crystal oscillator is running.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_Select()
+{
+    CommCC110L_CS_DPIN = 0;
+    while (CommCC110L_DIN_PIN);
+}
+
+/***************************************************************************//**
+ * @brief Brings CS high, which ends a burst access.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_Deselect()
+{
+    CommCC110L_CS_DPIN = 1;
+}
+
+/***************************************************************************//**
+ * @brief Exchanges a byte with the CC110L (radio mode): the byte is clocked 
+ *        out while the reply is clocked in.
+ *
+ * @param data - Byte to send.
+ *
+ * @return Byte received.
+*******************************************************************************/
+unsigned char CommCC110L_Exchange(unsigned char data)
+{
+    CommCC110L_DATABUFFER = data;
+    while (!CommCC110L_SSPINTERRUPT);
+    CommCC110L_SSPINTERRUPT = 0;
+    
+    return CommCC110L_DATABUFFER;
+}
+
+/***************************************************************************//**
+ * @brief Starts a burst that the SSP2 interrupt clocks out, so the CPU is 
+ *        free (the ADS1298 is read on SSP1 meanwhile) until CommCC110L_isBusy
+ *        returns 0. The protocol is the one of CommCC110L_BeginBurst: the 
+ *        length is loaded and DRDY brought low here, and every interrupt 
+ *        loads the next byte. The data must stay untouched until the burst 
+ *        ends. The relay leaves a gap between bytes (CommCC110L_BYTE_GAP_US
+ *        in the relay) that covers the interrupt latency.
+ *
+ *        Streaming at 64 MHz (SCLK = 4 MHz) for one second, simulated for 
+ *        both PICs and both SPI ports by test/LinkSim.c, with the relay 
+ *        reading back to back:
+ *
+ *          Rate	Channels	Read	Sent	Lost			CPU left
+ *          DR_2K	8			1999	1999	0				67%
+ *          DR_1K	16			999		999		0				72%
+ *          DR_2K	16			1997	1994	2 (overruns)	46%
+ *
+ *        Each link byte costs the implant ADS1298_TCY_LINK_BYTE of interrupt
+ *        time and the relay waits 5 us (80 TCY) between bytes to cover it, so
+ *        16 channels at DR_2K need more of the link than it has (see 
+ *        CommCC110L_BeginBurst) and the queue overruns now and then. The 
+ *        reads never miss their DRDY. A polled burst looked faster, but a 
+ *        DRDY during the burst held off the byte loads for the whole read, so
+ *        the relay clocked stale bytes.
+ *
+ * @param data - Data represents the write buffer.
+ * @param bytesNumber - Number of bytes in the burst.
+ *
+ * @return 1 - the burst was started, 0 - a burst is still running.
+*******************************************************************************/
+unsigned char CommCC110L_StartBurst(unsigned char* data,
+                                    unsigned char bytesNumber)
+{
+    unsigned char dummy;
+    
+    if (CommCC110L_isBusy()) {
+        return 0;
+    }
+    BURST_DATA = data;
+    BURST_LEFT = bytesNumber;
+    BURST_BUSY = 1;
+    
+    /* Load the length as the first byte of the burst */
+    dummy = CommCC110L_DATABUFFER; // clear BF from the last burst
+    CommCC110L_SSPINTERRUPT = 0;
+    CommCC110L_DATABUFFER = bytesNumber;
+    CommCC110L_SSPINT_ENABLE = 1;
+    
+    /* Set the DRDY to data ready, the interrupt takes it from here */
+    CommCC110L_DRDY_NOT = 0;
+    
+    return 1;
+}
+
+/***************************************************************************//**
+ * @brief Checks if a burst started with CommCC110L_StartBurst is still 
+ *        running. A burst the relay ended early (CS high once the length was
+ *        clocked) is ended here.
+ *
+ * @param None.
+ *
+ * @return 1 - the burst is running, 0 - the link is free.
+*******************************************************************************/
+unsigned char CommCC110L_isBusy()
+{
+    if (BURST_BUSY && CommCC110L_DRDY_NOT && CommCC110L_CS_PIN) {
+        CommCC110L_SSPINT_ENABLE = 0;
+        BURST_BUSY = 0;
+    }
+    
+    return BURST_BUSY;
+}
+
+/***************************************************************************//**
+ * @brief Services the SSP2 interrupt: loads the next byte of the burst as 
+ *        soon as the previous one was clocked, or ends the burst after the 
+ *        last one. Called first from the high priority interrupt.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_ISR()
+{
+    unsigned char dummy;
+    
+    if (!(CommCC110L_SSPINTERRUPT && CommCC110L_SSPINT_ENABLE)) {
+        return;
+    }
+    CommCC110L_SSPINTERRUPT = 0;
+    dummy = CommCC110L_DATABUFFER; // drop the byte clocked in so BF is clear
+    CommCC110L_DRDY_NOT = 1; // the relay holds CS low until the end of the burst
+    
+    /* Load the next byte before the relay clocks it */
+    if (BURST_LEFT != 0) {
+        CommCC110L_DATABUFFER = *BURST_DATA++;
+        BURST_LEFT = BURST_LEFT - 1;
+        return;
+    }
+    
+    /* The last byte was clocked */
+    CommCC110L_SSPINT_ENABLE = 0;
+    BURST_BUSY = 0;
 }
\ No newline at end of file
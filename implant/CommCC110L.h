@@ -47,6 +47,7 @@
 /* INCLUDE FILES															  */
 /******************************************************************************/
 #include <p18f46k22.h>                                                   
+#include "Clock.h"
 
 /******************************************************************************/
 /* DEFINE REGISTER BITS														  */
@@ -85,15 +86,27 @@
 
 #define CommCC110L_DIN_DIR                  TRISDbits.RD1       // Into implant from relay
 #define CommCC110L_DIN_ANSEL                ANSELDbits.ANSD1
+#define CommCC110L_DIN_PIN                  PORTDbits.RD1       // SO of the CC110L (low when the chip is ready)
 
 #define CommCC110L_DOUT_DIR                 TRISDbits.RD4       // Out of implant to relay
 
 #define CommCC110L_CS_DIR                   TRISDbits.RD3       // PIC CS input and output
 #define CommCC110L_CS_ANSEL                 ANSELDbits.ANSD3
+#define CommCC110L_CS_PIN                   PORTDbits.RD3       // PIC CS input (high between bursts)
+#define CommCC110L_CS_DPIN                  LATDbits.LATD3      // PIC CS output (radio mode)
 
 #define CommCC110L_DRDY_DIR					TRISAbits.RA5
 #define CommCC110L_DRDY_NOT					LATAbits.LATA5
 
+/* Define the GDO0 pin of the CC110L (INT1, TX FIFO threshold while streaming) */
+#define CommCC110L_GDO0_DIR                 TRISBbits.RB1
+#define CommCC110L_GDO0_ANSEL               ANSELBbits.ANSB1
+#define CommCC110L_GDO0_PIN                 PORTBbits.RB1
+#define CommCC110L_GDO_INT_EDGE             INTCON2bits.INTEDG1 // 0 = interrupt on the falling edge
+#define CommCC110L_GDO_INTERRUPT            INTCON3bits.INT1IF
+#define CommCC110L_GDO_INT_ENABLE           INTCON3bits.INT1IE
+#define CommCC110L_GDO_INT_PRIORITY         INTCON3bits.INT1IP
+
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
 /******************************************************************************/
@@ -109,4 +122,33 @@ unsigned char CommCC110L_Write(unsigned char* data,
 unsigned char CommCC110L_Read(unsigned char* data,
 							  unsigned char bytesNumber);
 
+/* Announces a burst to the relay and sends its length. */
+void CommCC110L_BeginBurst(unsigned char length);
+
+/* Sends the bytes of a burst. */
+unsigned char CommCC110L_WriteBurst(unsigned char* data,
+									unsigned char bytesNumber);
+
+/* Initializes the SPI communication peripheral as master of a CC110L radio. */
+unsigned char CommCC110L_InitializeRadio();
+
+/* Brings CS low and waits for the CC110L to be ready. */
+void CommCC110L_Select();
+
+/* Brings CS high. */
+void CommCC110L_Deselect();
+
+/* Exchanges a byte with the CC110L. */
+unsigned char CommCC110L_Exchange(unsigned char data);
+
+/* Starts a burst that the SSP2 interrupt clocks out. */
+unsigned char CommCC110L_StartBurst(unsigned char* data,
+									unsigned char bytesNumber);
+
+/* Checks if a burst started with CommCC110L_StartBurst is still running. */
+unsigned char CommCC110L_isBusy();
+
+/* Services the SSP2 interrupt. */
+void CommCC110L_ISR();
+
 #endif	// CommCC110L_H
@@ -24,8 +24,9 @@ unsigned char Implant_Initialize(unsigned char* channels) {
     unsigned char status = 0;
     
     /* Initialize the ADS1298 */
-	status = ADS1298_Initialize(channels);
+	status = ADS1298_Initialize(channels, ADS1298_READMODE_MULTIPLE);
 	frameSize = ADS1298_GetFrameSize();
+	ADS1298_SetOverflowPolicy(FRAME_POLICY_DROP_OLDEST); // keep the freshest frames when the link falls behind
     
     /* Initialize the SPI communication */
     //status &= CC110L_Initialize();
@@ -37,20 +38,101 @@ unsigned char Implant_Initialize(unsigned char* channels) {
 }
 
 void Implant_StreamData(unsigned char frameCnt) {
-	unsigned char data[50];
-	unsigned char i;
+	unsigned char report[FRAME_REPORT_SIZE];
+	unsigned char* pFrame;
+	unsigned char i, length, policy;
+	unsigned char sending = 0;
+	unsigned int reported = 0;
+	FrameDrops drops;
 	
-	/* Start converting data and reading it */
+	/* Start converting data and let the DRDY interrupt capture it */
     ADS1298_START_PIN = 1; // bring the START pin high to start converting data
 	ADS1298_StartConversion();
+	if (!ADS1298_StartAcquisition()) { frameCnt = 0; } // the data rate is too fast to read every conversion
 	
-	/* Iterate through the frames */
-	for (i = 0; i < frameCnt; i = i + 1) {
-		ADS1298_ReadFrame(data);
-		CC110L_TX_WriteBufferMultiple(data);
+	/* Send the frames straight from the slots the read interrupt fills. Frame
+	 * N is clocked out by the SSP2 interrupt while the read interrupt clocks 
+	 * frame N+1 in on SSP1, so this loop only hands the slots over */
+	for (i = 0; i < frameCnt; ) {
+		if (CC110L_TX_isBusy()) { continue; } // CPU is free while both ports run
+		
+		/* The frame was sent, so its slot can be reused */
+		if (sending) {
+			ADS1298_ReleaseFrame();
+			sending = 0;
+			i = i + 1;
+			
+			/* Tell the relay when more frames were dropped */
+			policy = ADS1298_GetDrops(&drops);
+			if (drops.frames != reported) {
+				FRAME_PACK_REPORT(report, FRAME_REPORT_IMPLANT, policy, drops);
+				CC110L_TX_StartFrame(report, FRAME_REPORT_SIZE);
+				reported = drops.frames;
+				continue;
+			}
+		}
+		
+		/* Start sending the oldest frame */
+		pFrame = ADS1298_PeekFrame(&length);
+		if (pFrame == 0) { continue; }
+		CC110L_TX_StartFrame(pFrame, length);
+		sending = 1;
+	}
+	while (CC110L_TX_isBusy()); // let the last report go out
+	
+	/* Stop converting data and stop reading it */
+	ADS1298_StopAcquisition();
+	ADS1298_StopConversion();
+	ADS1298_START_PIN = 0;
+}
+
+void Implant_StreamRadio(unsigned int frameCnt) {
+	
+	/* Start converting data and let the DRDY interrupt capture it */
+    ADS1298_START_PIN = 1;
+	ADS1298_StartConversion();
+	
+	/* The GDO0 interrupt moves the frames from the queue into the TX FIFO of
+	 * the radio (configured with CC110L_ApplyPreset), so this only waits */
+	if (ADS1298_StartAcquisition() && CC110L_StartStream()) {
+		while (CC110L_GetStreamFrames() < frameCnt);
+		CC110L_StopStream();
+	}
+	
+	/* Stop converting data and stop reading it */
+	ADS1298_StopAcquisition();
+	ADS1298_StopConversion();
+	ADS1298_START_PIN = 0;
+}
+
+void Implant_StreamPackets(unsigned int frameCnt, unsigned char window) {
+	unsigned int sent = 0;
+	
+	/* Start converting data and let the DRDY interrupt capture it */
+    ADS1298_START_PIN = 1;
+	ADS1298_StartConversion();
+	
+	/* Batch the frames into packets for the radio (configured with 
+	 * CC110L_ApplyPreset and CC110L_ARQ_Configure), window frames per packet,
+	 * and send the lost packets again until their deadline. The last packet
+	 * only waits for the frames still owed. */
+	CC110L_SetBatchWindow(window);
+	CC110L_TX_ClearBatch();
+	CC110L_ARQ_Clear();
+	if (ADS1298_StartAcquisition()) {
+		while (sent < frameCnt) {
+			if ((frameCnt - sent) < window) { CC110L_SetBatchWindow(frameCnt - sent); }
+			sent = sent + CC110L_TX_SendBatch(0);
+			CC110L_ARQ_Service();
+		}
+		
+		/* Keep the acquisition running until the window is acknowledged or
+		 * its packets pass their deadline (the deadline counts DRDYs) */
+		while (CC110L_ARQ_isPending()) { CC110L_ARQ_Service(); }
 	}
 	
 	/* Stop converting data and stop reading it */
+	ADS1298_StopAcquisition();
 	ADS1298_StopConversion();
 	ADS1298_START_PIN = 0;
 }
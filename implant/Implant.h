@@ -23,6 +23,10 @@ unsigned char Implant_Initialize(unsigned char* channels);
 
 void Implant_StreamData(unsigned char frameCnt);
 
+void Implant_StreamRadio(unsigned int frameCnt);
+
+void Implant_StreamPackets(unsigned int frameCnt, unsigned char window);
+
 unsigned char Implant_ChangeMode(unsigned char cmd, unsigned char* data);
 
 #endif /* _IMPLANT_H_ */
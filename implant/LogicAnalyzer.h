@@ -31,11 +31,11 @@
 #define LogicAnalyzer_BIT2          LATBbits.LATB2
 #define LogicAnalyzer_BIT2_DIR      TRISBbits.RB2
 
-#define LogicAnalyzer_BIT1          LATBbits.LATB1
-#define LogicAnalyzer_BIT1_DIR      TRISBbits.RB1
+#define LogicAnalyzer_BIT1          LATEbits.LATE2      // RB1 is taken by the CC110L GDO0 interrupt
+#define LogicAnalyzer_BIT1_DIR      TRISEbits.RE2
 
-#define LogicAnalyzer_BIT0          LATBbits.LATB0
-#define LogicAnalyzer_BIT0_DIR      TRISBbits.RB0
+#define LogicAnalyzer_BIT0          LATEbits.LATE1      // RB0 is taken by the ADS1298 DRDY interrupt
+#define LogicAnalyzer_BIT0_DIR      TRISEbits.RE1
 
 #define LogicAnalyzer_CLK           LATDbits.LATD7
 #define LogicAnalyzer_CLK_DIR       TRISDbits.RD7
@@ -9,7 +9,7 @@
 
 /* Configure the interrupt settings */
 #pragma interrupt InterruptHigh
-#pragma code InterruptVectorHigh = 0x08
+#pragma interruptlow InterruptLow
 
 /******************************************************************************/
 /* INCLUDE FILES															  */
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "Clock.h"
 #include "CommADS1298.h"
 #include "ADS1298.h"
 #include "CommCC110L.h"
@@ -28,14 +29,33 @@
 /******************************************************************************/
 /* INTERRUPTS																  */
 /******************************************************************************/
+#pragma code InterruptVectorHigh = 0x08
 void InterruptVectorHigh() { 
 	_asm
 		goto InterruptHigh
 	_endasm
 }
 
+#pragma code InterruptVectorLow = 0x18
+void InterruptVectorLow() { 
+	_asm
+		goto InterruptLow
+	_endasm
+}
+#pragma code
+
+/* Link bytes first, the relay only leaves CommCC110L_BYTE_GAP_US to load them */
 void InterruptHigh() {
-    //CC110L_ISR();
+    CommCC110L_ISR();
+    ADS1298_ISR();
+    CommADS1298_ISR();
+}
+
+/* Frame reads and TX FIFO refills, preempted by the link bytes. Both use the
+ * frame queue, so they must stay on the same level */
+void InterruptLow() {
+    ADS1298_ReadISR();
+    CC110L_StreamISR();
 }
 
 /******************************************************************************/
@@ -46,14 +66,8 @@ void main() {
     unsigned char dummy[100];
     unsigned char channels[2] = {0, 0};
     
-	/* Set the PIC clock frequency */
-	/* bit 7   (IDLEN):  0   = Device enter Sleep mode on SLEEP instruction
-	 * bit 6-4 (IRCF):   111 = 16 MHz internal RC oscillator
-	 * bit 3   (OSTS):   0   = Device is running from internal oscillator
-	 * bit 2   (HFIOFS): 1   = HFINTOSC frequency is stable
-	 * bit 1-0 (SCS):    1x  = Internal oscillator block
-	 */
-    OSCCON = 0b01110110; // set clock to 16 MHz
+	/* Set the PIC clock frequency (see Clock.h) */
+    CLOCK_INITIALIZE();
 	
     /* Initialize the implant */
 	channels[0] = 0b10000000; // device 1 channels
@@ -4,18 +4,241 @@
 #include "CommCC110L.h"
 #include "CC110L.h"
 #include "Serial.h"
+#include "Frame.h"
+#include "RingBuffer.h"
 
 /******************************************************************************/
 /* DEFINITIONS  															  */
 /******************************************************************************/
 #define SSP_MAX_TX_SIZE     32
 #define SSP_MAX_RC_SIZE     32
+#define PA_POWER            0x8E // PATABLE entry for 0 dBm at 915 MHz
+#define RESET_US            40   // CS high time before the SRES strobe of a manual reset
 
 /******************************************************************************/
 /* GLOBAL VARIABLES															  */
 /******************************************************************************/
-unsigned char SSP_TX_BUFFER[SSP_MAX_TX_SIZE], SSP_RC_BUFFER[SSP_MAX_RC_SIZE];
-unsigned char SSP_TX_HEAD, SSP_TX_TAIL, SSP_RC_HEAD, SSP_RC_TAIL;
+RING_DECLARE(SSP_TX, SSP_MAX_TX_SIZE);
+RING_DECLARE(SSP_RC, SSP_MAX_RC_SIZE);
+static unsigned char arqNext;			// number of the next radio packet expected
+static unsigned int arqReceived;		// packets received from arqNext up (bit 0 = arqNext)
+static unsigned char preset = CC110L_PRESET_38K4; // preset applied last
+
+/* Radio packet of frames being unpacked (see Frame.h) */
+static unsigned char PACKET[CC110L_MAX_PAYLOAD];
+static unsigned char packetLength;		// bytes in the packet, 0 once every frame was unpacked
+static unsigned char packetOffset;		// offset of the next frame in the packet
+static unsigned char packetIndex;		// index of the next frame in the packet
+
+/* Radio presets, IOCFG2 through TEST0 in register order (the reserved registers
+ * in between get their recommended values, so the table goes out in one burst).
+ * They are the presets of the implant, which has to use the same one */
+static rom const unsigned char PRESETS[CC110L_NUM_PRESETS][CC110L_CONFIG_SIZE] = {
+	
+	/* CC110L_PRESET_38K4: GFSK at 38.4 kBaud (DRATE_E 10, DRATE_M 131) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x06,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0xCA,
+	/* MDMCFG3  */ 0x83,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_GFSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x35,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x16,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0x43,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0x91,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0x56,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xE9,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x81,
+	/* TEST1    */ 0x35,
+	/* TEST0    */ 0x09
+	},
+	
+	/* CC110L_PRESET_76K8: GFSK at 76.8 kBaud (DRATE_E 11, DRATE_M 131) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x08,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0x7B,
+	/* MDMCFG3  */ 0x83,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_GFSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x42,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x16,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0x43,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0x91,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0x56,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xE9,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x81,
+	/* TEST1    */ 0x35,
+	/* TEST0    */ 0x09
+	},
+	
+	/* CC110L_PRESET_250K: GFSK at 250 kBaud (DRATE_E 13, DRATE_M 59) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x0C,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0x2D,
+	/* MDMCFG3  */ 0x3B,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_GFSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x62,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x1D,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0xC7,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0xB0,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0xB6,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xEA,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x88,
+	/* TEST1    */ 0x31,
+	/* TEST0    */ 0x09
+	},
+	
+	/* CC110L_PRESET_500K: 2-FSK at 500 kBaud (DRATE_E 14, DRATE_M 59) */
+	{
+	/* IOCFG2   */ CC110L_GDOCFG_CHIP_RDYN,
+	/* IOCFG1   */ CC110L_GDOCFG_HIGH_Z,
+	/* IOCFG0   */ CC110L_GDOCFG_SYNC_WORD,
+	/* FIFOTHR  */ CC110L_FIFOTHR_ADCRETENTION | CC110L_FIFOTHR_THRESHOLD_RX32_TX33,
+	/* SYNC1    */ 0xD3,
+	/* SYNC0    */ 0x91,
+	/* PKTLEN   */ 0xFF,
+	/* PKTCTRL1 */ CC110L_PKTCTRL1_APPENDSTATUS | CC110L_PKTCTRL1_ADRCHECK0,
+	/* PKTCTRL0 */ CC110L_PKTCTRL0_PKTFORMAT_NORMAL | CC110L_PKTCTRL0_CRCEN | CC110L_PKTCTRL0_LENGTH_VARIABLE,
+	/* ADDR     */ 0x00,
+	/* CHANNR   */ 0x00,
+	/* FSCTRL1  */ 0x0E,
+	/* FSCTRL0  */ 0x00,
+	/* FREQ2    */ 0x23,
+	/* FREQ1    */ 0x31,
+	/* FREQ0    */ 0x3B,
+	/* MDMCFG4  */ 0x0E,
+	/* MDMCFG3  */ 0x3B,
+	/* MDMCFG2  */ CC110L_MDMCFG2_MODFORMAT_2FSK | CC110L_MDMCFG2_SYNCMODE3,
+	/* MDMCFG1  */ CC110L_MDMCFG1_NUMPREAMBLE_4BYTES | 0x02,
+	/* MDMCFG0  */ 0xF8,
+	/* DEVIATN  */ 0x62,
+	/* MCSM2    */ 0x07,
+	/* MCSM1    */ CC110L_MCSM1_CCAMODE3 | CC110L_MCSM1_RXOFFMODE_IDLE | CC110L_MCSM1_TXOFFMODE_IDLE,
+	/* MCSM0    */ CC110L_MCSM0_FSAUTOCAL1 | CC110L_MCSM0_POTIMEOUT_EXP64,
+	/* FOCCFG   */ 0x1D,
+	/* BSCFG    */ 0x6C,
+	/* AGCCTRL2 */ 0xC7,
+	/* AGCCTRL1 */ 0x40,
+	/* AGCCTRL0 */ 0xB0,
+	/* RESERVED */ 0x87,
+	/* RESERVED */ 0x6B,
+	/* RESERVED */ 0xFB,
+	/* FREND1   */ 0xB6,
+	/* FREND0   */ 0x10,
+	/* FSCAL3   */ 0xEA,
+	/* FSCAL2   */ 0x2A,
+	/* FSCAL1   */ 0x00,
+	/* FSCAL0   */ 0x1F,
+	/* RESERVED */ 0x41,
+	/* RESERVED */ 0x00,
+	/* RESERVED */ 0x59,
+	/* RESERVED */ 0x7F,
+	/* RESERVED */ 0x3F,
+	/* TEST2    */ 0x88,
+	/* TEST1    */ 0x31,
+	/* TEST0    */ 0x09
+	}
+};
 
 /******************************************************************************/
 /* FUNCTIONS																  */
@@ -40,31 +263,252 @@ unsigned char CC110L_Initialize() {
     if (!status) { return 0; }
     
     /* Initialize the RC and TX buffers */
-    SSP_RC_HEAD = SSP_RC_TAIL = SSP_TX_HEAD = SSP_TX_TAIL = 0;
+    RING_CLEAR(SSP_RC);
+    RING_CLEAR(SSP_TX);
     for (i = 0; i < SSP_MAX_RC_SIZE; i = i + 1) { SSP_RC_BUFFER[i] = 0; }
     
     return 1;
 }
 
+/******************************************************************************/
+/* Register Functions														  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Sends a command strobe to the CC110L (radio mode).
+ *
+ * @param strobe - One of the CC110L command strobes (CC110L_SRES to CC110L_SNOP).
+ * 
+ * @return Chip status byte (state in bits 6-4, FIFO bytes in bits 3-0).
+*******************************************************************************/
+unsigned char CC110L_Strobe(unsigned char strobe) {
+	unsigned char status;
+	
+	CommCC110L_Select();
+	status = CommCC110L_Exchange(strobe);
+	CommCC110L_Deselect();
+	
+	return status;
+}
+
+/***************************************************************************//**
+ * @brief Writes data to the registers of the CC110L (radio mode). More than 
+ *        one register is written in a single burst: one header byte with the
+ *        burst bit and then the values, under one CS. For the 47 registers of
+ *        a preset that is 48 bytes instead of 94 bytes and 47 CS cycles.
+ *
+ * @param address - Char denoting the initial address to write to.
+ * @param writeNum - Char denoting the number of registers to write.
+ * @param regVals - Pointer to the array containing the values to write.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_WriteRegisters(unsigned char address, 
+						   unsigned char writeNum, 
+						   unsigned char* regVals) {
+	unsigned char i;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(address | ((writeNum > 1) ? CC110L_WRITE_BURST : CC110L_WRITE_SINGLE));
+	for (i = 0; i < writeNum; i = i + 1) { CommCC110L_Exchange(regVals[i]); }
+	CommCC110L_Deselect();
+}
+
 /***************************************************************************//**
- * @brief Increment the specified index and check if the end of the buffer has
- *        been reached. If the end has been reached, the index is wrapped back 
- *        around to the beginning of the buffer.
+ * @brief Reads data from the registers of the CC110L (radio mode), in a 
+ *        single burst when there is more than one.
  *
- * @param idx - Index that you desire to increment.
- * @param max - Maximum index that you can go to (buffer size).
+ * @param address - Char denoting the initial address to read from.
+ * @param readNum - Char denoting the number of registers to read.
+ * @param regVals - Pointer to the array storing the read register data.
  * 
- * @return Incremented index value.
+ * @return None.
 *******************************************************************************/
-unsigned char CC110L_IncrementIndex(unsigned char idx, unsigned char max) {
-	if (++idx == max) { idx = 0; } // increment index; and if buffer end reached, start from beginning
-	return idx; // return the index
+void CC110L_ReadRegisters(unsigned char address, 
+						  unsigned char readNum, 
+						  unsigned char* regVals) {
+	unsigned char i;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(address | ((readNum > 1) ? CC110L_READ_BURST : CC110L_READ_SINGLE));
+	for (i = 0; i < readNum; i = i + 1) { regVals[i] = CommCC110L_Exchange(0x00); }
+	CommCC110L_Deselect();
+}
+
+/***************************************************************************//**
+ * @brief Reads a status register of the CC110L (radio mode). The status 
+ *        registers share their addresses with the command strobes, so they
+ *        are read with the burst bit set.
+ *
+ * @param address - One of the status registers (CC110L_PARTNUM to CC110L_RXBYTES).
+ * 
+ * @return Value of the status register.
+*******************************************************************************/
+unsigned char CC110L_ReadStatus(unsigned char address) {
+	unsigned char value;
+	
+	CommCC110L_Select();
+	CommCC110L_Exchange(address | CC110L_READ_BURST);
+	value = CommCC110L_Exchange(0x00);
+	CommCC110L_Deselect();
+	
+	return value;
+}
+
+/***************************************************************************//**
+ * @brief Resets the CC110L (radio mode) with the manual power-on sequence: CS
+ *        is strobed low and held high for 40 us before the SRES strobe. The 
+ *        next access waits for the chip to be ready again.
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_Reset() {
+	CommCC110L_Select();
+	CommCC110L_Deselect();
+	CLOCK_DELAY_US(RESET_US);
+	CC110L_Strobe(CC110L_SRES);
+}
+
+/***************************************************************************//**
+ * @brief Configures the CC110L radio: switches SSP1 to radio mode, resets 
+ *        the chip and writes a preset from IOCFG2 to TEST0 with a single 
+ *        burst, then the output power. The chip is left in the Idle state.
+ *
+ * @param newPreset - One of the CC110L_PRESET_* values.
+ * @param verify - 1 to read the registers back and compare them.
+ * 
+ * @return 1 - preset applied (and verified), 0 - unknown preset or mismatch.
+*******************************************************************************/
+unsigned char CC110L_ApplyPreset(unsigned char newPreset,
+								 unsigned char verify) {
+	unsigned char writeVals[CC110L_CONFIG_SIZE];
+	unsigned char paPower = PA_POWER;
+	unsigned char i;
+	
+	/* Check the preset */
+	if (newPreset >= CC110L_NUM_PRESETS) { return 0; }
+	preset = newPreset;
+	
+	/* Take the SPI as master and start from the reset values */
+	CommCC110L_InitializeRadio();
+	CC110L_Reset();
+	
+	/* Copy the preset out of program memory and send it in one burst */
+	for (i = 0; i < CC110L_CONFIG_SIZE; i = i + 1) { writeVals[i] = PRESETS[preset][i]; }
+	CC110L_WriteRegisters(CC110L_IOCFG2, CC110L_CONFIG_SIZE, writeVals);
+	CC110L_WriteRegisters(CC110L_PATABLE, 1, &paPower);
+	
+	/* Read the registers back */
+	if (verify) { return CC110L_VerifyRegisters(); }
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Reads the configuration registers back in one burst and compares 
+ *        them with the preset applied last. FSCAL3 to FSCAL0 hold the results
+ *        of the frequency synthesizer calibration and are not compared.
+ *
+ * @param None.
+ * 
+ * @return 1 - registers match the preset, 0 - mismatch.
+*******************************************************************************/
+unsigned char CC110L_VerifyRegisters() {
+	unsigned char regVals[CC110L_CONFIG_SIZE];
+	unsigned char i;
+	
+	/* Read all the configuration registers */
+	CC110L_ReadRegisters(CC110L_IOCFG2, CC110L_CONFIG_SIZE, regVals);
+	
+	/* Compare the registers that only change when they are written */
+	for (i = 0; i < CC110L_CONFIG_SIZE; i = i + 1) {
+		if ((i >= CC110L_FSCAL3) && (i <= CC110L_FSCAL0)) { continue; }
+		if (regVals[i] != PRESETS[preset][i]) { return 0; }
+	}
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Checks if the CC110L is back in the Idle state, which the presets 
+ *        enter once a packet has been sent or received (TXOFF_MODE and 
+ *        RXOFF_MODE). A TX FIFO underflow or RX FIFO overflow is flushed 
+ *        here, which also returns the chip to Idle.
+ *
+ * @param None.
+ * 
+ * @return 1 - the chip is idle, 0 - the chip is busy.
+*******************************************************************************/
+unsigned char CC110L_isIdle() {
+	unsigned char state = CC110L_ReadStatus(CC110L_MARCSTATE);
+	
+	if (state == CC110L_MARCSTATE_TXFIFO_UNDERFLOW) {
+		CC110L_Strobe(CC110L_SFTX);
+		return 1;
+	}
+	if (state == CC110L_MARCSTATE_RXFIFO_OVERFLOW) {
+		CC110L_Strobe(CC110L_SFRX);
+		return 1;
+	}
+	
+	return (state == CC110L_MARCSTATE_IDLE);
 }
 
 /******************************************************************************/
 /* Receive Functions														  */
 /******************************************************************************/
 
+/***************************************************************************//**
+ * @brief Reads a packet from the RX FIFO of the CC110L (radio mode): the 
+ *        length byte, the payload and the 2 appended status bytes in one 
+ *        burst. The packet is only read once the chip is back in Idle, so it
+ *        is all in the FIFO. A packet that does not fit the buffer or fails 
+ *        the CRC is dropped.
+ *
+ * @param pData - Pointer to the buffer storing the payload.
+ * @param maxLength - Size of the buffer.
+ * 
+ * @return Size of the payload, 0 if there was no whole packet or it was dropped.
+*******************************************************************************/
+unsigned char CC110L_RC_ReadPacket(unsigned char* pData, 
+								   unsigned char maxLength) {
+	unsigned char count, check, length, status;
+	
+	/* Wait for the end of the packet */
+	if (!CC110L_isIdle()) { return 0; }
+	
+	/* RXBYTES can change while it is read, so read it until it is stable */
+	count = CC110L_ReadStatus(CC110L_RXBYTES);
+	do {
+		check = count;
+		count = CC110L_ReadStatus(CC110L_RXBYTES);
+	} while (count != check);
+	if (count & CC110L_BYTES_OVERFLOW) { CC110L_isIdle(); return 0; }
+	if (count == 0) { return 0; }
+	
+	/* Read the length and, if the packet is all there, the rest of it */
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_READ_BURST);
+	length = CommCC110L_Exchange(0x00);
+	if ((length > maxLength) || (length > CC110L_MAX_PAYLOAD) || (count < (length + 3))) {
+		CommCC110L_Deselect();
+		CC110L_Strobe(CC110L_SFRX); // drop the rest of the packet
+		return 0;
+	}
+	for (count = 0; count < length; count = count + 1) { pData[count] = CommCC110L_Exchange(0x00); }
+	CommCC110L_Exchange(0x00); // RSSI
+	status = CommCC110L_Exchange(0x00); // LQI and CRC_OK
+	CommCC110L_Deselect();
+	
+	/* Drop a packet with a bad CRC */
+	if ((status & CC110L_LQI_CRCOK) == 0) { return 0; }
+	
+	return length;
+}
+
+
 /***************************************************************************//**
  * @brief Stores the new character that is received on the serial communication
  *        into the input buffer.
@@ -74,14 +518,8 @@ unsigned char CC110L_IncrementIndex(unsigned char idx, unsigned char max) {
  * @return None.
 *******************************************************************************/
 void CC110L_RC_WriteBuffer(unsigned char data) {
-	/* Write the data to the current head of the buffer */
-	SSP_RC_BUFFER[SSP_RC_HEAD] = data;
-	
-	/* Increment the head of the buffer */
-	SSP_RC_HEAD = CC110L_IncrementIndex(SSP_RC_HEAD, SSP_MAX_RC_SIZE);
-	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (SSP_RC_HEAD == SSP_RC_TAIL) { SSP_RC_TAIL = CC110L_IncrementIndex(SSP_RC_TAIL, SSP_MAX_RC_SIZE); }
+	/* Write the data to the head of the buffer (the byte is dropped when full) */
+	RING_PUT(SSP_RC, data);
 }
 
 /***************************************************************************//**
@@ -94,17 +532,8 @@ void CC110L_RC_WriteBuffer(unsigned char data) {
 unsigned char CC110L_RC_ReadBuffer() {
 	unsigned char data;
 	
-	/* Temporarily disable the interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
 	/* Read the data from the end of the buffer */
-	data = SSP_RC_BUFFER[SSP_RC_TAIL];
-	
-	/* Increment the tail of the buffer */
-	SSP_RC_TAIL = CC110L_IncrementIndex(SSP_RC_TAIL, SSP_MAX_RC_SIZE);
-	
-	/* Re-enable the interrupt */
-	INTERRUPT_GLOBAL = 1;
+	RING_GET(SSP_RC, data);
 	
 	return data;
 }
@@ -124,9 +553,156 @@ void CC110L_RC_ReadByte() {
     
 	/* Read the data from the RC register */
 	CC110L_RC_WriteBuffer(data);
+}
+
+/***************************************************************************//**
+ * @brief Reads one packed ADS1298 frame (see Frame.h) from the implant, as a
+ *        single burst once the implant signals one on DRDY. The burst length
+ *        must match the size the header gives.
+ *
+ * @param data - Buffer of at least FRAME_MAX_SIZE bytes storing the frame.
+ * 
+ * @return Size of the frame (FRAME_REPORT_SIZE for a drop report), 0 if no 
+ *         frame was ready or it was malformed.
+*******************************************************************************/
+unsigned char CC110L_RC_ReadFrame(unsigned char* data) {
+    unsigned char size;
+    
+    /* Read the burst if the implant has one ready */
+    size = CommCC110L_ReadBurst(data, FRAME_MAX_SIZE);
+    if (size < FRAME_HEADER_SIZE) { return 0; }
+    
+    /* Keep whole frames and drop reports only */
+    if (FRAME_IS_REPORT(data)) { return (size == FRAME_REPORT_SIZE) ? size : 0; }
+    if (size != FRAME_SIZE(data)) { return 0; }
+    
+    return size;
+}
+
+/***************************************************************************//**
+ * @brief Puts the CC110L (radio mode) back in RX for the next packet of the
+ *        implant. The presets return to Idle after every packet received 
+ *        (RXOFF_MODE), so this is called once the packet was read. A packet
+ *        still in the RX FIFO is left to CC110L_RC_ReadPacket first.
+ *
+ * @param None.
+ * 
+ * @return 1 - the chip is receiving again, 0 - it is busy or holds a packet.
+*******************************************************************************/
+unsigned char CC110L_RC_Listen() {
+	if (!CC110L_isIdle()) { return 0; }
+	if (CC110L_ReadStatus(CC110L_RXBYTES) != 0) { return 0; }
+	
+	CC110L_Strobe(CC110L_SRX);
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Forgets the radio packet being unpacked, for a new acquisition.
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_RC_ClearBatch() {
+	packetLength = 0;
+}
+
+/***************************************************************************//**
+ * @brief Reads a radio packet of frames that the implant sent with 
+ *        CC110L_TX_SendBatch (see the packet format in Frame.h) and keeps 
+ *        the radio listening. Every packet is recorded with CC110L_ARQ_Receive
+ *        and one with the poll flag is answered with the acknowledgement 
+ *        right away, so the implant can send its next burst; a duplicate is
+ *        not unpacked again. A new packet is only read once every frame of 
+ *        the last one was unpacked with CC110L_RC_UnpackFrame, so under 
+ *        backpressure the next packet waits in the RX FIFO. Call it on every
+ *        pass of the main loop.
+ *
+ * @param None.
+ * 
+ * @return Number of frames in the packet, 0 if none was read, it was 
+ *         malformed or a duplicate.
+*******************************************************************************/
+unsigned char CC110L_RC_ReadBatch() {
+	unsigned char ack[FRAME_ACK_SIZE];
+	unsigned char length, isNew;
+	
+	/* Unpack the packet read last first */
+	if (packetLength != 0) {
+		CC110L_RC_Listen();
+		return 0;
+	}
+	
+	/* Read the next packet */
+	length = CC110L_RC_ReadPacket(PACKET, CC110L_MAX_PAYLOAD);
+	if ((length < FRAME_PACKET_HEADER_SIZE) || (PACKET[FRAME_PACKET_COUNT] == 0)) {
+		CC110L_RC_Listen();
+		return 0;
+	}
+	
+	/* Answer the poll, then listen for the next packet once it is out */
+	isNew = CC110L_ARQ_Receive(PACKET[FRAME_PACKET_NUMBER], ack);
+	if (PACKET[FRAME_PACKET_NUMBER] & FRAME_PACKET_POLL) { CC110L_TX_SendPacket(ack, FRAME_ACK_SIZE); }
+	CC110L_RC_Listen();
+	if (!isNew) { return 0; }
+	
+	packetLength = length;
+	packetOffset = FRAME_PACKET_HEADER_SIZE;
+	packetIndex = 0;
+	
+	return PACKET[FRAME_PACKET_COUNT];
+}
+
+/***************************************************************************//**
+ * @brief Rebuilds the next frame of the radio packet read last, the reverse
+ *        of CC110L_TX_SendBatch: the channel bitmaps come from the packet 
+ *        header, the sequence number is the one of the first frame plus the
+ *        index of the frame, and the format, flags, tick and samples are
+ *        copied. The frame is then the one the implant queued, so it goes 
+ *        to the host like a frame of the wired link. A packet that ends in
+ *        the middle of a frame is dropped from there on.
+ *
+ * @param data - Buffer of at least FRAME_MAX_SIZE bytes storing the frame.
+ * 
+ * @return Size of the frame, 0 if the packet has no frame left.
+*******************************************************************************/
+unsigned char CC110L_RC_UnpackFrame(unsigned char* data) {
+	unsigned int sequence;
+	unsigned char size, i;
+	
+	/* Nothing left to unpack */
+	if (packetLength == 0) { return 0; }
+	if ((packetOffset + FRAME_PACKED_SIZE(FRAME_HEADER_SIZE)) > packetLength) {
+		packetLength = 0;
+		return 0;
+	}
+	
+	/* Rebuild the header from the packet header and the frame */
+	data[FRAME_CHANNELS1] = PACKET[FRAME_PACKET_CHANNELS1];
+	data[FRAME_CHANNELS2] = PACKET[FRAME_PACKET_CHANNELS2];
+	data[FRAME_FORMAT] = PACKET[packetOffset];
+	data[FRAME_FLAGS] = PACKET[packetOffset + 1];
+	sequence = FRAME_GET_WORD(PACKET, FRAME_PACKET_SEQUENCE) + packetIndex;
+	FRAME_SET_WORD(data, FRAME_SEQUENCE, sequence);
+	
+	/* Drop the rest of a packet that is too short for the frame */
+	size = FRAME_SIZE(data);
+	if ((packetOffset + FRAME_PACKED_SIZE(size)) > packetLength) {
+		packetLength = 0;
+		return 0;
+	}
+	
+	/* Copy the tick and samples */
+	packetOffset = packetOffset + 2;
+	for (i = FRAME_TICK; i < size; i = i + 1) { data[i] = PACKET[packetOffset++]; }
 	
-    /* REMOVE THIS LINE OF CODE. Testing used to send characters to the transmit buffer */
-    CC110L_TX_WriteBuffer(CC110L_RC_ReadBuffer());
+	/* The packet is done after its last frame */
+	packetIndex = packetIndex + 1;
+	if (packetIndex >= PACKET[FRAME_PACKET_COUNT]) { packetLength = 0; }
+	
+	return size;
 }
 
 /***************************************************************************//**
@@ -137,7 +713,7 @@ void CC110L_RC_ReadByte() {
  * @return 1 - data is available to be read, 0 - data is not available.
 *******************************************************************************/
 unsigned char CC110L_RC_isDataAvailable() {
-	return (SSP_RC_HEAD != SSP_RC_TAIL);
+	return !RING_isEMPTY(SSP_RC);
 }
 
 /***************************************************************************//**
@@ -148,7 +724,7 @@ unsigned char CC110L_RC_isDataAvailable() {
  * @return None.
 *******************************************************************************/
 void CC110L_RC_Clear() {
-	SSP_RC_HEAD = SSP_RC_TAIL = 0; // reset the head and the tail to the beginning of the buffer
+	RING_FLUSH(SSP_RC); // drop the unread data (the consumer moves the tail up to the head)
 }
 
 /******************************************************************************/
@@ -163,39 +739,56 @@ void CC110L_RC_Clear() {
  * @return None.
 *******************************************************************************/
 void CC110L_TX_WriteBuffer(unsigned char data) {
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
-	/* Write the data to the current head of the buffer */
-	SSP_TX_BUFFER[SSP_TX_HEAD] = data;
-	
-	/* Increment the head of the buffer */
-	SSP_TX_HEAD = CC110L_IncrementIndex(SSP_TX_HEAD, SSP_MAX_TX_SIZE);
+	/* Write the data to the head of the buffer (the byte is dropped when full) */
+	RING_PUT(SSP_TX, data);
+}
+
+/***************************************************************************//**
+ * @brief Puts multiple bytes of data into the transmit buffer. The bytes are
+ *        queued whole or not at all, so a full buffer never cuts a frame.
+ *
+ * @param data - Pointer to the bytes to write.
+ * @param bytesNumber - Number of bytes to write.
+ * 
+ * @return 1 - the bytes were queued, 0 - the bytes did not fit and were dropped.
+*******************************************************************************/
+unsigned char CC110L_TX_WriteBufferMultiple(unsigned char* data,
+											unsigned char bytesNumber) {
+	/* Frames are binary, so the length is explicit (a 0x00 sample is data) */
+	if (bytesNumber > RING_SPACE(SSP_TX)) { return 0; }
 	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (SSP_TX_HEAD == SSP_TX_TAIL) { SSP_TX_TAIL = CC110L_IncrementIndex(SSP_TX_TAIL, SSP_MAX_RC_SIZE); }
+	/* Copy the bytes to the head of the buffer in at most two runs */
+	RING_WRITE(SSP_TX, data, bytesNumber);
 	
-	/* Re-enable the interrupts */
-	INTERRUPT_GLOBAL = 1;
+	return 1;
 }
 
 /***************************************************************************//**
- * @brief Puts multiple bytes of data into the transmit buffer.
+ * @brief Sends a packet over the CC110L (radio mode): the length byte and the
+ *        payload go into the TX FIFO with one burst write (one header byte 
+ *        for the whole packet), then STX starts the transmission. The chip 
+ *        returns to Idle by itself once the packet is out.
  *
- * @param None.
+ * @param pData - Pointer to the payload (an acknowledgement).
+ * @param length - Size of the payload (up to CC110L_MAX_PAYLOAD).
  * 
- * @return 1 - transfer of data successful, 0 - transfer of data unsuccessful.
+ * @return 1 - the packet is being sent, 0 - too long or the last one is still 
+ *         being sent.
 *******************************************************************************/
-void CC110L_TX_WriteBufferMultiple(unsigned char* data) {
-	/* Iterate through the data */
-	while (*data != 0x00) { // while there is still data in the vector
-		
-		/* Write the data to the buffer */
-		CC110L_TX_WriteBuffer(*data);
-		
-		/* Increment the data address */
-		data = data + 1;
-	}
+unsigned char CC110L_TX_SendPacket(unsigned char* pData, 
+								   unsigned char length) {
+	if ((length == 0) || (length > CC110L_MAX_PAYLOAD)) { return 0; }
+	if (!CC110L_isIdle()) { return 0; }
+	
+	/* Fill the TX FIFO in one burst and start transmitting */
+	CommCC110L_Select();
+	CommCC110L_Exchange(CC110L_FIFO | CC110L_WRITE_BURST);
+	CommCC110L_Exchange(length);
+	while (length-- != 0) { CommCC110L_Exchange(*pData++); }
+	CommCC110L_Deselect();
+	CC110L_Strobe(CC110L_STX);
+	
+	return 1;
 }
 
 /***************************************************************************//**
@@ -206,17 +799,11 @@ void CC110L_TX_WriteBufferMultiple(unsigned char* data) {
  * @return None.
 *******************************************************************************/
 void CC110L_TX_SendByte() {
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
 	/* Write the data at the end of the transmit buffer to the transmit register */
-	CommCC110L_Write(&SSP_TX_BUFFER[SSP_TX_TAIL], 1);
+	CommCC110L_Write(&RING_PEEK(SSP_TX, 0), 1);
 	
 	/* Increment the tail of the buffer */
-	SSP_TX_TAIL = CC110L_IncrementIndex(SSP_TX_TAIL, SSP_MAX_TX_SIZE);
-	
-	/* Re-enable interrupts */
-	INTERRUPT_GLOBAL = 1;
+	RING_SKIP(SSP_TX, 1);
 }
 
 /***************************************************************************//**
@@ -228,7 +815,7 @@ void CC110L_TX_SendByte() {
 *******************************************************************************/
 unsigned char CC110L_TX_isDataAvailable() {
 	/* If data is available, enable the TX interrupts */
-	if (SSP_TX_HEAD != SSP_TX_TAIL) { return 1; }
+	if (!RING_isEMPTY(SSP_TX)) { return 1; }
 	
 	/* If data is not available, disable the TX interrupt */
 	else { return 0; }
@@ -242,7 +829,71 @@ unsigned char CC110L_TX_isDataAvailable() {
  * @return None.
 *******************************************************************************/
 void CC110L_TX_Clear() {
-	SSP_TX_HEAD = SSP_TX_TAIL = 0; // reset the head and the tail to the beginning of the buffer
+	/* The producer may not move the tail, so hold off the consumer */
+	INTERRUPT_GLOBAL = 0;
+	RING_CLEAR(SSP_TX); // reset the head and the tail to the beginning of the buffer
+	INTERRUPT_GLOBAL = 1;
+}
+
+/******************************************************************************/
+/* Retransmission Functions													  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Forgets the radio packets received so far, for a new acquisition.
+ *
+ * @param None.
+ * 
+ * @return None.
+*******************************************************************************/
+void CC110L_ARQ_Clear() {
+	arqNext = 0;
+	arqReceived = 0;
+}
+
+/***************************************************************************//**
+ * @brief Records a radio packet of the implant and builds the acknowledgement
+ *        to send back (see Frame.h). A packet that was already received is 
+ *        acknowledged again but not passed on. A packet more than 
+ *        FRAME_ACK_SPAN ahead means the implant gave up on the older ones, so
+ *        they are skipped. The packets are passed on as they come, the host 
+ *        puts the frames back in order by their sequence numbers.
+ *
+ * @param number - Packet number (FRAME_PACKET_NUMBER of the packet, with or 
+ *                 without the poll flag).
+ * @param pAck - Pointer to the FRAME_ACK_SIZE bytes storing the acknowledgement.
+ * 
+ * @return 1 - new packet, 0 - duplicate.
+*******************************************************************************/
+unsigned char CC110L_ARQ_Receive(unsigned char number,
+								 unsigned char* pAck) {
+	unsigned char ahead = (number - arqNext) & FRAME_PACKET_NUMBER_MASK;
+	unsigned char isNew = 0;
+	
+	/* Packets before the next expected one are all in already */
+	if (ahead < 0x40) {
+		
+		/* Skip the packets the implant gave up on */
+		while (ahead >= FRAME_ACK_SPAN) {
+			arqReceived = arqReceived >> 1;
+			arqNext = (arqNext + 1) & FRAME_PACKET_NUMBER_MASK;
+			ahead = ahead - 1;
+		}
+		
+		isNew = ((arqReceived >> ahead) & 1) == 0;
+		arqReceived = arqReceived | (1u << ahead);
+		
+		/* Move past the packets received in order */
+		while (arqReceived & 1) {
+			arqReceived = arqReceived >> 1;
+			arqNext = (arqNext + 1) & FRAME_PACKET_NUMBER_MASK;
+		}
+	}
+	
+	pAck[FRAME_ACK_NEXT] = arqNext;
+	pAck[FRAME_ACK_BITMAP] = (unsigned char) (arqReceived >> 1);
+	
+	return isNew;
 }
 
 /******************************************************************************/
@@ -87,6 +87,47 @@
 #define CC110L_TXBYTES		0x3A
 #define CC110L_RXBYTES		0x3B
 
+/******************************************************************************/
+/* CC110L Multi-byte Registers												  */
+/******************************************************************************/
+#define CC110L_PATABLE		0x3E
+#define CC110L_FIFO			0x3F	// TX FIFO when written, RX FIFO when read
+
+/******************************************************************************/
+/* CC110L STATUS REGISTER BITS												  */
+/******************************************************************************/
+#define CC110L_MARCSTATE_IDLE				0x01	// Main radio control state: Idle
+#define CC110L_MARCSTATE_RXFIFO_OVERFLOW	0x11	// Main radio control state: RX FIFO overflow (flush with SFRX)
+#define CC110L_MARCSTATE_TXFIFO_UNDERFLOW	0x16	// Main radio control state: TX FIFO underflow (flush with SFTX)
+#define CC110L_BYTES_OVERFLOW				0x80	// RX FIFO overflow (RXBYTES) or TX FIFO underflow (TXBYTES)
+#define CC110L_BYTES_MASK					0x7F	// Number of bytes in the FIFO
+#define CC110L_LQI_CRCOK					0x80	// CRC of the received packet is OK (second appended status byte)
+
+/******************************************************************************/
+/* CC110L FIFO SIZES														  */
+/******************************************************************************/
+#define CC110L_FIFO_SIZE	64	// bytes in each of the TX and RX FIFOs
+#define CC110L_MAX_PAYLOAD	61	// largest packet that fits the RX FIFO with its length byte and 2 status bytes
+
+/******************************************************************************/
+/* CC110L SPI HEADER BITS													  */
+/******************************************************************************/
+#define CC110L_WRITE_SINGLE	0x00	// Write one register
+#define CC110L_WRITE_BURST	0x40	// Write registers from the address up, until CS goes high
+#define CC110L_READ_SINGLE	0x80	// Read one register
+#define CC110L_READ_BURST	0xC0	// Read registers from the address up (status registers need it too)
+
+/******************************************************************************/
+/* CC110L CONFIGURATION PRESETS												  */
+/******************************************************************************/
+#define CC110L_CONFIG_SIZE		47	// IOCFG2 through TEST0, reserved registers included
+#define CC110L_NUM_PRESETS		4
+									// Presets stored in program memory (the ones of the implant)
+#define CC110L_PRESET_38K4		0	//	0 = GFSK 38.4 kBaud, 20 kHz deviation, 101 kHz RX filter
+#define CC110L_PRESET_76K8		1	//	1 = GFSK 76.8 kBaud, 32 kHz deviation, 232 kHz RX filter
+#define CC110L_PRESET_250K		2	//	2 = GFSK 250 kBaud, 127 kHz deviation, 541 kHz RX filter
+#define CC110L_PRESET_500K		3	//	3 = 2-FSK 500 kBaud, 127 kHz deviation, 812 kHz RX filter (GFSK stops at 250 kBaud)
+
 /******************************************************************************/
 /* CC110L CONFIGURATION REGISTER BITS										  */
 /******************************************************************************/
@@ -107,6 +148,19 @@
 /******************************************************************************/
 #define CC110L_IOCFG0_INV		(0b1 << 6)	// Invert output, select active low (1)	
 
+/******************************************************************************/
+/* CC110L GDO Signal Selection (GDOx_CFG in any IOCFG register)				  */
+/******************************************************************************/
+#define CC110L_GDOCFG_RXFIFO_THR		0x00	// Asserts at or above the RX FIFO threshold
+#define CC110L_GDOCFG_RXFIFO_THR_PKT	0x01	// Asserts at or above the RX FIFO threshold or at the end of a packet
+#define CC110L_GDOCFG_TXFIFO_THR		0x02	// Asserts at or above the TX FIFO threshold, de-asserts below it
+#define CC110L_GDOCFG_TXFIFO_FULL		0x03	// Asserts when the TX FIFO is full
+#define CC110L_GDOCFG_RXFIFO_OVERFLOW	0x04	// Asserts when the RX FIFO has overflowed
+#define CC110L_GDOCFG_TXFIFO_UNDERFLOW	0x05	// Asserts when the TX FIFO has underflowed
+#define CC110L_GDOCFG_SYNC_WORD			0x06	// Asserts at the sync word, de-asserts at the end of the packet
+#define CC110L_GDOCFG_CHIP_RDYN			0x29	// Low when the crystal is running
+#define CC110L_GDOCFG_HIGH_Z			0x2E	// High impedance
+
 /******************************************************************************/
 /* CC110L RX FIFO and TX FIFO Thresholds									  */
 /******************************************************************************/
@@ -359,8 +413,38 @@
 /* Initialize the CC110L chip */
 unsigned char CC110L_Initialize();
 
-/* Increments the index value */
-unsigned char CC110L_IncrementIndex(unsigned char idx, unsigned char max);
+/******************************************************************************/
+/* Register Functions														  */
+/******************************************************************************/
+
+/* Sends a command strobe to the CC110L */
+unsigned char CC110L_Strobe(unsigned char strobe);
+
+/* Writes values to the registers of the CC110L */
+void CC110L_WriteRegisters(unsigned char address, 
+						   unsigned char writeNum, 
+						   unsigned char* regVals);
+
+/* Reads values from the registers of the CC110L */
+void CC110L_ReadRegisters(unsigned char address, 
+						  unsigned char readNum, 
+						  unsigned char* regVals);
+
+/* Reads a status register of the CC110L */
+unsigned char CC110L_ReadStatus(unsigned char address);
+
+/* Resets the CC110L */
+void CC110L_Reset();
+
+/* Configures the CC110L with a preset */
+unsigned char CC110L_ApplyPreset(unsigned char newPreset,
+								 unsigned char verify);
+
+/* Compares the registers of the CC110L with the preset applied last */
+unsigned char CC110L_VerifyRegisters();
+
+/* Checks if the CC110L is back in the Idle state */
+unsigned char CC110L_isIdle();
 
 /******************************************************************************/
 /* Receive Functions														  */
@@ -375,6 +459,25 @@ unsigned char CC110L_RC_ReadBuffer();
 /* Reads a byte of data from the RC register */
 void CC110L_RC_ReadByte();
 
+/* Reads a frame of ADS1298 data from the implant */
+unsigned char CC110L_RC_ReadFrame(unsigned char* data);
+
+/* Reads a packet from the RX FIFO of the CC110L */
+unsigned char CC110L_RC_ReadPacket(unsigned char* pData, 
+								   unsigned char maxLength);
+
+/* Puts the CC110L back in RX once it is idle and its RX FIFO is empty */
+unsigned char CC110L_RC_Listen();
+
+/* Forgets the radio packet being unpacked */
+void CC110L_RC_ClearBatch();
+
+/* Reads a radio packet of frames from the implant */
+unsigned char CC110L_RC_ReadBatch();
+
+/* Rebuilds the next frame of the radio packet read last */
+unsigned char CC110L_RC_UnpackFrame(unsigned char* data);
+
 /* Checks if data is available on the RC buffer */
 unsigned char CC110L_RC_isDataAvailable();
 
@@ -389,7 +492,12 @@ void CC110L_RC_Clear();
 void CC110L_TX_WriteBuffer(unsigned char data);
 
 /* Stores multiple new characters to the TX buffer */
-void CC110L_TX_WriteBufferMultiple(unsigned char* data);
+unsigned char CC110L_TX_WriteBufferMultiple(unsigned char* data,
+											unsigned char bytesNumber);
+
+/* Sends a packet over the CC110L with one burst write of the TX FIFO */
+unsigned char CC110L_TX_SendPacket(unsigned char* pData, 
+								   unsigned char length);
 
 /* Sends out a byte on the TX register */
 void CC110L_TX_SendByte();
@@ -400,6 +508,17 @@ unsigned char CC110L_TX_isDataAvailable();
 /* Resets the TX buffer */
 void CC110L_TX_Clear();
 
+/******************************************************************************/
+/* Retransmission Functions													  */
+/******************************************************************************/
+
+/* Forgets the radio packets received so far */
+void CC110L_ARQ_Clear();
+
+/* Records a radio packet and builds its acknowledgement */
+unsigned char CC110L_ARQ_Receive(unsigned char number,
+								 unsigned char* pAck);
+
 /******************************************************************************/
 /* General Functions Part 2													  */
 /******************************************************************************/
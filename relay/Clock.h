@@ -0,0 +1,82 @@
+/***************************************************************************//**
+ *   @file   Clock.h
+ *   @brief  Oscillator configuration and the rates derived from it.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <p18f46k22.h>
+#include <delays.h>
+
+/******************************************************************************/
+/* OSCILLATOR																  */
+/******************************************************************************/
+
+/* The PIC runs from the 16 MHz HFINTOSC (#pragma config FOSC = INTIO67), 
+ * through the 4x PLL for 64 MHz when CLOCK_PLL is set. The SPI dividers, the
+ * baud rate generator, the Timer1 tick and the busy-wait delays are all 
+ * derived from CLOCK_FOSC at compile time, so CLOCK_PLL is the only setting
+ * to change in the firmware. The PLL only runs with the primary clock 
+ * selected (SCS = 00), which INTIO67 makes the HFINTOSC.
+ *
+ * The tick is also part of the frame format: when CLOCK_PLL of the implant
+ * changes, set FRAME_TICK_NS to the new CLOCK_TICK_NS in Frame.h of both the
+ * implant and the relay (and in the host software). The implant does not 
+ * build until its Frame.h matches (see ADS1298.c).
+ *
+ *	OSCCON
+ *	bit 7   (IDLEN):  0   = Device enter Sleep mode on SLEEP instruction
+ *	bit 6-4 (IRCF):   111 = 16 MHz internal RC oscillator
+ *	bit 3   (OSTS):   0   = Device is running from internal oscillator
+ *	bit 2   (HFIOFS): 1   = HFINTOSC frequency is stable
+ *	bit 1-0 (SCS):    00  = Primary clock (the HFINTOSC, through the PLL when PLLEN is set)
+ *	                  1x  = Internal oscillator block (no PLL)
+ */
+#define CLOCK_PLL				1				// 1 = 4x PLL (64 MHz), 0 = HFINTOSC only (16 MHz)
+#define CLOCK_HFINTOSC			16000000ul
+
+#if CLOCK_PLL
+#define CLOCK_FOSC				(4ul * CLOCK_HFINTOSC)
+#define CLOCK_OSCCON			0b01110100
+#else
+#define CLOCK_FOSC				CLOCK_HFINTOSC
+#define CLOCK_OSCCON			0b01110110
+#endif
+
+#define CLOCK_TCY_HZ			(CLOCK_FOSC / 4)				// instruction rate
+#define CLOCK_TCY_PER_US		(CLOCK_TCY_HZ / 1000000ul)		// 16 at 64 MHz, 4 at 16 MHz
+
+/* Switches to CLOCK_FOSC and waits for the PLL to lock */
+#define CLOCK_INITIALIZE()		{ OSCCON = CLOCK_OSCCON; \
+								  OSCTUNEbits.PLLEN = CLOCK_PLL; \
+								  while (CLOCK_PLL && !OSCCON2bits.PLLRDY); }
+
+/******************************************************************************/
+/* DERIVED RATES															  */
+/******************************************************************************/
+
+/* SSPM of the fastest SPI master clock that does not exceed maxHz */
+#define CLOCK_SPI_SSPM(maxHz)	(((CLOCK_FOSC / 4) <= (maxHz)) ? 0b0000 : \
+								 ((CLOCK_FOSC / 16) <= (maxHz)) ? 0b0001 : 0b0010)
+
+#define CLOCK_ADS1298_SCLK_MAX	20000000ul		// ADS1298 tSCLK >= 50 ns
+#define CLOCK_LINK_SCLK_MAX		4000000ul		// PIC SPI slave SCK high and low times >= 1.25 TCY + 30 ns
+#define CLOCK_RADIO_SCLK_MAX	6500000ul		// CC110L burst access fSCLK <= 6.5 MHz
+
+/* 16 bit baud rate generator value (BRGH = 1, BRG16 = 1), rounded */
+#define CLOCK_BAUD_BRG(baud)	((((CLOCK_FOSC / 4) + ((baud) / 2)) / (baud)) - 1)
+
+/* Timer1 tick at FOSC/4 with the 1:8 prescaler, in ns (500 at 64 MHz) */
+#define CLOCK_TICK_NS			(32000ul / (CLOCK_FOSC / 1000000ul))
+
+/* Busy-wait delays (us up to 159 at 64 MHz, ms up to 65535) */
+#define CLOCK_DELAY_US(us)		Delay10TCYx((unsigned char) ((((us) * CLOCK_TCY_PER_US) + 9) / 10))
+#define CLOCK_DELAY_MS(ms)		{ unsigned int clock_ms = (ms); \
+								  while (clock_ms-- != 0) { Delay1KTCYx(CLOCK_TCY_PER_US); } }
+
+#endif	/* CLOCK_H */
\ No newline at end of file
@@ -64,7 +64,7 @@ unsigned char CommCC110L_Initialize() {
 	
 	/* SSP1 Control Register 1 bits */
 	CommCC110L_CLKPOL = 0;      // idle state for clock is low
-	CommCC110L_MODE   = 0b0000; // set frequency of the shift clock (divide clock frequency by 4)
+	CommCC110L_MODE   = CLOCK_SPI_SSPM(CLOCK_LINK_SCLK_MAX); // shift clock within what the implant can follow as a slave
 	CommCC110L_ENABLE = 1;      // enable the SPI
 
 	/* Properly configure the SPI/communication pins */
@@ -76,13 +76,16 @@ unsigned char CommCC110L_Initialize() {
 
 	CommCC110L_DOUT_DIR = 0; // DIN on CC110L is output from PIC
     
+	CommCC110L_CS_DPIN = 1; // no burst (set before the pin becomes an output)
 	CommCC110L_CS_DIR = 0; // CS on CC110L is output from PIC
+	
+	CommCC110L_DRDY_DIR   = 1; // DRDY from the implant is input
+	CommCC110L_DRDY_ANSEL = 0; // clear analog select bit for DRDY input
 
-    /* Define the MSSP 2 Interrupt bits */
-    CommCC110L_SSPINT_ENABLE   = 1;
-    CommCC110L_SSPINT_PRIORITY = 1;
-    CommCC110L_SSPINTERRUPT    = 0;
-    
+	/* The SSP1 flag is polled (there is no SSP1 handler on the relay) */
+	CommCC110L_SSPINT_ENABLE = 0;
+	CommCC110L_SSPINTERRUPT  = 0;
+	
 	return 1;
 }
 
@@ -126,7 +129,123 @@ unsigned char CommCC110L_Read(unsigned char* data,
         while (!CommCC110L_BUFFERFULL); // while transmission has yet to be completed, wait
         *data++ = CommCC110L_DATABUFFER; 
         CommCC110L_SSPINTERRUPT = 0; // reset the interrupt flag
+        CommCC110L_BYTE_GAP();
     }
     
     return bytesNumber;
+}
+
+/***************************************************************************//**
+ * @brief Reads a burst from the implant if it has one ready (DRDY low): one 
+ *        CS assertion around the length byte and that many data bytes (see 
+ *        the link protocol in the implant CommCC110L.c).
+ *
+ * @param data - Data represents the read buffer.
+ * @param maxLength - Size of the read buffer.
+ *
+ * @return Number of read bytes, 0 if no burst was ready or it was too long.
+*******************************************************************************/
+unsigned char CommCC110L_ReadBurst(unsigned char* data,
+                                   unsigned char maxLength)
+{
+    unsigned char length;
+    
+    /* Nothing to read */
+    if (CommCC110L_DRDY_NOT) { return 0; }
+    
+    /* Clock the length and then the burst under a single CS */
+    CommCC110L_CS_DPIN = 0;
+    CommCC110L_Read(&length, 1);
+    if (length > maxLength) { length = 0; } // raising CS aborts the burst on the implant
+    CommCC110L_Read(data, length);
+    CommCC110L_CS_DPIN = 1;
+    
+    return length;
+}
+
+/***************************************************************************//**
+ * @brief Initializes the SPI communication peripheral as the master of a 
+ *        CC110L radio, instead of the master of the wired link to the 
+ *        implant. The radio takes the pins of the link (CS on RA5). SPI mode
+ *        0 (data changes on the falling edge of SCLK and is sampled on the 
+ *        rising edge), SCLK up to the 6.5 MHz of burst access.
+ *
+ * @param None.
+ *
+ * @return 0 - Initialization failed, 1 - Initialization succeeded.
+*******************************************************************************/
+unsigned char CommCC110L_InitializeRadio() {
+	
+	/* Re-initialize the SSP1 control register 1 and the status register */
+	SSP1CON1 = 0x00;
+	SSP1STAT = 0x00;
+	
+	/* SSP1 Status Register bits */
+	CommCC110L_SAMPLING = 0; // input data sampled at the middle of data output time
+	CommCC110L_CLKEDGE  = 1; // transmit occurs on transition from active to idle clock state
+	
+	/* SSP1 Control Register 1 bits */
+	CommCC110L_CLKPOL = 0; // idle state for clock is low
+	CommCC110L_MODE   = CLOCK_SPI_SSPM(CLOCK_RADIO_SCLK_MAX);
+	CommCC110L_ENABLE = 1;
+	
+	/* Properly configure the SPI/communication pins */
+	CommCC110L_SCLK_DIR = 0; // SCLK is output from the PIC
+	
+	CommCC110L_DIN_DIR   = 1; // SO on CC110L is input into the PIC
+	CommCC110L_DIN_ANSEL = 0;
+	
+	CommCC110L_DOUT_DIR = 0; // SI on CC110L is output from the PIC
+	
+	CommCC110L_CS_DPIN = 1; // CS is high before it is driven
+	CommCC110L_CS_DIR  = 0; // CS on CC110L is output from the PIC
+	
+	/* The SSP1 flag is polled */
+	CommCC110L_SSPINT_ENABLE = 0;
+	CommCC110L_SSPINTERRUPT  = 0;
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Brings CS low and waits for the CC110L to pull SO low (CHIP_RDYn), 
+ *        which it does once its crystal oscillator is running.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_Select()
+{
+    CommCC110L_CS_DPIN = 0;
+    while (CommCC110L_DIN_PIN);
+}
+
+/***************************************************************************//**
+ * @brief Brings CS high, which ends a burst access.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_Deselect()
+{
+    CommCC110L_CS_DPIN = 1;
+}
+
+/***************************************************************************//**
+ * @brief Exchanges a byte with the CC110L (radio mode): the byte is clocked 
+ *        out while the reply is clocked in.
+ *
+ * @param data - Byte to send.
+ *
+ * @return Byte received.
+*******************************************************************************/
+unsigned char CommCC110L_Exchange(unsigned char data)
+{
+    CommCC110L_DATABUFFER = data;
+    while (!CommCC110L_SSPINTERRUPT);
+    CommCC110L_SSPINTERRUPT = 0;
+    
+    return CommCC110L_DATABUFFER;
 }
\ No newline at end of file
@@ -47,6 +47,7 @@
 /* INCLUDE FILES															  */
 /******************************************************************************/
 #include <p18f46k22.h>                                                   
+#include "Clock.h"
 
 /******************************************************************************/
 /* DEFINE REGISTER BITS														  */
@@ -79,12 +80,24 @@
 
 #define CommCC110L_DIN_DIR                  TRISCbits.RC4       // Into implant from relay
 #define CommCC110L_DIN_ANSEL                ANSELCbits.ANSC4
+#define CommCC110L_DIN_PIN                  PORTCbits.RC4       // SO of the CC110L (low when the chip is ready)
 
 #define CommCC110L_DOUT_DIR                 TRISCbits.RC5       // Out of implant to relay
 
 #define CommCC110L_CS_DIR                   TRISAbits.RA5       // PIC CS input and output
 #define CommCC110L_CS_DPIN                  LATAbits.LATA5
 
+#define CommCC110L_DRDY_DIR                 TRISBbits.RB0       // DRDY from the implant direction
+#define CommCC110L_DRDY_ANSEL               ANSELBbits.ANSB0
+#define CommCC110L_DRDY_NOT                 PORTBbits.RB0       // low when the implant has a burst ready
+
+/* Gap between the bytes of a read, so the implant (SPI slave) can load the 
+ * next byte before it is clocked. The implant loads it from its high priority
+ * interrupt, so the gap covers the interrupt latency and context save (~50 
+ * TCY) plus a DRDY interrupt that may come first */
+#define CommCC110L_BYTE_GAP_US              5
+#define CommCC110L_BYTE_GAP()               CLOCK_DELAY_US(CommCC110L_BYTE_GAP_US)
+
 /******************************************************************************/
 /* FUNCTIONS PROTOTYPES														  */
 /******************************************************************************/
@@ -100,4 +113,20 @@ unsigned char CommCC110L_Write(unsigned char* data,
 unsigned char CommCC110L_Read(unsigned char* data,
 							   unsigned char bytesNumber);
 
+/* Reads a length-prefixed burst from the implant. */
+unsigned char CommCC110L_ReadBurst(unsigned char* data,
+								   unsigned char maxLength);
+
+/* Initializes the SPI communication peripheral as master of a CC110L radio. */
+unsigned char CommCC110L_InitializeRadio();
+
+/* Brings CS low and waits for the CC110L to be ready. */
+void CommCC110L_Select();
+
+/* Brings CS high. */
+void CommCC110L_Deselect();
+
+/* Exchanges a byte with the CC110L. */
+unsigned char CommCC110L_Exchange(unsigned char data);
+
 #endif	// _CommCC110L_H_
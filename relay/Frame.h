@@ -0,0 +1,199 @@
+/***************************************************************************//**
+ *   @file   Frame.h
+ *   @brief  Format of the ADS1298 frames sent from the implant to the relay.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+#ifndef FRAME_H
+#define FRAME_H
+
+/******************************************************************************/
+/* FRAME FORMAT																  */
+/******************************************************************************/
+
+/* A frame carries one sample of every enabled channel. The header holds one 
+ * channel bitmap per ADS1298 (bit 7 = channel 1, bit 0 = channel 8) and the 
+ * sample format, followed by the samples of the enabled channels, device 1 
+ * first, as two's complement numbers sent MSB first. The sequence number 
+ * counts every DRDY of device 1 (so a gap means frames were lost, whether on
+ * the implant or on the link) and the tick is the free-running timer of the
+ * implant sampled at DRDY, both sent MSB first. 24 and 16 bit samples
+ * take 3 and 2 bytes; 12 bit samples are packed two to every 3 bytes (the 
+ * last byte is half used when the count is odd). Reduced samples were 
+ * rounded and shifted right by the shift in the format byte, so the host 
+ * rescales them by 2^shift.
+ * 
+ *	Offset	Size		Field
+ *	0		1			Channel bitmap of device 1
+ *	1		1			Channel bitmap of device 2
+ *	2		1			Sample format (width and shift)
+ *	3		1			Flags (lead-off, resync, DRDY skew and GPIO)
+ *	4		2			Sequence number (wraps at 65536)
+ *	6		2			Tick at DRDY (FRAME_TICK_NS per tick, wraps)
+ *	8		variable	Samples of the N enabled channels
+ */
+#define FRAME_CHANNELS1			0		// offset of the device 1 channel bitmap
+#define FRAME_CHANNELS2			1		// offset of the device 2 channel bitmap
+#define FRAME_FORMAT			2		// offset of the sample format
+#define FRAME_FLAGS				3		// offset of the flags
+#define FRAME_SEQUENCE			4		// offset of the sequence number (2 bytes)
+#define FRAME_TICK				6		// offset of the DRDY tick (2 bytes)
+#define FRAME_HEADER_SIZE		8		// bytes before the first sample
+#define FRAME_TICK_NS			500		// nanoseconds per tick (CLOCK_TICK_NS of the implant, 2000 with CLOCK_PLL = 0)
+#define FRAME_SAMPLE_SIZE		3		// bytes per full resolution channel sample
+#define FRAME_MAX_CHANNELS		16
+#define FRAME_MAX_SIZE			(FRAME_HEADER_SIZE + (FRAME_MAX_CHANNELS * FRAME_SAMPLE_SIZE))
+
+/******************************************************************************/
+/* Frame Sample Format														  */
+/******************************************************************************/
+#define FRAME_FORMAT_WIDTH		(0b11 << 6)		// Sample width
+#define FRAME_FORMAT_WIDTH_24	(0b00 << 6)		//	00 = 24 bits, 3 bytes per sample
+#define FRAME_FORMAT_WIDTH_16	(0b01 << 6)		//	01 = 16 bits, 2 bytes per sample
+#define FRAME_FORMAT_WIDTH_12	(0b10 << 6)		//	10 = 12 bits, 3 bytes per 2 samples
+#define FRAME_FORMAT_SHIFT		(0b1111 << 0)	// Right shift applied to the 24 bit samples
+
+/******************************************************************************/
+/* Frame Flags																  */
+/******************************************************************************/
+#define FRAME_FLAGS_LOFF1		(0b1 << 7)		// An electrode of device 1 is off (LOFF_STATP/N not 0)
+#define FRAME_FLAGS_LOFF2		(0b1 << 6)		// An electrode of device 2 is off (LOFF_STATP/N not 0)
+#define FRAME_FLAGS_RESYNC		(0b1 << 5)		// The SPI was resynchronised and frames were dropped before this one
+#define FRAME_FLAGS_SKEW		(0b1 << 4)		// DRDY of device 2 lagged DRDY of device 1
+#define FRAME_FLAGS_GPIO		(0b1111 << 0)	// GPIO4 to GPIO1 of device 1
+
+/******************************************************************************/
+/* DROP REPORTS																  */
+/******************************************************************************/
+
+/* A header with no channels and a source in the format byte is a drop report
+ * instead of a frame. It carries the running totals of the frames and bytes 
+ * that one end of the link dropped under its overflow policy, and is sent 
+ * whenever they change. The totals wrap, so the host takes differences. An 
+ * all zero header still means that no frame was sent.
+ * 
+ *	Offset	Size		Field
+ *	0		2			0x00 0x00 (no channels)
+ *	2		1			Source (implant or relay)
+ *	3		1			Overflow policy in use
+ *	4		2			Dropped frames (wraps at 65536)
+ *	6		2			Dropped bytes (wraps at 65536)
+ */
+#define FRAME_REPORT_SOURCE		FRAME_FORMAT	// offset of the source
+#define FRAME_REPORT_POLICY		FRAME_FLAGS		// offset of the overflow policy
+#define FRAME_REPORT_FRAMES		4				// offset of the dropped frames (2 bytes)
+#define FRAME_REPORT_BYTES		6				// offset of the dropped bytes (2 bytes)
+#define FRAME_REPORT_SIZE		FRAME_HEADER_SIZE
+
+#define FRAME_REPORT_IMPLANT	0x01			// dropped from the implant frame queue
+#define FRAME_REPORT_RELAY		0x02			// dropped from the relay serial queue
+
+/******************************************************************************/
+/* RADIO PACKETS															  */
+/******************************************************************************/
+
+/* A radio packet carries a batch of frames with consecutive sequence numbers
+ * and the same channel bitmaps, so the packet header holds them once and each
+ * frame goes without them (4 bytes less per frame). The host rebuilds frame i
+ * with the bitmaps of the packet and sequence number first + i. A gap in the
+ * sequence numbers or a change of channels starts a new packet.
+ * 
+ *	Offset	Size		Field
+ *	0		2			Sequence number of the first frame
+ *	2		1			Number of frames
+ *	3		1			Channel bitmap of device 1
+ *	4		1			Channel bitmap of device 2
+ *	5		1			Poll flag (bit 7) and packet number (bits 6-0, wraps at 128,
+ *						see the acknowledgements)
+ *	6		variable	Frames, each as:
+ *						0	1			Sample format
+ *						1	1			Flags
+ *						2	2			Tick at DRDY
+ *						4	variable	Samples
+ */
+#define FRAME_PACKET_SEQUENCE	0		// offset of the sequence number of the first frame (2 bytes)
+#define FRAME_PACKET_COUNT		2		// offset of the number of frames
+#define FRAME_PACKET_CHANNELS1	3		// offset of the device 1 channel bitmap
+#define FRAME_PACKET_CHANNELS2	4		// offset of the device 2 channel bitmap
+#define FRAME_PACKET_NUMBER		5		// offset of the poll flag and packet number
+#define FRAME_PACKET_HEADER_SIZE	6	// bytes before the first frame
+#define FRAME_PACKET_SAVING		4		// bytes of the frame header held by the packet header
+#define FRAME_PACKET_POLL		0x80	// the relay answers the packet with an acknowledgement
+#define FRAME_PACKET_NUMBER_MASK	0x7F	// packet number bits
+
+/* Size of a frame inside a packet */
+#define FRAME_PACKED_SIZE(frameSize)	((frameSize) - FRAME_PACKET_SAVING)
+
+/******************************************************************************/
+/* ACKNOWLEDGEMENTS															  */
+/******************************************************************************/
+
+/* The implant sends the packets of its retransmit window back to back and 
+ * sets the poll flag on the last one of the burst. The relay answers that one
+ * with the packets it holds, so that the implant only sends the lost ones 
+ * again (selective repeat); packets without the flag get no answer. All the
+ * packets before the next expected one were received, or given up by the 
+ * implant; the bitmap marks the ones received after it. The implant never has
+ * more than FRAME_ACK_SPAN packets in flight, so a packet further ahead means
+ * the implant gave up on the older ones and moves the next expected one up.
+ * The numbers are compared modulo 128, a packet up to 63 ahead is ahead.
+ * 
+ *	Offset	Size		Field
+ *	0		1			Number of the next packet expected (wraps at 128)
+ *	1		1			Packets received after it (bit 0 = next + 1)
+ */
+#define FRAME_ACK_NEXT			0		// offset of the next packet expected
+#define FRAME_ACK_BITMAP		1		// offset of the bitmap of the packets received after it
+#define FRAME_ACK_SIZE			2
+#define FRAME_ACK_SPAN			9		// packets covered by an acknowledgement (next and 8 after it)
+
+/******************************************************************************/
+/* Overflow Policies														  */
+/******************************************************************************/
+/* A full queue drops whole frames, never part of one */
+#define FRAME_POLICY_DROP_NEWEST	0	// the frame being queued is dropped
+#define FRAME_POLICY_DROP_OLDEST	1	// the oldest frame not yet being sent is dropped to make room
+#define FRAME_POLICY_BACKPRESSURE	2	// the producer slows down (the implant decimates, the relay stops reading the link)
+
+/* Running totals of the frames and bytes dropped by a queue */
+typedef struct {
+	unsigned int frames;
+	unsigned int bytes;
+} FrameDrops;
+
+/******************************************************************************/
+/* FRAME MACROS																  */
+/******************************************************************************/
+
+/* 16 bit header field (sequence number or tick) */
+#define FRAME_GET_WORD(pHeader, offset)	((((unsigned int) (pHeader)[offset]) << 8) | (pHeader)[(offset) + 1])
+#define FRAME_SET_WORD(pHeader, offset, w)	{ (pHeader)[offset] = (unsigned char) ((w) >> 8); \
+											  (pHeader)[(offset) + 1] = (unsigned char) (w); }
+
+/* Number of channels set in a bitmap */
+#define FRAME_COUNT_CHANNELS(b)	((((b) >> 7) & 1) + (((b) >> 6) & 1) + (((b) >> 5) & 1) + (((b) >> 4) & 1) + \
+								 (((b) >> 3) & 1) + (((b) >> 2) & 1) + (((b) >> 1) & 1) + ((b) & 1))
+
+/* Size of n samples in bytes for a sample format */
+#define FRAME_SAMPLES_SIZE(format, n)	((((format) & FRAME_FORMAT_WIDTH) == FRAME_FORMAT_WIDTH_16) ? (2 * (n)) : \
+										 (((format) & FRAME_FORMAT_WIDTH) == FRAME_FORMAT_WIDTH_12) ? (((3 * (n)) + 1) / 2) : \
+										 (3 * (n)))
+
+/* Checks if a header is a drop report */
+#define FRAME_IS_REPORT(pHeader)	(((pHeader)[FRAME_CHANNELS1] == 0) && ((pHeader)[FRAME_CHANNELS2] == 0) && \
+									 ((pHeader)[FRAME_REPORT_SOURCE] != 0))
+
+/* Packs a drop report (drops is a FrameDrops) */
+#define FRAME_PACK_REPORT(pHeader, source, policy, drops)	{ (pHeader)[FRAME_CHANNELS1] = 0; \
+															  (pHeader)[FRAME_CHANNELS2] = 0; \
+															  (pHeader)[FRAME_REPORT_SOURCE] = (source); \
+															  (pHeader)[FRAME_REPORT_POLICY] = (policy); \
+															  FRAME_SET_WORD(pHeader, FRAME_REPORT_FRAMES, (drops).frames); \
+															  FRAME_SET_WORD(pHeader, FRAME_REPORT_BYTES, (drops).bytes); }
+
+/* Size of a frame in bytes from its header */
+#define FRAME_SIZE(pHeader)		(FRAME_HEADER_SIZE + FRAME_SAMPLES_SIZE((pHeader)[FRAME_FORMAT], \
+								 FRAME_COUNT_CHANNELS((pHeader)[FRAME_CHANNELS1]) + \
+								 FRAME_COUNT_CHANNELS((pHeader)[FRAME_CHANNELS2])))
+
+#endif	/* FRAME_H */
\ No newline at end of file
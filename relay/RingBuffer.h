@@ -0,0 +1,112 @@
+/***************************************************************************//**
+ *   @file   RingBuffer.h
+ *   @brief  Byte ring buffers with power of 2 sizes.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+/******************************************************************************/
+/* RING BUFFER																  */
+/******************************************************************************/
+
+/* A ring is declared by name and every operation is a macro on that name, so
+ * the buffer, head and tail are plain globals and the size is a constant the
+ * compiler folds into the mask. The size must be a power of 2 (up to 128) and
+ * one byte is kept free to tell a full ring from an empty one.
+ *
+ *	RING_DECLARE(TX, 64);		unsigned char TX_BUFFER[64], TX_HEAD, TX_TAIL
+ *	RING_PUT(TX, data);			append a byte (dropped when the ring is full)
+ *	RING_GET(TX, data);			take the oldest byte (ring must not be empty)
+ *	RING_PEEK(TX, offset)		byte at offset from the oldest, without taking it
+ *	RING_WRITE(TX, pData, n);	append n bytes (check RING_SPACE first)
+ *	RING_READ(TX, pData, n);	take n bytes (check RING_COUNT first)
+ *
+ * Each ring has one producer and one consumer, typically the main loop and an
+ * interrupt. Only the producer writes the head and only the consumer writes 
+ * the tail, and both are single bytes, so every store is one instruction and
+ * the other side sees either the old or the new index, never a mix. The 
+ * producer writes the data before it stores the new head, and the consumer
+ * reads the data before it stores the new tail, so no interrupt masking is 
+ * needed. Indexes are always computed into a local before being stored, so
+ * an unmasked index is never visible. The rules that keep this safe:
+ *
+ *	Producer only		RING_PUT, RING_WRITE
+ *	Consumer only		RING_GET, RING_READ, RING_SKIP, RING_FLUSH, RING_PEEK
+ *	Either side			RING_COUNT, RING_SPACE, RING_isEMPTY, RING_isFULL (a safe estimate)
+ *	Other side stopped	RING_CLEAR
+ *
+ * This is why a full ring drops the new byte: dropping the oldest byte would 
+ * mean the producer moving the tail.
+ *
+ * Cost against the CC110L_IncrementIndex and Serial_IncrementIndex functions
+ * these macros replaced (the old put and get also cleared and set GIEH, 2 TCY
+ * plus the interrupt latency they add). test/RingBench.c times both rings on
+ * the host with gcc -O0, which keeps every call and store as C18 does; the 
+ * PIC18 TCY are counted by hand from the instructions:
+ *
+ *	Operation				PIC18 TCY, IncrementIndex	PIC18 TCY, macro			Host, macro
+ *	advance an index		~24 (call, args, compare)	4							-
+ *	put and get one byte	~36 + ~34 = ~70				~13 + ~11 = ~24				~3x faster
+ *	27 byte block, both ways	27 x ~70 = ~1890			2 x (27 x 6 + 20) = ~360	~3x faster
+ *
+ * (RingBench runs of 2.8x to 3.5x per byte and 2.5x to 2.9x for blocks.)
+ *
+ * The block operations copy in at most two runs (up to the end of the buffer
+ * and then from the start), so the index is only masked once per run. The
+ * host does not gain as much on blocks as the PIC18, whose copy loop is a
+ * MOVFF through POSTINC on both sides.
+ */
+
+/* Declares a ring (compile error when the size is not a power of 2) */
+#define RING_DECLARE(name, size)	unsigned char name##_BUFFER[size]; \
+									volatile unsigned char name##_HEAD, name##_TAIL; \
+									typedef char name##_SIZE_IS_POWER_OF_2[(((size) & ((size) - 1)) == 0) ? 1 : -1]
+
+/* Size, mask and state */
+#define RING_SIZE(name)				(sizeof(name##_BUFFER))
+#define RING_MASK(name)				(RING_SIZE(name) - 1)
+#define RING_COUNT(name)			((unsigned char) (name##_HEAD - name##_TAIL) & RING_MASK(name))
+#define RING_SPACE(name)			(RING_MASK(name) - RING_COUNT(name))
+#define RING_isEMPTY(name)			(name##_HEAD == name##_TAIL)
+#define RING_isFULL(name)			(((name##_HEAD + 1) & RING_MASK(name)) == name##_TAIL)
+#define RING_CLEAR(name)			name##_HEAD = name##_TAIL = 0
+#define RING_FLUSH(name)			name##_TAIL = name##_HEAD
+
+/* Byte operations */
+#define RING_PUT(name, data)		{ unsigned char ring_head = name##_HEAD; \
+									  unsigned char ring_next = (ring_head + 1) & RING_MASK(name); \
+									  if (ring_next != name##_TAIL) { \
+										  name##_BUFFER[ring_head] = (data); \
+										  name##_HEAD = ring_next; } }
+#define RING_GET(name, data)		{ unsigned char ring_tail = name##_TAIL; \
+									  (data) = name##_BUFFER[ring_tail]; \
+									  name##_TAIL = (ring_tail + 1) & RING_MASK(name); }
+#define RING_PEEK(name, offset)		(name##_BUFFER[(name##_TAIL + (offset)) & RING_MASK(name)])
+#define RING_SKIP(name, n)			{ unsigned char ring_tail = (name##_TAIL + (n)) & RING_MASK(name); \
+									  name##_TAIL = ring_tail; }
+
+/* Block operations */
+#define RING_WRITE(name, pData, n)	{ unsigned char* ring_p = (pData); \
+									  unsigned char ring_n = (n); \
+									  unsigned char ring_i = name##_HEAD; \
+									  unsigned char ring_run = RING_SIZE(name) - ring_i; \
+									  if (ring_run > ring_n) { ring_run = ring_n; } \
+									  ring_n = ring_n - ring_run; \
+									  while (ring_run-- != 0) { name##_BUFFER[ring_i++] = *ring_p++; } \
+									  ring_i = ring_i & RING_MASK(name); \
+									  while (ring_n-- != 0) { name##_BUFFER[ring_i++] = *ring_p++; } \
+									  name##_HEAD = ring_i; }
+#define RING_READ(name, pData, n)	{ unsigned char* ring_p = (pData); \
+									  unsigned char ring_n = (n); \
+									  unsigned char ring_i = name##_TAIL; \
+									  unsigned char ring_run = RING_SIZE(name) - ring_i; \
+									  if (ring_run > ring_n) { ring_run = ring_n; } \
+									  ring_n = ring_n - ring_run; \
+									  while (ring_run-- != 0) { *ring_p++ = name##_BUFFER[ring_i++]; } \
+									  ring_i = ring_i & RING_MASK(name); \
+									  while (ring_n-- != 0) { *ring_p++ = name##_BUFFER[ring_i++]; } \
+									  name##_TAIL = ring_i; }
+
+#endif	/* RINGBUFFER_H */
\ No newline at end of file
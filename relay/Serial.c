@@ -2,18 +2,23 @@
 /* INCLUDE FILES															  */
 /******************************************************************************/
 #include "Serial.h"
+#include "Frame.h"
+#include "RingBuffer.h"
 
 /******************************************************************************/
 /* DEFINITIONS  															  */
 /******************************************************************************/
-#define Serial_MAX_TX_SIZE     32
+#define Serial_MAX_TX_SIZE     128 // two frames of FRAME_MAX_SIZE
 #define Serial_MAX_RC_SIZE     32
+#define Serial_BAUD_RATE       115200ul
 
 /******************************************************************************/
 /* GLOBAL VARIABLES															  */
 /******************************************************************************/
-unsigned char Serial_TX_BUFFER[Serial_MAX_TX_SIZE], Serial_RC_BUFFER[Serial_MAX_RC_SIZE];
-unsigned char Serial_TX_HEAD, Serial_TX_TAIL, Serial_RC_HEAD, Serial_RC_TAIL;
+RING_DECLARE(Serial_TX, Serial_MAX_TX_SIZE);
+RING_DECLARE(Serial_RC, Serial_MAX_RC_SIZE);
+static unsigned char Serial_POLICY = FRAME_POLICY_BACKPRESSURE; // FRAME_POLICY_* applied to a full TX buffer
+static FrameDrops Serial_DROPS;                                 // frames and bytes dropped from the TX buffer (main loop only)
 
 /******************************************************************************/
 /* FUNCTIONS																  */
@@ -31,7 +36,7 @@ unsigned char Serial_TX_HEAD, Serial_TX_TAIL, Serial_RC_HEAD, Serial_RC_TAIL;
  * @return None.
 *******************************************************************************/
 unsigned char Serial_Initialize() {
-    unsigned long baud_rate = 34; //416;
+    unsigned int baud_rate = CLOCK_BAUD_BRG(Serial_BAUD_RATE); // 138 at 64 MHz, 34 at 16 MHz
     unsigned char i;
     
     /* Set the pins for the RC pin */
@@ -43,7 +48,7 @@ unsigned char Serial_Initialize() {
     Serial_TX_ANSEL = 0;
     
     /* Set the bits for controlling the baud rate */
-    Serial_BAUDRATE_HB = (baud_rate >> 8); // value needs to be 34
+    Serial_BAUDRATE_HB = (baud_rate >> 8);
     Serial_BAUDRATE_LB = (baud_rate >> 0);
     
 	/* Set the bits for the TxSTA1 register */
@@ -79,26 +84,13 @@ unsigned char Serial_Initialize() {
     Serial_TXINT_PRIORITY = 1; // High priority
     
     /* Initialize the RC and TX buffers */
-    Serial_RC_HEAD = Serial_RC_TAIL = Serial_TX_HEAD = Serial_TX_TAIL = 0;
+    RING_CLEAR(Serial_RC);
+    RING_CLEAR(Serial_TX);
     for (i = 0; i < Serial_MAX_RC_SIZE; i = i + 1) { Serial_RC_BUFFER[i] = 0; }
     
     return 1;
 }
 
-/***************************************************************************//**
- * @brief Increment the specified index and check if the end of the buffer has
- *        been reached. If the end has been reached, the index is wrapped back 
- *        around to the beginning of the buffer.
- *
- * @param None.
- * 
- * @return Incremented index value.
-*******************************************************************************/
-unsigned char Serial_IncrementIndex(unsigned char idx, unsigned char max) {
-	if (++idx == max) { idx = 0; } // increment index; and if buffer end reached, start from beginning
-	return idx; // return the index
-}
-
 /******************************************************************************/
 /* Receive Functions														  */
 /******************************************************************************/
@@ -112,14 +104,8 @@ unsigned char Serial_IncrementIndex(unsigned char idx, unsigned char max) {
  * @return None.
 *******************************************************************************/
 void Serial_RC_WriteBuffer(unsigned char data) {
-	/* Write the data to the current head of the buffer */
-	Serial_RC_BUFFER[Serial_RC_HEAD] = data;
-	
-	/* Increment the head of the buffer */
-	Serial_RC_HEAD = Serial_IncrementIndex(Serial_RC_HEAD, Serial_MAX_RC_SIZE);
-	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (Serial_RC_HEAD == Serial_RC_TAIL) { Serial_RC_TAIL = Serial_IncrementIndex(Serial_RC_TAIL, Serial_MAX_RC_SIZE); }
+	/* Write the data to the head of the buffer (the byte is dropped when full) */
+	RING_PUT(Serial_RC, data);
 }
 
 /***************************************************************************//**
@@ -132,17 +118,8 @@ void Serial_RC_WriteBuffer(unsigned char data) {
 unsigned char Serial_RC_ReadBuffer() {
 	unsigned char data;
 	
-	/* Temporarily disable the interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
 	/* Read the data from the end of the buffer */
-	data = Serial_RC_BUFFER[Serial_RC_TAIL];
-	
-	/* Increment the tail of the buffer */
-	Serial_RC_TAIL = Serial_IncrementIndex(Serial_RC_TAIL, Serial_MAX_RC_SIZE);
-	
-	/* Re-enable the interrupt */
-	INTERRUPT_GLOBAL = 1;
+	RING_GET(Serial_RC, data);
 	
 	return data;
 }
@@ -157,9 +134,6 @@ unsigned char Serial_RC_ReadBuffer() {
 void Serial_RC_ReadByte() {
 	/* Read the data from the RC register */
 	Serial_RC_WriteBuffer(Serial_RC_REGISTER);
-	
-    /* REMOVE THIS LINE OF CODE. Testing used to send characters to the transmit buffer */
-    Serial_TX_WriteBuffer(Serial_RC_ReadBuffer());
 }
 
 /***************************************************************************//**
@@ -170,7 +144,7 @@ void Serial_RC_ReadByte() {
  * @return 1 - data is available to be read, 0 - data is not available.
 *******************************************************************************/
 unsigned char Serial_RC_isDataAvailable() {
-	return (Serial_RC_HEAD != Serial_RC_TAIL);
+	return !RING_isEMPTY(Serial_RC);
 }
 
 /***************************************************************************//**
@@ -181,7 +155,7 @@ unsigned char Serial_RC_isDataAvailable() {
  * @return None.
 *******************************************************************************/
 void Serial_RC_Clear() {
-	Serial_RC_HEAD = Serial_RC_TAIL = 0; // reset the head and the tail to the beginning of the buffer
+	RING_FLUSH(Serial_RC); // drop the unread data (the consumer moves the tail up to the head)
 }
 
 /******************************************************************************/
@@ -196,21 +170,11 @@ void Serial_RC_Clear() {
  * @return None.
 *******************************************************************************/
 void Serial_TX_WriteBuffer(unsigned char data) {
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
-	/* Write the data to the current head of the buffer */
-	Serial_TX_BUFFER[Serial_TX_HEAD] = data;
-	
-	/* Increment the head of the buffer */
-	Serial_TX_HEAD = Serial_IncrementIndex(Serial_TX_HEAD, Serial_MAX_TX_SIZE);
-	
-	/* If you have reached the tail, increment the tail of the buffer */
-	if (Serial_TX_HEAD == Serial_TX_TAIL) { Serial_TX_TAIL = Serial_IncrementIndex(Serial_TX_TAIL, Serial_MAX_RC_SIZE); }
+	/* Write the data to the head of the buffer (the byte is dropped when full) */
+	RING_PUT(Serial_TX, data);
 	
-	/* Re-enable the interrupts */
+	/* Enable the TX interrupt to send it */
 	Serial_TXINT_ENABLE = 1;
-	INTERRUPT_GLOBAL = 1;
 }
 
 /***************************************************************************//**
@@ -232,6 +196,52 @@ void Serial_TX_WriteBufferMultiple(unsigned char* data) {
 	}
 }
 
+/***************************************************************************//**
+ * @brief Puts one frame into the transmit buffer. The frame is queued whole or
+ *        dropped whole (and counted), so the host never gets part of a frame.
+ *        The TX interrupt sends the buffer a byte at a time, so the oldest 
+ *        frame is usually already on the line and FRAME_POLICY_DROP_OLDEST 
+ *        drops the new frame instead.
+ *
+ * @param data - Pointer to the frame.
+ * @param bytesNumber - Size of the frame.
+ * 
+ * @return 1 - the frame was queued, 0 - the frame was dropped.
+*******************************************************************************/
+unsigned char Serial_TX_WriteFrame(unsigned char* data,
+								   unsigned char bytesNumber) {
+	/* Drop the whole frame when it does not fit */
+	if (bytesNumber > RING_SPACE(Serial_TX)) {
+		Serial_DROPS.frames = Serial_DROPS.frames + 1;
+		Serial_DROPS.bytes = Serial_DROPS.bytes + bytesNumber;
+		return 0;
+	}
+	
+	/* Copy the frame to the head of the buffer in at most two runs */
+	RING_WRITE(Serial_TX, data, bytesNumber);
+	
+	/* Enable the TX interrupt to send it */
+	Serial_TXINT_ENABLE = 1;
+	
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Checks if the next frame should be read from the link. Under 
+ *        FRAME_POLICY_BACKPRESSURE that is only once a frame of FRAME_MAX_SIZE
+ *        fits, so the frame waits on the implant (whose own policy applies) 
+ *        instead of being dropped here.
+ *
+ * @param None.
+ * 
+ * @return 1 - a frame can be read, 0 - leave it on the implant.
+*******************************************************************************/
+unsigned char Serial_TX_isFrameSpace() {
+	if (Serial_POLICY != FRAME_POLICY_BACKPRESSURE) { return 1; }
+	
+	return (RING_SPACE(Serial_TX) >= FRAME_MAX_SIZE);
+}
+
 /***************************************************************************//**
  * @brief Outputs a signal byte to the Serial communication line.
  *
@@ -240,17 +250,8 @@ void Serial_TX_WriteBufferMultiple(unsigned char* data) {
  * @return None.
 *******************************************************************************/
 void Serial_TX_SendByte() {
-	/* Temporarily disable interrupts */
-	INTERRUPT_GLOBAL = 0;
-	
 	/* Write the data at the end of the transmit buffer to the transmit register */
-	Serial_TX_REGISTER = Serial_TX_BUFFER[Serial_TX_TAIL];
-	
-	/* Increment the tail of the buffer */
-	Serial_TX_TAIL = Serial_IncrementIndex(Serial_TX_TAIL, Serial_MAX_TX_SIZE);
-	
-	/* Re-enable interrupts */
-	INTERRUPT_GLOBAL = 1;
+	RING_GET(Serial_TX, Serial_TX_REGISTER);
 }
 
 /***************************************************************************//**
@@ -262,7 +263,7 @@ void Serial_TX_SendByte() {
 *******************************************************************************/
 unsigned char Serial_TX_isDataAvailable() {
 	/* If data is available, enable the TX interrupts */
-	if (Serial_TX_HEAD != Serial_TX_TAIL) { Serial_TXINT_ENABLE = 1; }
+	if (!RING_isEMPTY(Serial_TX)) { Serial_TXINT_ENABLE = 1; }
 	
 	/* If data is not available, disable the TX interrupt */
 	else { Serial_TXINT_ENABLE = 0; }
@@ -278,13 +279,40 @@ unsigned char Serial_TX_isDataAvailable() {
  * @return None.
 *******************************************************************************/
 void Serial_TX_Clear() {
-	Serial_TX_HEAD = Serial_TX_TAIL = 0; // reset the head and the tail to the beginning of the buffer
+	/* The producer may not move the tail, so hold off the consumer */
+	INTERRUPT_GLOBAL = 0;
+	RING_CLEAR(Serial_TX); // reset the head and the tail to the beginning of the buffer
+	INTERRUPT_GLOBAL = 1;
 }
 
 /******************************************************************************/
 /* General Functions Part 2													  */
 /******************************************************************************/
 
+/***************************************************************************//**
+ * @brief Sets what happens to a frame that does not fit in the TX buffer.
+ *
+ * @param policy - FRAME_POLICY_*.
+ * 
+ * @return None.
+*******************************************************************************/
+void Serial_SetOverflowPolicy(unsigned char policy) {
+	Serial_POLICY = policy;
+}
+
+/***************************************************************************//**
+ * @brief Gets the running totals of the frames and bytes dropped from the TX
+ *        buffer (for the drop report of Frame.h).
+ *
+ * @param pDrops - Pointer to the structure storing the totals.
+ * 
+ * @return Overflow policy in use.
+*******************************************************************************/
+unsigned char Serial_GetDrops(FrameDrops* pDrops) {
+	*pDrops = Serial_DROPS;
+	return Serial_POLICY;
+}
+
 /***************************************************************************//**
  * @brief Clears both the receive and transmit buffers.
  *
@@ -318,7 +346,11 @@ void Serial_ISR() {
 		if (Serial_TX_isDataAvailable()) {
             /* Write data from the TX buffer to the TX register*/
 			Serial_TX_SendByte();
-			if (Serial_TX_EMPTY) { Serial_TX_SendByte(); }
+			
+			/* A second byte fits while the first one moves to the shift 
+			 * register, if the buffer still holds one (RING_GET does not
+			 * check for an empty buffer) */
+			if (Serial_TX_EMPTY && !RING_isEMPTY(Serial_TX)) { Serial_TX_SendByte(); }
         }
 	}
     
@@ -5,6 +5,8 @@
 /* INCLUDE FILES															  */
 /******************************************************************************/
 #include <p18f46k22.h>
+#include "Clock.h"
+#include "Frame.h"
 
 /******************************************************************************/
 /* DEFINE VARIABLES															  */
@@ -74,9 +76,6 @@
 /* Initialize the EUSART interface */
 unsigned char Serial_Initialize();
 
-/* Increments the index value */
-unsigned char Serial_IncrementIndex(unsigned char idx, unsigned char max);
-
 /******************************************************************************/
 /* Receive Functions														  */
 /******************************************************************************/
@@ -106,6 +105,13 @@ void Serial_TX_WriteBuffer(unsigned char data);
 /* Stores multiple new characters to the TX buffer */
 void Serial_TX_WriteBufferMultiple(unsigned char* data);
 
+/* Stores a whole frame to the TX buffer (or drops it whole) */
+unsigned char Serial_TX_WriteFrame(unsigned char* data,
+								   unsigned char bytesNumber);
+
+/* Checks if the next frame should be read from the link */
+unsigned char Serial_TX_isFrameSpace();
+
 /* Sends out a byte on the TX register */
 void Serial_TX_SendByte();
 
@@ -119,6 +125,12 @@ void Serial_TX_Clear();
 /* General Functions Part 2													  */
 /******************************************************************************/
 
+/* Sets what happens to a frame that does not fit in the TX buffer */
+void Serial_SetOverflowPolicy(unsigned char policy);
+
+/* Gets the frames and bytes dropped from the TX buffer */
+unsigned char Serial_GetDrops(FrameDrops* pDrops);
+
 /* Clears both RC and TX buffers */
 void Serial_ClearAll();
 
@@ -16,9 +16,17 @@
 /******************************************************************************/
 #include <p18f46k22.h>
 
+#include "Clock.h"
 #include "CommCC110L.h"
 #include "CC110L.h"
 #include "Serial.h"
+#include "Frame.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define RELAY_RADIO		1					// 1 - frames come over the CC110L radio, 0 - over the wired link
+#define RELAY_PRESET	CC110L_PRESET_38K4	// radio preset, the one the implant applied
 
 /******************************************************************************/
 /* INTERRUPTS																  */
@@ -30,19 +38,20 @@ void InterruptVectorHigh() {
 }
 
 void InterruptHigh() {
-	//Serial_ISR();
-    Serial_ISR_SimpleResponse();
+	Serial_ISR();
 }
 
 /******************************************************************************/
 /* MAIN FUNCTION															  */
 /******************************************************************************/
 void main() {
-	unsigned char status;
-    unsigned char data[6] = {'a', 'b', 'c', 'd', 0x00, 0x00};
+	unsigned char status, size, policy;
+    unsigned char data[FRAME_MAX_SIZE];
+    unsigned int reported = 0;
+    FrameDrops drops;
 	
-	/* Set the PIC clock frequency */
-    OSCCON = 0b01110110; // set clock to 16 MHz
+	/* Set the PIC clock frequency (see Clock.h) */
+    CLOCK_INITIALIZE();
 	
 	/* Initialize the EUSART communication */
 	status = Serial_Initialize();
@@ -50,12 +59,37 @@ void main() {
     /* Initialize the SPI communication */
     status &= CC110L_Initialize();
     
+    /* Take the radio instead of the wired link */
+    if (RELAY_RADIO) {
+        status &= CC110L_ApplyPreset(RELAY_PRESET, 1);
+        CC110L_RC_ClearBatch();
+        CC110L_ARQ_Clear();
+    }
+    
 	/* Run code indefinitely */
 	if (status) {
 		while (1) {
-            CommCC110L_CS_DPIN = 0;
-            CommCC110L_Read(data, 0x01);
-            CommCC110L_CS_DPIN = 1;
+            /* Under backpressure, leave the next frame on the implant until it fits */
+            if (!Serial_TX_isFrameSpace()) { continue; }
+            
+            /* Read a frame from the implant and pass it on to the host whole.
+             * Over the radio the frames come in packets, which are unpacked 
+             * one frame at a time before the next packet is read; reading
+             * also answers the polls of the implant and keeps the radio in RX */
+            if (RELAY_RADIO) {
+                CC110L_RC_ReadBatch();
+                size = CC110L_RC_UnpackFrame(data);
+            } else {
+                size = CC110L_RC_ReadFrame(data);
+            }
+            if (size != 0) { Serial_TX_WriteFrame(data, size); }
+            
+            /* Tell the host when more frames were dropped here */
+            policy = Serial_GetDrops(&drops);
+            if (drops.frames != reported) {
+                FRAME_PACK_REPORT(data, FRAME_REPORT_RELAY, policy, drops);
+                if (Serial_TX_WriteFrame(data, FRAME_REPORT_SIZE)) { reported = drops.frames; }
+            }
 		}
 	}
 }
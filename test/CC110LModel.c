@@ -0,0 +1,355 @@
+/***************************************************************************//**
+ *   @file   CC110LModel.c
+ *   @brief  Host model of the CC110L SPI interface, for the gcc tests only.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <string.h>
+#include "CC110LModel.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define MODEL_PKTCTRL0		0x08
+#define MODEL_MCSM1			0x17
+#define MODEL_FSCAL3		0x23
+#define MODEL_FSCAL0		0x26
+#define MODEL_STROBE_FIRST	0x30
+#define MODEL_STROBE_LAST	0x3D
+#define MODEL_PATABLE		0x3E
+
+/* Command strobes */
+#define MODEL_SRES			0x30
+#define MODEL_SCAL			0x33
+#define MODEL_SRX			0x34
+#define MODEL_STX			0x35
+#define MODEL_SIDLE			0x36
+#define MODEL_SFRX			0x3A
+#define MODEL_SFTX			0x3B
+
+/* Status registers */
+#define MODEL_PARTNUM		0x30
+#define MODEL_VERSION		0x31
+#define MODEL_MARCSTATE		0x35
+#define MODEL_TXBYTES		0x3A
+#define MODEL_RXBYTES		0x3B
+
+#define MODEL_LQI_CRCOK		0x80
+#define MODEL_BYTES_ERROR	0x80	// TX FIFO underflow or RX FIFO overflow
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+CC110LModel CC110L_MODEL;
+void (*CC110LModel_onTransmit)(unsigned char* pData, unsigned char length) = 0;
+
+static unsigned char selected;		// CS is low
+static unsigned char expectHeader;	// the next byte is a header byte
+static unsigned char address;		// register of the current access
+static unsigned char burst;			// burst bit of the current access
+static unsigned char reading;		// read bit of the current access
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Builds the chip status byte: CHIP_RDYn (always ready), the state and
+ *        the bytes available in the FIFO of the access direction (up to 15).
+ *
+ * @param None.
+ *
+ * @return Chip status byte.
+*******************************************************************************/
+static unsigned char CC110LModel_Status() {
+	unsigned char state, available;
+
+	switch (CC110L_MODEL.marcstate) {
+		case CC110LMODEL_RX:				state = 1; break;
+		case CC110LMODEL_TX:				state = 2; break;
+		case CC110LMODEL_RXFIFO_OVERFLOW:	state = 6; break;
+		case CC110LMODEL_TXFIFO_UNDERFLOW:	state = 7; break;
+		default:							state = 0; break;
+	}
+	available = reading ? CC110L_MODEL.rxCount : (CC110LMODEL_FIFO_SIZE - 1 - CC110L_MODEL.txCount);
+	if (available > 15) { available = 15; }
+
+	return (unsigned char) ((state << 4) | available);
+}
+
+/***************************************************************************//**
+ * @brief Changes the frequency synthesizer calibration results.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void CC110LModel_Calibrate() {
+	unsigned char i;
+
+	for (i = MODEL_FSCAL3; i <= MODEL_FSCAL0; i = i + 1) {
+		CC110L_MODEL.registers[i] = (unsigned char) (CC110L_MODEL.registers[i] + 0x11);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Leaves TX or RX for the state that MCSM1 selects (RX or Idle).
+ *
+ * @param offMode - TXOFF_MODE or RXOFF_MODE field (0 to 3).
+ *
+ * @return None.
+*******************************************************************************/
+static void CC110LModel_Off(unsigned char offMode) {
+	CC110L_MODEL.marcstate = (offMode == 3) ? CC110LMODEL_RX : CC110LMODEL_IDLE;
+}
+
+/***************************************************************************//**
+ * @brief Sends the packet at the front of the TX FIFO (variable length mode).
+ *        A TX FIFO without a whole packet underflows.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void CC110LModel_Transmit() {
+	unsigned char length;
+
+	/* Infinite length: the chip stays in TX and the test drains the FIFO */
+	if ((CC110L_MODEL.registers[MODEL_PKTCTRL0] & 0x03) != 0x01) {
+		CC110L_MODEL.marcstate = CC110LMODEL_TX;
+		return;
+	}
+
+	length = CC110L_MODEL.txFifo[0];
+	if ((CC110L_MODEL.txCount == 0) || (CC110L_MODEL.txCount < length + 1)) {
+		CC110L_MODEL.marcstate = CC110LMODEL_TXFIFO_UNDERFLOW;
+		return;
+	}
+	if (CC110LModel_onTransmit != 0) { CC110LModel_onTransmit(&CC110L_MODEL.txFifo[1], length); }
+	CC110L_MODEL.packets = CC110L_MODEL.packets + 1;
+
+	CC110L_MODEL.txCount = (unsigned char) (CC110L_MODEL.txCount - (length + 1));
+	memmove(CC110L_MODEL.txFifo, &CC110L_MODEL.txFifo[length + 1], CC110L_MODEL.txCount);
+	CC110LModel_Off(CC110L_MODEL.registers[MODEL_MCSM1] & 0x03);
+}
+
+/***************************************************************************//**
+ * @brief Runs a command strobe.
+ *
+ * @param strobe - Address of the strobe.
+ *
+ * @return None.
+*******************************************************************************/
+static void CC110LModel_Strobe(unsigned char strobe) {
+	CC110L_MODEL.strobes = CC110L_MODEL.strobes + 1;
+
+	switch (strobe) {
+		case MODEL_SRES:
+			memset(CC110L_MODEL.registers, CC110LMODEL_RESET_VALUE, CC110LMODEL_NUM_REGISTERS);
+			CC110L_MODEL.txCount = CC110L_MODEL.rxCount = 0;
+			CC110L_MODEL.marcstate = CC110LMODEL_IDLE;
+			break;
+		case MODEL_SCAL:
+			CC110LModel_Calibrate();
+			break;
+		case MODEL_SRX:
+			if (CC110L_MODEL.marcstate == CC110LMODEL_IDLE) { CC110LModel_Calibrate(); }
+			CC110L_MODEL.marcstate = CC110LMODEL_RX;
+			break;
+		case MODEL_STX:
+			if (CC110L_MODEL.marcstate == CC110LMODEL_IDLE) { CC110LModel_Calibrate(); }
+			CC110LModel_Transmit();
+			break;
+		case MODEL_SIDLE:
+			CC110L_MODEL.marcstate = CC110LMODEL_IDLE;
+			break;
+		case MODEL_SFRX:
+			CC110L_MODEL.rxCount = 0;
+			if (CC110L_MODEL.marcstate == CC110LMODEL_RXFIFO_OVERFLOW) { CC110L_MODEL.marcstate = CC110LMODEL_IDLE; }
+			break;
+		case MODEL_SFTX:
+			CC110L_MODEL.txCount = 0;
+			if (CC110L_MODEL.marcstate == CC110LMODEL_TXFIFO_UNDERFLOW) { CC110L_MODEL.marcstate = CC110LMODEL_IDLE; }
+			break;
+		default:
+			break;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Reads a status register.
+ *
+ * @param status - Address of the status register.
+ *
+ * @return Value of the status register.
+*******************************************************************************/
+static unsigned char CC110LModel_ReadStatus(unsigned char status) {
+	switch (status) {
+		case MODEL_PARTNUM:		return 0x00;
+		case MODEL_VERSION:		return 0x07;
+		case MODEL_MARCSTATE:	return CC110L_MODEL.marcstate;
+		case MODEL_TXBYTES:		return (unsigned char) (CC110L_MODEL.txCount |
+									((CC110L_MODEL.marcstate == CC110LMODEL_TXFIFO_UNDERFLOW) ? MODEL_BYTES_ERROR : 0));
+		case MODEL_RXBYTES:		return (unsigned char) (CC110L_MODEL.rxCount |
+									((CC110L_MODEL.marcstate == CC110LMODEL_RXFIFO_OVERFLOW) ? MODEL_BYTES_ERROR : 0));
+		default:				return 0x00;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Powers the modelled chip up: reset values, Idle, empty FIFOs and no
+ *        access counts.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CC110LModel_PowerUp() {
+	memset(&CC110L_MODEL, 0, sizeof(CC110L_MODEL));
+	memset(CC110L_MODEL.registers, CC110LMODEL_RESET_VALUE, CC110LMODEL_NUM_REGISTERS);
+	CC110L_MODEL.marcstate = CC110LMODEL_IDLE;
+	selected = 0;
+	expectHeader = 1;
+}
+
+/***************************************************************************//**
+ * @brief Clears the access counts.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CC110LModel_ClearCounts() {
+	CC110L_MODEL.selects = CC110L_MODEL.headers = CC110L_MODEL.bytes = 0;
+	CC110L_MODEL.strobes = CC110L_MODEL.packets = 0;
+}
+
+/***************************************************************************//**
+ * @brief Delivers a packet over the air. It is received only in RX and only
+ *        when the RX FIFO has room for it and its two status bytes.
+ *
+ * @param pData - Pointer to the payload (the length byte is added).
+ * @param length - Number of payload bytes.
+ * @param crcOk - 1 - the CRC matches, 0 - the packet was corrupted.
+ *
+ * @return 1 - the packet was received, 0 - the chip was not in RX or full.
+*******************************************************************************/
+unsigned char CC110LModel_Receive(unsigned char* pData,
+								  unsigned char length,
+								  unsigned char crcOk) {
+	if (CC110L_MODEL.marcstate != CC110LMODEL_RX) { return 0; }
+	if (CC110L_MODEL.rxCount + length + 3 > CC110LMODEL_FIFO_SIZE) {
+		CC110L_MODEL.marcstate = CC110LMODEL_RXFIFO_OVERFLOW;
+		return 0;
+	}
+
+	CC110L_MODEL.rxFifo[CC110L_MODEL.rxCount++] = length;
+	memcpy(&CC110L_MODEL.rxFifo[CC110L_MODEL.rxCount], pData, length);
+	CC110L_MODEL.rxCount = (unsigned char) (CC110L_MODEL.rxCount + length);
+	CC110L_MODEL.rxFifo[CC110L_MODEL.rxCount++] = 0x80; // RSSI
+	CC110L_MODEL.rxFifo[CC110L_MODEL.rxCount++] = crcOk ? (MODEL_LQI_CRCOK | 0x10) : 0x10;
+	CC110LModel_Off((CC110L_MODEL.registers[MODEL_MCSM1] >> 2) & 0x03);
+
+	return 1;
+}
+
+/******************************************************************************/
+/* SPI INTERFACE (stands in for CommCC110L.c)								  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Takes the SPI as the radio master. Nothing to set up in the model.
+ *
+ * @param None.
+ *
+ * @return 1.
+*******************************************************************************/
+unsigned char CommCC110L_InitializeRadio() {
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief Brings CS low: the next byte is a header byte.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_Select() {
+	selected = 1;
+	expectHeader = 1;
+	CC110L_MODEL.selects = CC110L_MODEL.selects + 1;
+}
+
+/***************************************************************************//**
+ * @brief Brings CS high, which ends a burst access.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+void CommCC110L_Deselect() {
+	selected = 0;
+	expectHeader = 1;
+}
+
+/***************************************************************************//**
+ * @brief Exchanges one byte with the modelled chip.
+ *
+ * @param data - Byte sent to the chip.
+ *
+ * @return Byte received from the chip.
+*******************************************************************************/
+unsigned char CommCC110L_Exchange(unsigned char data) {
+	unsigned char value = 0x00;
+
+	CC110L_MODEL.bytes = CC110L_MODEL.bytes + 1;
+	if (!selected) { return 0xFF; }
+
+	/* Header byte: a strobe runs at once, anything else waits for its data */
+	if (expectHeader) {
+		CC110L_MODEL.headers = CC110L_MODEL.headers + 1;
+		reading = data & 0x80;
+		burst = data & 0x40;
+		address = data & 0x3F;
+		value = CC110LModel_Status();
+		if ((address >= MODEL_STROBE_FIRST) && (address <= MODEL_STROBE_LAST) && !burst) {
+			CC110LModel_Strobe(address);
+		} else {
+			expectHeader = 0;
+		}
+		return value;
+	}
+
+	/* Data byte */
+	if (address < CC110LMODEL_NUM_REGISTERS) {
+		value = reading ? CC110L_MODEL.registers[address] : CC110LModel_Status();
+		if (!reading) { CC110L_MODEL.registers[address] = data; }
+		if (burst) { address = address + 1; }
+	} else if (address <= MODEL_STROBE_LAST) {
+		value = CC110LModel_ReadStatus(address);
+		burst = 0; // status registers are read one at a time
+	} else if (address == MODEL_PATABLE) {
+		value = reading ? CC110L_MODEL.patable : CC110LModel_Status();
+		if (!reading) { CC110L_MODEL.patable = data; }
+	} else if (reading) {
+		if (CC110L_MODEL.rxCount != 0) {
+			value = CC110L_MODEL.rxFifo[0];
+			CC110L_MODEL.rxCount = CC110L_MODEL.rxCount - 1;
+			memmove(CC110L_MODEL.rxFifo, &CC110L_MODEL.rxFifo[1], CC110L_MODEL.rxCount);
+		}
+	} else {
+		value = CC110LModel_Status();
+		if (CC110L_MODEL.txCount < CC110LMODEL_FIFO_SIZE) {
+			CC110L_MODEL.txFifo[CC110L_MODEL.txCount++] = data;
+		} else {
+			CC110L_MODEL.marcstate = CC110LMODEL_TXFIFO_UNDERFLOW;
+		}
+	}
+	if (!burst) { expectHeader = 1; }
+
+	return value;
+}
\ No newline at end of file
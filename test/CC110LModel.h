@@ -0,0 +1,79 @@
+/***************************************************************************//**
+ *   @file   CC110LModel.h
+ *   @brief  Host model of the CC110L SPI interface, for the gcc tests only.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+#ifndef CC110LMODEL_H
+#define CC110LMODEL_H
+
+/******************************************************************************/
+/* CC110L MODEL																  */
+/******************************************************************************/
+
+/* The model stands in for CommCC110L_Select, CommCC110L_Deselect and
+ * CommCC110L_Exchange of the radio mode, so CC110L.c runs unchanged against
+ * it. It decodes every header byte as the chip does (read/write bit, burst
+ * bit, 6 bit address) and keeps:
+ *
+ *	configuration registers		0x00 - 0x2E, burst access auto-increments
+ *	command strobes				0x30 - 0x3D written without the burst bit
+ *	status registers			0x30 - 0x3D read with the burst bit
+ *	PATABLE						0x3E, one entry
+ *	TX and RX FIFOs				0x3F, 64 bytes each
+ *
+ * Radio time does not pass: STX sends a whole variable length packet from
+ * the TX FIFO at once (to CC110LModel_onTransmit) and the chip then enters
+ * the TXOFF_MODE state of MCSM1. CC110LModel_Receive puts a packet in the RX
+ * FIFO (with the appended RSSI and LQI/CRC bytes) when the chip is in RX and
+ * then enters the RXOFF_MODE state. SRES sets every configuration register
+ * to CC110LMODEL_RESET_VALUE, and SCAL, SRX and STX change FSCAL3 to FSCAL0
+ * as a calibration does. */
+#define CC110LMODEL_NUM_REGISTERS	0x2F
+#define CC110LMODEL_FIFO_SIZE		64
+#define CC110LMODEL_RESET_VALUE		0xEE	// not a value of any preset
+
+/* MARCSTATE values of the model */
+#define CC110LMODEL_IDLE			0x01
+#define CC110LMODEL_RX				0x0D
+#define CC110LMODEL_TX				0x13
+#define CC110LMODEL_RXFIFO_OVERFLOW	0x11
+#define CC110LMODEL_TXFIFO_UNDERFLOW	0x16
+
+/* State of the modelled chip, open to the tests */
+typedef struct {
+	unsigned char registers[CC110LMODEL_NUM_REGISTERS];
+	unsigned char patable;
+	unsigned char marcstate;
+	unsigned char txFifo[CC110LMODEL_FIFO_SIZE];
+	unsigned char txCount;
+	unsigned char rxFifo[CC110LMODEL_FIFO_SIZE];
+	unsigned char rxCount;
+	unsigned int selects;		// CS assertions
+	unsigned int headers;		// header bytes (accesses)
+	unsigned int bytes;			// bytes exchanged, headers included
+	unsigned int strobes;		// command strobes
+	unsigned int packets;		// packets sent with STX
+} CC110LModel;
+
+extern CC110LModel CC110L_MODEL;
+
+/* Called with every packet sent (length byte excluded), 0 to drop them */
+extern void (*CC110LModel_onTransmit)(unsigned char* pData, unsigned char length);
+
+/******************************************************************************/
+/* FUNCTIONS PROTOTYPES														  */
+/******************************************************************************/
+
+/* Powers the modelled chip up: reset values, Idle, empty FIFOs, no counts */
+void CC110LModel_PowerUp();
+
+/* Clears the access counts */
+void CC110LModel_ClearCounts();
+
+/* Delivers a packet over the air, 1 - received, 0 - the chip was not in RX */
+unsigned char CC110LModel_Receive(unsigned char* pData,
+								  unsigned char length,
+								  unsigned char crcOk);
+
+#endif	/* CC110LMODEL_H */
\ No newline at end of file
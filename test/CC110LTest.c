@@ -0,0 +1,332 @@
+/***************************************************************************//**
+ *   @file   CC110LTest.c
+ *   @brief  Host test of the implant CC110L radio driver against CC110LModel.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include "CommCC110L.h"
+#include "CC110L.h"
+#include "ADS1298.h"
+#include "CC110LModel.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define CHECK(condition)	Test_Check((condition), #condition, __LINE__)
+
+#define TEST_XOSC_HZ		26000000.0	// crystal of the CC110L
+#define TEST_RATE_ERROR		0.01		// data rate error allowed by a preset
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static unsigned int checks;
+static unsigned int failures;
+static unsigned char sentNumbers[16];		// FRAME_PACKET_NUMBER of the packets sent
+static unsigned char sentCount;
+
+/******************************************************************************/
+/* LINK AND FRAME QUEUE (not used by these tests)							  */
+/******************************************************************************/
+unsigned char CommCC110L_Initialize() { return 1; }
+void CommCC110L_BeginBurst(unsigned char length) { }
+unsigned char CommCC110L_WriteBurst(unsigned char* data, unsigned char bytesNumber) { return bytesNumber; }
+unsigned char CommCC110L_Write(unsigned char* data, unsigned char bytesNumber) { return bytesNumber; }
+unsigned char CommCC110L_Read(unsigned char* data, unsigned char bytesNumber) { return bytesNumber; }
+unsigned char CommCC110L_StartBurst(unsigned char* data, unsigned char bytesNumber) { return 1; }
+unsigned char CommCC110L_isBusy() { return 0; }
+unsigned char* ADS1298_PeekFrame(unsigned char* pLength) { return 0; }
+void ADS1298_ReleaseFrame() { }
+unsigned int ADS1298_GetSequence() { return 0; }
+void ADS1298_ReadISR() { }
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a check and reports it when it fails.
+ *
+ * @param condition - Result of the check.
+ * @param pText - Text of the check.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* pText, int line) {
+	checks = checks + 1;
+	if (!condition) {
+		failures = failures + 1;
+		printf("CC110LTest.c:%d: failed: %s\n", line, pText);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Works out the data rate that MDMCFG4 and MDMCFG3 of the model set.
+ *
+ * @param None.
+ *
+ * @return Data rate in Baud.
+*******************************************************************************/
+static double Test_DataRate() {
+	unsigned char exponent = CC110L_MODEL.registers[CC110L_MDMCFG4] & 0x0F;
+	unsigned char mantissa = CC110L_MODEL.registers[CC110L_MDMCFG3];
+
+	return ((256.0 + mantissa) * (double) (1ul << exponent) * TEST_XOSC_HZ) / (double) (1ul << 28);
+}
+
+/***************************************************************************//**
+ * @brief Applies every preset with verification and checks that it went out
+ *        as one burst and sets the rate and packet format it names.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Presets() {
+	static const double rates[CC110L_NUM_PRESETS] = { 38400.0, 76800.0, 250000.0, 500000.0 };
+	double rate;
+	unsigned char p, i, modulation;
+
+	for (p = 0; p < CC110L_NUM_PRESETS; p = p + 1) {
+		CC110LModel_PowerUp();
+		CHECK(CC110L_ApplyPreset(p, 1) == 1);
+
+		/* Reset (CS strobe, SRES), preset burst, PATABLE, read-back burst */
+		CHECK(CC110L_MODEL.selects == 5);
+		CHECK(CC110L_MODEL.headers == 4);
+		CHECK(CC110L_MODEL.bytes == 1 + (1 + CC110L_CONFIG_SIZE) + 2 + (1 + CC110L_CONFIG_SIZE));
+
+		/* Every configuration register was written */
+		for (i = 0; i < CC110L_CONFIG_SIZE; i = i + 1) {
+			if ((i >= CC110L_FSCAL3) && (i <= CC110L_FSCAL0)) { continue; }
+			CHECK(CC110L_MODEL.registers[i] != CC110LMODEL_RESET_VALUE);
+		}
+		CHECK(CC110L_MODEL.patable != 0);
+		CHECK(CC110L_MODEL.marcstate == CC110LMODEL_IDLE);
+
+		/* The rate and format the preset names */
+		rate = Test_DataRate();
+		CHECK((rate > rates[p] * (1.0 - TEST_RATE_ERROR)) && (rate < rates[p] * (1.0 + TEST_RATE_ERROR)));
+		modulation = CC110L_MODEL.registers[CC110L_MDMCFG2] & (0b111 << 4);
+		CHECK(modulation == ((p == CC110L_PRESET_500K) ? CC110L_MDMCFG2_MODFORMAT_2FSK : CC110L_MDMCFG2_MODFORMAT_GFSK));
+		CHECK((CC110L_MODEL.registers[CC110L_PKTCTRL0] & 0x03) == CC110L_PKTCTRL0_LENGTH_VARIABLE);
+		CHECK((CC110L_MODEL.registers[CC110L_PKTCTRL0] & CC110L_PKTCTRL0_CRCEN) != 0);
+
+		printf("preset %u: %.0f Baud, %u bytes in %u CS cycles\n", p, rate,
+			   CC110L_MODEL.bytes, CC110L_MODEL.selects);
+	}
+
+	/* An unknown preset is refused without touching the chip */
+	CC110LModel_ClearCounts();
+	CHECK(CC110L_ApplyPreset(CC110L_NUM_PRESETS, 1) == 0);
+	CHECK(CC110L_MODEL.bytes == 0);
+}
+
+/***************************************************************************//**
+ * @brief Checks that the read-back catches a changed register and ignores a
+ *        new frequency synthesizer calibration.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Verify() {
+	CC110LModel_PowerUp();
+	CHECK(CC110L_ApplyPreset(CC110L_PRESET_250K, 0) == 1);
+	CHECK(CC110L_VerifyRegisters() == 1);
+
+	CC110L_MODEL.registers[CC110L_MDMCFG4] ^= 0x01;
+	CHECK(CC110L_VerifyRegisters() == 0);
+	CC110L_MODEL.registers[CC110L_MDMCFG4] ^= 0x01;
+
+	CC110L_MODEL.registers[CC110L_TEST0] ^= 0x80;
+	CHECK(CC110L_VerifyRegisters() == 0);
+	CC110L_MODEL.registers[CC110L_TEST0] ^= 0x80;
+
+	CC110L_Strobe(CC110L_SCAL);
+	CHECK(CC110L_VerifyRegisters() == 1);
+}
+
+/***************************************************************************//**
+ * @brief Checks the single-header FIFO bursts and the recovery of a TX FIFO
+ *        underflow.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Fifo() {
+	unsigned char data[CC110L_MAX_PAYLOAD];
+	unsigned char i;
+
+	for (i = 0; i < CC110L_MAX_PAYLOAD; i = i + 1) { data[i] = (unsigned char) (100 + (3 * i)); }
+
+	CC110LModel_PowerUp();
+	CHECK(CC110L_ApplyPreset(CC110L_PRESET_500K, 0) == 1);
+	CC110LModel_ClearCounts();
+	CC110L_WriteFifo(data, CC110L_MAX_PAYLOAD);
+	CHECK(CC110L_MODEL.headers == 1);
+	CHECK(CC110L_MODEL.bytes == 1 + CC110L_MAX_PAYLOAD);
+	CHECK(CC110L_ReadStatus(CC110L_TXBYTES) == CC110L_MAX_PAYLOAD);
+
+	/* A length byte (100) larger than the FIFO holds underflows */
+	CC110L_Strobe(CC110L_STX);
+	CHECK(CC110L_MODEL.marcstate == CC110LMODEL_TXFIFO_UNDERFLOW);
+	CHECK(CC110L_isIdle() == 1);
+	CHECK(CC110L_MODEL.txCount == 0);
+
+	/* A whole packet goes out and the chip returns to Idle */
+	CHECK(CC110L_TX_SendPacket(data, 20) == 1);
+	CHECK(CC110L_MODEL.packets == 1);
+	CHECK(CC110L_isIdle() == 1);
+
+	/* A received packet is read in one burst, a bad CRC drops it */
+	CC110L_Strobe(CC110L_SRX);
+	CHECK(CC110LModel_Receive(data, 12, 1) == 1);
+	for (i = 0; i < 12; i = i + 1) { data[i] = 0; }
+	CHECK(CC110L_RC_ReadPacket(data, CC110L_MAX_PAYLOAD) == 12);
+	CHECK((data[0] == 100) && (data[11] == 133));
+	CC110L_Strobe(CC110L_SRX);
+	CHECK(CC110LModel_Receive(data, 12, 0) == 1);
+	CHECK(CC110L_RC_ReadPacket(data, CC110L_MAX_PAYLOAD) == 0);
+}
+
+/***************************************************************************//**
+ * @brief Records the number of every packet the model sends.
+ *
+ * @param pData - Payload of the packet.
+ * @param length - Size of the payload.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_OnTransmit(unsigned char* pData, unsigned char length) {
+	if (sentCount < sizeof(sentNumbers)) { sentNumbers[sentCount] = pData[FRAME_PACKET_NUMBER]; }
+	sentCount = sentCount + 1;
+}
+
+/***************************************************************************//**
+ * @brief Checks that the retransmission sends the whole window back to back
+ *        with the poll flag on the last packet only, and sends again the 
+ *        packets that the acknowledgement misses or that time out.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Arq() {
+	unsigned char packet[FRAME_PACKET_HEADER_SIZE + 4];
+	unsigned char ack[FRAME_ACK_SIZE];
+	unsigned char n;
+
+	CC110LModel_PowerUp();
+	CHECK(CC110L_ApplyPreset(CC110L_PRESET_500K, 0) == 1);
+	CC110L_ARQ_Configure(CC110L_ARQ_MAX_DEPTH, 1000, 100);
+	CC110LModel_onTransmit = Test_OnTransmit;
+	sentCount = 0;
+	TMR1L = TMR1H = 0;
+
+	/* Three packets go out in one burst, only the last one polls (numbered
+	 * before the next number of CC110L_TX_SendBatch, 0 here) */
+	for (n = 0; n < 3; n = n + 1) {
+		FRAME_SET_WORD(packet, FRAME_PACKET_SEQUENCE, 0);
+		packet[FRAME_PACKET_COUNT] = 1;
+		packet[FRAME_PACKET_CHANNELS1] = 0x80;
+		packet[FRAME_PACKET_CHANNELS2] = 0;
+		packet[FRAME_PACKET_NUMBER] = 125 + n;
+		CHECK(CC110L_ARQ_Send(packet, sizeof(packet)) == 1);
+	}
+	for (n = 0; n < 3; n = n + 1) { CHECK(CC110L_ARQ_Service() == 1); }
+	CHECK(sentCount == 3);
+	CHECK((sentNumbers[0] == 125) && (sentNumbers[1] == 126) && (sentNumbers[2] == (127 | FRAME_PACKET_POLL)));
+	CHECK(CC110L_MODEL.marcstate == CC110LMODEL_RX);
+
+	/* Nothing more goes out until the acknowledgement or its timeout */
+	CHECK(CC110L_ARQ_Service() == 0);
+	CHECK(CC110L_ARQ_isPending() == 1);
+	CHECK(sentCount == 3);
+
+	/* Packet 126 was lost: it alone goes out again, with the poll */
+	ack[FRAME_ACK_NEXT] = 126;
+	ack[FRAME_ACK_BITMAP] = 0x01; // packet 127
+	CHECK(CC110LModel_Receive(ack, FRAME_ACK_SIZE, 1) == 1);
+	CHECK(CC110L_ARQ_Service() == 1);
+	CHECK(sentCount == 4);
+	CHECK(sentNumbers[3] == (126 | FRAME_PACKET_POLL));
+	CHECK(CC110L_ARQ_GetRetransmissions() == 1);
+
+	/* The acknowledgement does not come: packet 126 goes out once more */
+	CHECK(CC110L_ARQ_Service() == 0);
+	TMR1L = 100;
+	CHECK(CC110L_ARQ_Service() == 1);
+	CHECK(sentCount == 5);
+	CHECK(sentNumbers[4] == (126 | FRAME_PACKET_POLL));
+	CHECK(CC110L_ARQ_GetRetransmissions() == 2);
+
+	/* Everything is in (the next number wraps to 0), the window is empty */
+	ack[FRAME_ACK_NEXT] = 0;
+	ack[FRAME_ACK_BITMAP] = 0;
+	CHECK(CC110LModel_Receive(ack, FRAME_ACK_SIZE, 1) == 1);
+	CHECK(CC110L_ARQ_Service() == 0);
+	CHECK(CC110L_ARQ_Service() == 0);
+	CHECK(sentCount == 5);
+	CHECK(CC110L_ARQ_isPending() == 0);
+
+	CC110LModel_onTransmit = 0;
+}
+
+/***************************************************************************//**
+ * @brief Checks that a new packet gives up the packets of the window that an
+ *        acknowledgement could no longer cover, and counts them as dropped.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_ArqSpan() {
+	static const unsigned char numbers[] = { 120, 125, 0, 1 };
+	unsigned char packet[FRAME_PACKET_HEADER_SIZE + 4];
+	FrameDrops drops;
+	unsigned char n;
+
+	CC110LModel_PowerUp();
+	CHECK(CC110L_ApplyPreset(CC110L_PRESET_500K, 0) == 1);
+	CC110L_ARQ_Configure(CC110L_ARQ_MAX_DEPTH, 1000, 100);
+
+	/* Packet 0 (wrapped) is 8 after packet 120, packet 1 is 9 after it */
+	FRAME_SET_WORD(packet, FRAME_PACKET_SEQUENCE, 0);
+	packet[FRAME_PACKET_COUNT] = 2;
+	packet[FRAME_PACKET_CHANNELS1] = 0x80;
+	packet[FRAME_PACKET_CHANNELS2] = 0;
+	for (n = 0; n < sizeof(numbers); n = n + 1) {
+		packet[FRAME_PACKET_NUMBER] = numbers[n];
+		CHECK(CC110L_ARQ_Send(packet, sizeof(packet)) == 1);
+		CC110L_ARQ_GetDrops(&drops);
+		CHECK(drops.frames == ((n < 3) ? 0 : 2));
+		CHECK(drops.bytes == ((n < 3) ? 0 : sizeof(packet)));
+	}
+
+	/* The slot of packet 120 is free again, the fourth one fills the window */
+	packet[FRAME_PACKET_NUMBER] = 2;
+	CHECK(CC110L_ARQ_Send(packet, sizeof(packet)) == 1);
+	packet[FRAME_PACKET_NUMBER] = 3;
+	CHECK(CC110L_ARQ_Send(packet, sizeof(packet)) == 0);
+	CC110L_ARQ_GetDrops(&drops);
+	CHECK(drops.frames == 2);
+}
+
+int main(void) {
+	Test_Presets();
+	Test_Verify();
+	Test_Fifo();
+	Test_Arq();
+	Test_ArqSpan();
+
+	printf("%u checks, %u failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
\ No newline at end of file
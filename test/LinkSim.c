@@ -0,0 +1,453 @@
+/***************************************************************************//**
+ *   @file   LinkSim.c
+ *   @brief  Host simulation of the wired link between the implant and relay.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include "CommCC110L.h"		// relay: CommCC110L_BYTE_GAP_US
+#include "ADS1298.h"		// implant: ADS1298_TCY_*, ADS1298_HR_RATE
+#include "Frame.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define CHECK(condition)	Test_Check((condition), #condition, __LINE__)
+
+/* Both PICs are stepped one TCY at a time (both run at CLOCK_FOSC). Every
+ * step of the two programs below costs the TCY given here, counted by hand
+ * from the PIC18 instructions of the step; the simulation adds up how the
+ * steps wait on each other: the relay waits for DRDY, the SPI shift and its
+ * byte gap, the implant for the end of each byte. A byte the relay clocks
+ * before the implant loaded it is counted as stale.
+ * 
+ * Streaming also runs both MSSP ports of the implant: DRDY (INT0) raises the
+ * frame read, which shifts the frame in on SSP1 at low priority while the
+ * link byte interrupts of SSP2 preempt it, and the frame queue sits between
+ * the read and the main loop. The read costs the ADS1298_TCY_* of ADS1298.h,
+ * so the simulation and the DRDY deadline work from the same numbers. */
+#define SIM_SECONDS				1
+#define SIM_TCY					((unsigned long) SIM_SECONDS * CLOCK_TCY_HZ)
+
+/* SPI shift of one link byte, from the SSPM the relay picks (FOSC/4, /16 or /64) */
+#define SIM_LINK_SSPM			CLOCK_SPI_SSPM(CLOCK_LINK_SCLK_MAX)
+#define SIM_LINK_TCY_PER_BYTE	(8 * ((SIM_LINK_SSPM == 0) ? 1 : (SIM_LINK_SSPM == 1) ? 4 : 16))
+
+/* Relay: main loop and CommCC110L_ReadBurst (SSP1 master, polled) */
+#define SIM_RELAY_TCY_POLL		20			// main loop pass without a burst: isFrameSpace, RC_ReadFrame, DRDY test
+#define SIM_RELAY_TCY_LOAD		4			// loop top and the SSP1BUF write
+#define SIM_RELAY_TCY_STORE		8			// BF poll exit, SSP1BUF read through the pointer, SSP1IF clear
+#define SIM_RELAY_TCY_GAP		(10 * (((CommCC110L_BYTE_GAP_US * CLOCK_TCY_PER_US) + 9) / 10) + 4) // Delay10TCYx, call and return
+#define SIM_RELAY_TCY_LOOP		5			// i++, compare and branch
+#define SIM_RELAY_TCY_LENGTH	16			// length check and the second CommCC110L_Read call
+#define SIM_RELAY_TCY_FRAME		60			// CS high, frame checks, Serial_TX_WriteFrame call
+#define SIM_RELAY_TCY_COPY		6			// RING_WRITE per byte
+
+/* Implant: Implant_StreamData and CommCC110L_ISR (SSP2 slave, interrupt) */
+#define SIM_IMPLANT_TCY_BUSY	10			// one CC110L_TX_isBusy poll
+#define SIM_IMPLANT_TCY_START	100			// ReleaseFrame, GetDrops, PeekFrame and StartBurst up to DRDY low
+#define SIM_IMPLANT_TCY_LOAD	20			// interrupt latency, context save and CommCC110L_ISR up to the SSP2BUF write
+#define SIM_IMPLANT_TCY_DRDY	20			// ADS1298_ISR with INT0 set: tick latch, miss checks, raise the read
+#define SIM_IMPLANT_TCY_CHECK	80			// ADS1298_CheckStatus of both status words
+#define SIM_IMPLANT_TCY_PACK	40			// ADS1298_PackFrame header and return
+#define SIM_IMPLANT_TCY_SAMPLE	30			// ADS1298_PackFrame per 24 bit sample
+
+#define SIM_FRAMES				4			// ADS1298_MAX_FRAMES of the frame queue
+
+/* The link byte interrupt costs ADS1298_TCY_LINK_BYTE in all, as the DRDY
+ * deadline of ADS1298.h assumes */
+#define SIM_IMPLANT_TCY_REST	(ADS1298_TCY_LINK_BYTE - SIM_IMPLANT_TCY_LOAD)
+
+#define SIM_NOT_LOADED			0xFFFF		// SSP2BUF holds no byte of the burst
+
+/* Relay steps */
+enum { RELAY_POLL, RELAY_LOAD, RELAY_SHIFT, RELAY_STORE, RELAY_GAP, RELAY_LOOP, RELAY_LENGTH, RELAY_FRAME };
+
+/* Implant steps (the main loop and both interrupt levels) */
+enum { MAIN_BUSY, MAIN_START };
+enum { HIGH_IDLE, HIGH_LOAD, HIGH_REST };
+enum { LOW_IDLE, LOW_ENTER, LOW_READ, LOW_PACK };
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static unsigned int checks;
+static unsigned int failures;
+
+/* Wires and SSP flags shared by both PICs */
+static struct {
+	unsigned char drdy;				// DRDY, driven by the implant (low when a burst is ready)
+	unsigned char cs;				// CS, driven by the relay
+	unsigned int loaded;			// byte of the burst in SSP2BUF of the implant
+	unsigned char ssp2if;			// a byte was clocked (implant SSP2IF)
+	unsigned long loadedAt;			// TCY at which it was loaded
+} link;
+
+static unsigned long now;			// TCY since the start of the run
+
+/* Relay program */
+static struct {
+	unsigned char step;
+	unsigned long left;				// TCY until the step is done
+	unsigned int index;				// byte of the burst (0 is the length)
+	unsigned int length;			// data bytes of the burst
+	unsigned long frames, bytes, stale;
+	unsigned long margin;			// fewest TCY between the load of a data byte and its shift
+} relay;
+
+/* Implant program */
+static struct {
+	unsigned char main, high, low;	// steps of the main loop and of both interrupts
+	unsigned long mainLeft, highLeft, lowLeft;
+	unsigned char ssp2ie;
+	unsigned char busy;				// CommCC110L_isBusy
+	unsigned int next, left;		// next byte to load and bytes left (BURST_LEFT)
+	unsigned int frameSize;			// size of the frames sent
+	
+	/* Streaming (otherwise a frame is always queued) */
+	unsigned char stream;
+	unsigned long drdyPeriod;		// ADS1298_TCY_PER_FRAME
+	unsigned int rawSize;			// raw bytes shifted in per frame
+	unsigned int channels;
+	unsigned char int0if, readif;	// DRDY and the frame read interrupt (TMR5IF)
+	unsigned char reading;			// frameReading
+	unsigned char queued;			// slots of the frame queue in use, the one being sent included
+	unsigned char sending;
+	unsigned long conversions, read, misses, overruns;
+	unsigned long idle;				// TCY the main loop had nothing to do
+} implant;
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a check and reports it when it fails.
+ *
+ * @param condition - Result of the check.
+ * @param pText - Text of the check.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* pText, int line) {
+	checks = checks + 1;
+	if (!condition) {
+		failures = failures + 1;
+		printf("LinkSim.c:%d: failed: %s\n", line, pText);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Runs one TCY of the relay: the main loop polls DRDY and reads the
+ *        burst under one CS, one byte at a time with a gap after each, then
+ *        copies the frame to the serial ring.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Relay_Tick() {
+	if (--relay.left != 0) { return; }
+
+	switch (relay.step) {
+		case RELAY_POLL:
+			if (link.drdy) {
+				relay.left = SIM_RELAY_TCY_POLL;
+				break;
+			}
+			link.cs = 0;
+			relay.index = 0;
+			relay.step = RELAY_LOAD;
+			relay.left = SIM_RELAY_TCY_LOAD;
+			break;
+
+		/* The shift starts: the implant must have loaded this byte */
+		case RELAY_LOAD:
+			if (link.loaded != relay.index) {
+				relay.stale = relay.stale + 1;
+			} else if ((relay.index != 0) && ((now - link.loadedAt) < relay.margin)) {
+				relay.margin = now - link.loadedAt;
+			}
+			link.loaded = SIM_NOT_LOADED;
+			relay.step = RELAY_SHIFT;
+			relay.left = SIM_LINK_TCY_PER_BYTE;
+			break;
+
+		case RELAY_SHIFT:
+			link.ssp2if = 1;
+			relay.step = RELAY_STORE;
+			relay.left = SIM_RELAY_TCY_STORE;
+			break;
+
+		case RELAY_STORE:
+			relay.step = RELAY_GAP;
+			relay.left = SIM_RELAY_TCY_GAP;
+			break;
+
+		case RELAY_GAP:
+			relay.step = RELAY_LOOP;
+			relay.left = SIM_RELAY_TCY_LOOP;
+			break;
+
+		case RELAY_LOOP:
+			relay.index = relay.index + 1;
+			if (relay.index == 1) {
+				relay.length = implant.frameSize;
+				relay.step = RELAY_LENGTH;
+				relay.left = SIM_RELAY_TCY_LENGTH;
+			} else if (relay.index <= relay.length) {
+				relay.step = RELAY_LOAD;
+				relay.left = SIM_RELAY_TCY_LOAD;
+			} else {
+				link.cs = 1;
+				relay.step = RELAY_FRAME;
+				relay.left = SIM_RELAY_TCY_FRAME + (relay.length * SIM_RELAY_TCY_COPY);
+			}
+			break;
+
+		case RELAY_LENGTH:
+			relay.step = RELAY_LOAD;
+			relay.left = SIM_RELAY_TCY_LOAD;
+			break;
+
+		case RELAY_FRAME:
+			relay.frames = relay.frames + 1;
+			relay.bytes = relay.bytes + relay.length + 1;
+			relay.step = RELAY_POLL;
+			relay.left = SIM_RELAY_TCY_POLL;
+			break;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Runs one TCY of the implant: the high priority interrupt when it is
+ *        taken, then the low priority one, the main loop otherwise. The main
+ *        loop starts a burst as soon as the last one ended and a frame is 
+ *        queued, and the high priority interrupt loads each byte once the
+ *        previous one was clocked. When streaming, DRDY comes every 
+ *        ADS1298_TCY_PER_FRAME and the low priority interrupt reads the frame
+ *        into the queue.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Implant_Tick() {
+
+	/* Conversion done */
+	if (implant.stream && ((now % implant.drdyPeriod) == 0)) {
+		implant.conversions = implant.conversions + 1;
+		implant.int0if = 1;
+	}
+
+	/* Take the high priority interrupt between two instructions */
+	if ((implant.high == HIGH_IDLE) && ((link.ssp2if && implant.ssp2ie) || implant.int0if)) {
+		implant.high = HIGH_LOAD;
+		implant.highLeft = SIM_IMPLANT_TCY_LOAD;
+	}
+
+	/* High priority interrupt */
+	if (implant.high != HIGH_IDLE) {
+		if (--implant.highLeft != 0) { return; }
+
+		if (implant.high == HIGH_LOAD) {
+			if (link.ssp2if && implant.ssp2ie) {
+				link.ssp2if = 0;
+				link.drdy = 1;
+				if (implant.left != 0) {
+					link.loaded = implant.next;
+					link.loadedAt = now;
+					implant.next = implant.next + 1;
+					implant.left = implant.left - 1;
+				} else {
+					implant.ssp2ie = 0;
+					implant.busy = 0;
+				}
+			}
+			implant.high = HIGH_REST;
+			implant.highLeft = SIM_IMPLANT_TCY_REST;
+			
+			/* ADS1298_ISR: the conversion being read or waiting is overwritten */
+			if (implant.int0if) {
+				implant.int0if = 0;
+				if (implant.reading || implant.readif) { implant.misses = implant.misses + 1; }
+				implant.readif = 1;
+				implant.highLeft = implant.highLeft + SIM_IMPLANT_TCY_DRDY;
+			}
+		} else {
+			implant.high = HIGH_IDLE;
+		}
+		return;
+	}
+
+	/* Low priority interrupt: ADS1298_ReadISR */
+	if ((implant.low == LOW_IDLE) && implant.readif) {
+		implant.readif = 0;
+		implant.low = LOW_ENTER;
+		implant.lowLeft = ADS1298_TCY_ISR_OVERHEAD;
+	}
+	if (implant.low != LOW_IDLE) {
+		if (--implant.lowLeft != 0) { return; }
+		
+		if (implant.low == LOW_ENTER) {
+			if (implant.queued == SIM_FRAMES) { // no free slot: drop the conversion
+				implant.overruns = implant.overruns + 1;
+				implant.low = LOW_IDLE;
+				return;
+			}
+			implant.reading = 1;
+			implant.low = LOW_READ;
+			implant.lowLeft = implant.rawSize * ADS1298_TCY_PER_BYTE;
+		} else if (implant.low == LOW_READ) {
+			implant.reading = 0;
+			implant.low = LOW_PACK;
+			implant.lowLeft = SIM_IMPLANT_TCY_CHECK + SIM_IMPLANT_TCY_PACK + (implant.channels * SIM_IMPLANT_TCY_SAMPLE);
+		} else {
+			implant.read = implant.read + 1;
+			implant.queued = implant.queued + 1;
+			implant.low = LOW_IDLE;
+		}
+		return;
+	}
+
+	/* Main loop */
+	if (--implant.mainLeft != 0) { return; }
+
+	if (implant.main == MAIN_BUSY) {
+		if (implant.busy) {
+			implant.mainLeft = SIM_IMPLANT_TCY_BUSY;
+			implant.idle = implant.idle + SIM_IMPLANT_TCY_BUSY;
+			return;
+		}
+		
+		/* The frame was sent, so its slot can be reused */
+		if (implant.sending) {
+			implant.sending = 0;
+			implant.queued = implant.queued - 1;
+		}
+		if (implant.stream && (implant.queued == 0)) {
+			implant.mainLeft = SIM_IMPLANT_TCY_BUSY;
+			implant.idle = implant.idle + SIM_IMPLANT_TCY_BUSY;
+			return;
+		}
+		implant.main = MAIN_START;
+		implant.mainLeft = SIM_IMPLANT_TCY_START;
+	} else {
+		link.loaded = 0; // the length
+		link.loadedAt = now;
+		implant.next = 1;
+		implant.left = implant.frameSize;
+		implant.busy = 1;
+		implant.sending = 1;
+		implant.ssp2ie = 1;
+		link.drdy = 0;
+		implant.main = MAIN_BUSY;
+		implant.mainLeft = SIM_IMPLANT_TCY_BUSY;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Puts both PICs back to the start of a run: no burst, empty queue.
+ *
+ * @param frameSize - Size of the frames.
+ *
+ * @return None.
+*******************************************************************************/
+static void Sim_Reset(unsigned int frameSize) {
+	link.drdy = link.cs = 1;
+	link.loaded = SIM_NOT_LOADED;
+	link.ssp2if = 0;
+	relay.step = RELAY_POLL;
+	relay.left = SIM_RELAY_TCY_POLL;
+	relay.frames = relay.bytes = relay.stale = 0;
+	relay.margin = SIM_TCY;
+	implant.main = MAIN_BUSY;
+	implant.high = HIGH_IDLE;
+	implant.low = LOW_IDLE;
+	implant.mainLeft = SIM_IMPLANT_TCY_BUSY;
+	implant.ssp2ie = implant.busy = implant.sending = 0;
+	implant.frameSize = frameSize;
+	implant.stream = implant.int0if = implant.readif = implant.reading = implant.queued = 0;
+	implant.conversions = implant.read = implant.misses = implant.overruns = implant.idle = 0;
+}
+
+/***************************************************************************//**
+ * @brief Runs the link for SIM_SECONDS with a frame always queued on the
+ *        implant, and prints the sustained rate.
+ *
+ * @param frameSize - Size of the frames.
+ *
+ * @return Frames per second.
+*******************************************************************************/
+static unsigned long Sim_Link(unsigned int frameSize) {
+	unsigned long perFrame;
+
+	Sim_Reset(frameSize);
+	for (now = 0; now < SIM_TCY; now = now + 1) {
+		Relay_Tick();
+		Implant_Tick();
+	}
+
+	perFrame = (relay.frames == 0) ? 0 : (SIM_TCY / relay.frames);
+	printf("%2u byte frames: %5lu TCY/frame, %5lu frames/s, %6lu bytes/s, %lu stale, load %lu TCY ahead\n",
+		   frameSize, perFrame, relay.frames / SIM_SECONDS, relay.bytes / SIM_SECONDS, 
+		   relay.stale, relay.margin);
+
+	return relay.frames / SIM_SECONDS;
+}
+
+/***************************************************************************//**
+ * @brief Streams for SIM_SECONDS (Implant_StreamData with the relay reading
+ *        back to back) and prints what became of the conversions and the 
+ *        CPU time the main loop of the implant had left.
+ *
+ * @param dr - Data rate (ADS1298_CONFIG1_DR_*, HR mode).
+ * @param channels - Enabled channels, 24 bit samples (device 1 first).
+ *
+ * @return Conversions lost (deadline misses and queue overruns).
+*******************************************************************************/
+static unsigned long Sim_Stream(unsigned char dr, unsigned int channels) {
+	unsigned long lost;
+
+	Sim_Reset(FRAME_HEADER_SIZE + (channels * FRAME_SAMPLE_SIZE));
+	implant.stream = 1;
+	implant.drdyPeriod = ADS1298_TCY_PER_FRAME(dr);
+	implant.channels = channels;
+	implant.rawSize = (channels > 8) ? (2 * 27) : 27; // status word and 8 channels per device
+	for (now = 1; now <= SIM_TCY; now = now + 1) {
+		Relay_Tick();
+		Implant_Tick();
+	}
+
+	lost = implant.misses + implant.overruns;
+	printf("%5lu SPS, %2u ch: %5lu read, %5lu sent, %4lu missed, %4lu overrun, %lu stale, CPU left %lu%%\n",
+		   ADS1298_HR_RATE(dr), channels, implant.read, relay.frames, implant.misses, 
+		   implant.overruns, relay.stale, (100ul * implant.idle) / SIM_TCY);
+
+	return lost;
+}
+
+int main(void) {
+
+	/* 8 channels (device 1 only) keep up with DR_2K, 16 channels only with
+	 * DR_1K (see CommCC110L_BeginBurst in the implant) */
+	CHECK(Sim_Link(FRAME_HEADER_SIZE + (8 * FRAME_SAMPLE_SIZE)) >= ADS1298_HR_RATE(ADS1298_CONFIG1_DR_2K));
+	CHECK(relay.stale == 0);
+	CHECK(Sim_Link(FRAME_MAX_SIZE) >= ADS1298_HR_RATE(ADS1298_CONFIG1_DR_1K));
+	CHECK(relay.stale == 0);
+	
+	/* Reads overlapped with the bursts (see CommCC110L_StartBurst) */
+	CHECK(Sim_Stream(ADS1298_CONFIG1_DR_2K, 8) == 0);
+	CHECK(relay.stale == 0);
+	CHECK(Sim_Stream(ADS1298_CONFIG1_DR_1K, 16) == 0);
+	CHECK(relay.stale == 0);
+	CHECK(Sim_Stream(ADS1298_CONFIG1_DR_2K, 16) != 0);
+
+	printf("%u checks, %u failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
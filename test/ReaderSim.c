@@ -0,0 +1,387 @@
+/***************************************************************************//**
+ *   @file   ReaderSim.c
+ *   @brief  Host simulation of the assembly loop of CommADS1298_ReadFrame.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Clock.h"			// implant: CLOCK_SPI_SSPM, CLOCK_ADS1298_SCLK_MAX
+#include "ADS1298.h"		// implant: ADS1298_TCY_PER_BYTE
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define CHECK(condition)	Test_Check((condition), #condition, __LINE__)
+
+/* The _asm block of CommADS1298_ReadFrame is read from the source and run
+ * instruction by instruction with the PIC18 cycle counts: 1 TCY, 2 TCY for
+ * MOVFF, BRA and a taken skip. SSP1 is the master of the ADS1298 bus: a write
+ * of SSP1BUF starts a shift of SIM_SHIFT_TCY, after which BF reads as set and
+ * SSP1BUF holds the byte of the device. BF is first seen by the instruction
+ * after the one in which the shift ends. The C statements around the block
+ * (the pointer and count setup, the flag clear) are not simulated. */
+#define SIM_SOURCE				"implant/CommADS1298.c"
+#define SIM_FUNCTION			"void CommADS1298_ReadFrame("
+#define SIM_SHIFT_TCY			(8 * ((CLOCK_SPI_SSPM(CLOCK_ADS1298_SCLK_MAX) == 0) ? 1 : \
+									  (CLOCK_SPI_SSPM(CLOCK_ADS1298_SCLK_MAX) == 1) ? 4 : 16))
+
+#define SIM_MAX_LINES			32			// instructions and labels of the block
+#define SIM_MAX_STEPS			10000		// instructions after which a run is given up
+#define SIM_RAM					0x100		// address of the frame buffer
+#define SIM_RAM_SIZE			0x200
+#define SIM_GUARD				0xA5		// fill of the bytes that must not be written
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static unsigned int checks;
+static unsigned int failures;
+
+/* The block: mnemonic and up to three operands per line, labels have no mnemonic */
+static char LINES[SIM_MAX_LINES][4][32];
+static char LABELS[SIM_MAX_LINES][32];
+static unsigned char lineCount;
+
+/* Registers the block uses */
+static struct {
+	unsigned char wreg;
+	unsigned char fsr0l, fsr0h;
+	unsigned char readerLow, readerHigh, readerCount;
+	unsigned char ram[SIM_RAM_SIZE];
+} pic;
+
+/* SSP1 and the ADS1298 on the other end */
+static struct {
+	unsigned char buffer;			// SSP1BUF as read
+	unsigned char bf;
+	unsigned long shiftEnd;			// TCY at which the running shift ends, 0 if idle
+	unsigned int shifts;			// shifts started
+	unsigned int collisions;		// SSP1BUF writes during a shift (WCOL)
+} ssp;
+
+static unsigned long tcy;
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a check and reports it when it fails.
+ *
+ * @param condition - Result of the check.
+ * @param pText - Text of the check.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* pText, int line) {
+	checks = checks + 1;
+	if (!condition) {
+		failures = failures + 1;
+		printf("ReaderSim.c:%d: failed: %s\n", line, pText);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Byte the ADS1298 shifts out for a given shift.
+ *
+ * @param index - Shift number, from 0.
+ *
+ * @return Byte.
+*******************************************************************************/
+static unsigned char Sim_SlaveByte(unsigned int index) {
+	return (unsigned char) ((index * 37u) + 11u);
+}
+
+/***************************************************************************//**
+ * @brief Reads the _asm block of CommADS1298_ReadFrame out of the source.
+ *
+ * @param None.
+ *
+ * @return 1 - block read, 0 - not found.
+*******************************************************************************/
+static unsigned char Sim_Load() {
+	FILE* pFile;
+	char text[256];
+	char* pComment;
+	char* pToken;
+	unsigned char inFunction = 0;
+	unsigned char inBlock = 0;
+	unsigned char field;
+
+	pFile = fopen(SIM_SOURCE, "r");
+	if (pFile == 0) { return 0; }
+	while (fgets(text, sizeof(text), pFile) != 0) {
+		if (strncmp(text, SIM_FUNCTION, strlen(SIM_FUNCTION)) == 0) { inFunction = 1; }
+		if (!inFunction) { continue; }
+		if (strstr(text, "_endasm") != 0) { break; }
+		if (strstr(text, "_asm") != 0) { inBlock = 1; continue; }
+		if (!inBlock || (lineCount == SIM_MAX_LINES)) { continue; }
+
+		pComment = strstr(text, "/*");
+		if (pComment != 0) { *pComment = 0; }
+		pToken = strtok(text, " \t\r\n,");
+		if (pToken == 0) { continue; }
+		if (pToken[strlen(pToken) - 1] == ':') {
+			pToken[strlen(pToken) - 1] = 0;
+			strcpy(LABELS[lineCount], pToken);
+		} else {
+			for (field = 0; (pToken != 0) && (field < 4); field = field + 1) {
+				strcpy(LINES[lineCount][field], pToken);
+				pToken = strtok(0, " \t\r\n,");
+			}
+		}
+		lineCount = lineCount + 1;
+	}
+	fclose(pFile);
+
+	return (lineCount != 0);
+}
+
+/***************************************************************************//**
+ * @brief Advances the clock, ending the running shift when its time is up.
+ *
+ * @param cycles - TCY of the instruction just run.
+ *
+ * @return None.
+*******************************************************************************/
+static void Sim_Clock(unsigned char cycles) {
+	tcy = tcy + cycles;
+	if ((ssp.shiftEnd != 0) && (tcy > ssp.shiftEnd)) {
+		ssp.buffer = Sim_SlaveByte(ssp.shifts - 1);
+		ssp.bf = 1;
+		ssp.shiftEnd = 0;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Reads a register of the block.
+ *
+ * @param pName - Register name.
+ *
+ * @return Value.
+*******************************************************************************/
+static unsigned char Sim_Read(const char* pName) {
+	unsigned int address;
+
+	if (strcmp(pName, "SSP1BUF") == 0) { ssp.bf = 0; return ssp.buffer; }
+	if (strcmp(pName, "SSP1STAT") == 0) { return ssp.bf; }
+	if (strcmp(pName, "FSR0L") == 0) { return pic.fsr0l; }
+	if (strcmp(pName, "FSR0H") == 0) { return pic.fsr0h; }
+	if (strcmp(pName, "WREG") == 0) { return pic.wreg; }
+	if (strcmp(pName, "READER_FSR0L") == 0) { return pic.readerLow; }
+	if (strcmp(pName, "READER_FSR0H") == 0) { return pic.readerHigh; }
+	if (strcmp(pName, "READER_COUNT") == 0) { return pic.readerCount; }
+	if (strcmp(pName, "POSTINC0") == 0) {
+		address = ((unsigned int) pic.fsr0h << 8) | pic.fsr0l;
+		if (++pic.fsr0l == 0) { pic.fsr0h = pic.fsr0h + 1; }
+		return (address < SIM_RAM_SIZE) ? pic.ram[address] : 0;
+	}
+	printf("ReaderSim.c: unknown register %s\n", pName);
+	exit(1);
+}
+
+/***************************************************************************//**
+ * @brief Writes a register of the block.
+ *
+ * @param pName - Register name.
+ * @param value - Value.
+ *
+ * @return None.
+*******************************************************************************/
+static void Sim_Write(const char* pName, unsigned char value) {
+	unsigned int address;
+
+	if (strcmp(pName, "SSP1BUF") == 0) {
+		if (ssp.shiftEnd != 0) {
+			ssp.collisions = ssp.collisions + 1;
+		} else {
+			ssp.shifts = ssp.shifts + 1;
+			ssp.shiftEnd = tcy + SIM_SHIFT_TCY;
+		}
+		return;
+	}
+	if (strcmp(pName, "FSR0L") == 0) { pic.fsr0l = value; return; }
+	if (strcmp(pName, "FSR0H") == 0) { pic.fsr0h = value; return; }
+	if (strcmp(pName, "WREG") == 0) { pic.wreg = value; return; }
+	if (strcmp(pName, "READER_COUNT") == 0) { pic.readerCount = value; return; }
+	if (strcmp(pName, "POSTINC0") == 0) {
+		address = ((unsigned int) pic.fsr0h << 8) | pic.fsr0l;
+		if (++pic.fsr0l == 0) { pic.fsr0h = pic.fsr0h + 1; }
+		if (address < SIM_RAM_SIZE) { pic.ram[address] = value; }
+		return;
+	}
+	printf("ReaderSim.c: cannot write %s\n", pName);
+	exit(1);
+}
+
+/***************************************************************************//**
+ * @brief Finds the line of a label.
+ *
+ * @param pName - Label.
+ *
+ * @return Line index.
+*******************************************************************************/
+static unsigned char Sim_Label(const char* pName) {
+	unsigned char line;
+
+	for (line = 0; line < lineCount; line = line + 1) {
+		if (strcmp(LABELS[line], pName) == 0) { return line; }
+	}
+	printf("ReaderSim.c: unknown label %s\n", pName);
+	exit(1);
+}
+
+/***************************************************************************//**
+ * @brief Runs the block for one frame, as CommADS1298_ReadFrame sets it up.
+ *
+ * @param bytesNumber - Frame size.
+ * @param pFirst - TCY from the first SSP1BUF write to the end of the block.
+ *
+ * @return TCY of the whole block.
+*******************************************************************************/
+static unsigned long Sim_Run(unsigned char bytesNumber, unsigned long* pFirst) {
+	unsigned char line = 0;
+	unsigned int steps = 0;
+	unsigned long first = 0;
+	unsigned char value, result, bit;
+	char (*pLine)[32];
+
+	memset(&pic, 0, sizeof(pic));
+	memset(&ssp, 0, sizeof(ssp));
+	memset(pic.ram, SIM_GUARD, sizeof(pic.ram));
+	tcy = 0;
+	pic.readerLow = SIM_RAM & 0xFF;
+	pic.readerHigh = SIM_RAM >> 8;
+	pic.readerCount = bytesNumber - 1;
+
+	while ((line < lineCount) && (steps < SIM_MAX_STEPS)) {
+		pLine = LINES[line];
+		steps = steps + 1;
+		line = line + 1;
+		if (pLine[0][0] == 0) { continue; }							// label
+
+		if (strcmp(pLine[0], "MOVFF") == 0) {
+			Sim_Write(pLine[2], Sim_Read(pLine[1]));
+			Sim_Clock(2);
+		} else if (strcmp(pLine[0], "CLRF") == 0) {
+			if ((first == 0) && (strcmp(pLine[1], "SSP1BUF") == 0)) { first = tcy + 1; }
+			Sim_Write(pLine[1], 0);
+			Sim_Clock(1);
+		} else if (strcmp(pLine[0], "MOVWF") == 0) {
+			Sim_Write(pLine[1], pic.wreg);
+			Sim_Clock(1);
+		} else if (strcmp(pLine[0], "MOVF") == 0) {
+			value = Sim_Read(pLine[1]);
+			if (atoi(pLine[2]) == 0) { pic.wreg = value; } else { Sim_Write(pLine[1], value); }
+			Sim_Clock(1);
+		} else if (strcmp(pLine[0], "BTFSS") == 0) {
+			bit = (Sim_Read(pLine[1]) >> atoi(pLine[2])) & 1;
+			if (bit) { line = line + 1; }
+			Sim_Clock(bit ? 2 : 1);
+		} else if (strcmp(pLine[0], "DECFSZ") == 0) {
+			result = Sim_Read(pLine[1]) - 1;
+			if (atoi(pLine[2]) == 0) { pic.wreg = result; } else { Sim_Write(pLine[1], result); }
+			if (result == 0) { line = line + 1; }
+			Sim_Clock((result == 0) ? 2 : 1);
+		} else if (strcmp(pLine[0], "NOP") == 0) {
+			Sim_Clock(1);
+		} else if (strcmp(pLine[0], "BRA") == 0) {
+			line = Sim_Label(pLine[1]);
+			Sim_Clock(2);
+		} else {
+			printf("ReaderSim.c: unknown instruction %s\n", pLine[0]);
+			exit(1);
+		}
+	}
+	CHECK(steps < SIM_MAX_STEPS);
+
+	*pFirst = tcy - first + 1;
+	return tcy;
+}
+
+/***************************************************************************//**
+ * @brief Reads the TCY the doc comment of CommADS1298_ReadFrame gives for a
+ *        frame size (the table above the function).
+ *
+ * @param bytesNumber - Frame size.
+ *
+ * @return TCY of the table, 0 if the size is not in it.
+*******************************************************************************/
+static unsigned long Sim_Documented(unsigned char bytesNumber) {
+	FILE* pFile;
+	char text[256];
+	unsigned int size;
+	char* pLast;
+	unsigned long documented = 0;
+
+	pFile = fopen(SIM_SOURCE, "r");
+	if (pFile == 0) { return 0; }
+	while (fgets(text, sizeof(text), pFile) != 0) {
+		if (strncmp(text, SIM_FUNCTION, strlen(SIM_FUNCTION)) == 0) { break; }
+		if ((sscanf(text, " *\t%u ", &size) == 1) && (size == bytesNumber)) {
+			pLast = strrchr(text, '\t');
+			documented = strtoul(pLast + 1, 0, 10);
+		}
+	}
+	fclose(pFile);
+
+	return documented;
+}
+
+/***************************************************************************//**
+ * @brief Runs every frame size and checks the bytes, the shifts and the TCY.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Sim_Frames() {
+	static const unsigned char SIZES[] = { 6, 9, 12, 15, 18, 21, 24, 27, 54 };
+	unsigned long block, first, first6 = 0, first27 = 0;
+	unsigned char i, k, n, stored;
+
+	printf("frame  block TCY  TCY from the first shift  TCY/byte\n");
+	for (i = 0; i < sizeof(SIZES); i = i + 1) {
+		n = SIZES[i];
+		block = Sim_Run(n, &first);
+		printf("%5u  %9lu  %24lu  %8.2f\n", n, block, first, (double) first / n);
+
+		/* Every byte in place, nothing past the frame, no extra shift */
+		stored = 1;
+		for (k = 0; k < n; k = k + 1) {
+			if (pic.ram[SIM_RAM + k] != Sim_SlaveByte(k)) { stored = 0; }
+		}
+		CHECK(stored);
+		CHECK(pic.ram[SIM_RAM + n] == SIM_GUARD);
+		CHECK(pic.ram[SIM_RAM - 1] == SIM_GUARD);
+		CHECK(((pic.fsr0h << 8) | pic.fsr0l) == SIM_RAM + n);
+		CHECK(ssp.shifts == n);
+		CHECK(ssp.collisions == 0);
+		CHECK(pic.readerCount == 0);
+
+		/* The read budget of ADS1298.h covers the block, and the doc table is this run */
+		CHECK(block <= ADS1298_TCY_ISR(n));
+		CHECK(Sim_Documented(n) == block);
+
+		if (n == 6) { first6 = first; }
+		if (n == 27) { first27 = first; }
+	}
+	CHECK((first27 - first6) <= (27 - 6) * ADS1298_TCY_PER_BYTE);
+	printf("%.2f TCY per byte in the loop, ADS1298_TCY_PER_BYTE is %u\n",
+		   (double) (first27 - first6) / (27 - 6), ADS1298_TCY_PER_BYTE);
+}
+
+int main(void) {
+	CHECK(Sim_Load());
+	if (lineCount != 0) { Sim_Frames(); }
+
+	printf("%u checks, %u failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
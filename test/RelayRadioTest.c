@@ -0,0 +1,316 @@
+/***************************************************************************//**
+ *   @file   RelayRadioTest.c
+ *   @brief  Host test of the relay CC110L radio receive path against
+ *           CC110LModel.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "CommCC110L.h"
+#include "CC110L.h"
+#include "Frame.h"
+#include "CC110LModel.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define CHECK(condition)	Test_Check((condition), #condition, __LINE__)
+
+#define TEST_FRAMES			3		// frames in each test packet
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static unsigned int checks;
+static unsigned int failures;
+static unsigned char acks[4][FRAME_ACK_SIZE];	// acknowledgements sent by the relay
+static unsigned char ackCount;
+
+/******************************************************************************/
+/* WIRED LINK (not used by these tests)										  */
+/******************************************************************************/
+unsigned char CommCC110L_Initialize() { return 1; }
+unsigned char CommCC110L_Write(unsigned char* data, unsigned char bytesNumber) { return bytesNumber; }
+unsigned char CommCC110L_Read(unsigned char* data, unsigned char bytesNumber) { return bytesNumber; }
+unsigned char CommCC110L_ReadBurst(unsigned char* data, unsigned char maxLength) { return 0; }
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a check and reports it when it fails.
+ *
+ * @param condition - Result of the check.
+ * @param pText - Text of the check.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* pText, int line) {
+	checks = checks + 1;
+	if (!condition) {
+		failures = failures + 1;
+		printf("RelayRadioTest.c:%d: failed: %s\n", line, pText);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Builds a frame as the implant queues it, with made up samples.
+ *
+ * @param pFrame - Buffer of FRAME_MAX_SIZE bytes storing the frame.
+ * @param channels1 - Channel bitmap of device 1.
+ * @param channels2 - Channel bitmap of device 2.
+ * @param format - Sample format.
+ * @param sequence - Sequence number.
+ *
+ * @return Size of the frame.
+*******************************************************************************/
+static unsigned char Test_BuildFrame(unsigned char* pFrame,
+									 unsigned char channels1,
+									 unsigned char channels2,
+									 unsigned char format,
+									 unsigned int sequence) {
+	unsigned char size, i;
+
+	pFrame[FRAME_CHANNELS1] = channels1;
+	pFrame[FRAME_CHANNELS2] = channels2;
+	pFrame[FRAME_FORMAT] = format;
+	pFrame[FRAME_FLAGS] = (unsigned char) (sequence & FRAME_FLAGS_GPIO);
+	FRAME_SET_WORD(pFrame, FRAME_SEQUENCE, sequence);
+	FRAME_SET_WORD(pFrame, FRAME_TICK, 7 * sequence);
+	size = FRAME_SIZE(pFrame);
+	for (i = FRAME_HEADER_SIZE; i < size; i = i + 1) { pFrame[i] = (unsigned char) (sequence + (5 * i)); }
+
+	return size;
+}
+
+/***************************************************************************//**
+ * @brief Packs frames into a radio packet as CC110L_TX_SendBatch of the
+ *        implant does (see the packet format in Frame.h).
+ *
+ * @param pPacket - Buffer of CC110L_MAX_PAYLOAD bytes storing the packet.
+ * @param frames - Frames to pack, of consecutive sequence numbers.
+ * @param sizes - Size of each frame.
+ * @param count - Number of frames.
+ * @param number - Packet number.
+ *
+ * @return Size of the packet.
+*******************************************************************************/
+static unsigned char Test_PackFrames(unsigned char* pPacket,
+									 unsigned char frames[][FRAME_MAX_SIZE],
+									 unsigned char* sizes,
+									 unsigned char count,
+									 unsigned char number) {
+	unsigned char length = FRAME_PACKET_HEADER_SIZE;
+	unsigned char f;
+
+	FRAME_SET_WORD(pPacket, FRAME_PACKET_SEQUENCE, FRAME_GET_WORD(frames[0], FRAME_SEQUENCE));
+	pPacket[FRAME_PACKET_COUNT] = count;
+	pPacket[FRAME_PACKET_CHANNELS1] = frames[0][FRAME_CHANNELS1];
+	pPacket[FRAME_PACKET_CHANNELS2] = frames[0][FRAME_CHANNELS2];
+	pPacket[FRAME_PACKET_NUMBER] = number;
+	for (f = 0; f < count; f = f + 1) {
+		pPacket[length++] = frames[f][FRAME_FORMAT];
+		pPacket[length++] = frames[f][FRAME_FLAGS];
+		memcpy(&pPacket[length], &frames[f][FRAME_TICK], sizes[f] - FRAME_TICK);
+		length = length + (sizes[f] - FRAME_TICK);
+	}
+
+	return length;
+}
+
+/***************************************************************************//**
+ * @brief Checks that the relay presets apply and read back.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Presets() {
+	unsigned char p;
+
+	for (p = 0; p < CC110L_NUM_PRESETS; p = p + 1) {
+		CC110LModel_PowerUp();
+		CHECK(CC110L_ApplyPreset(p, 1) == 1);
+		CHECK(CC110L_MODEL.marcstate == CC110LMODEL_IDLE);
+	}
+	CHECK(CC110L_ApplyPreset(CC110L_NUM_PRESETS, 1) == 0);
+}
+
+/***************************************************************************//**
+ * @brief Sends packets of frames in every sample format over the modelled
+ *        radio and checks that the relay rebuilds the frames byte for byte,
+ *        that a second packet waits until the first one is unpacked and
+ *        that a short or corrupt packet yields no bad frame.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Unpack() {
+	static const unsigned char formats[] = { FRAME_FORMAT_WIDTH_24, FRAME_FORMAT_WIDTH_16 | 8, FRAME_FORMAT_WIDTH_12 | 12 };
+	unsigned char frames[TEST_FRAMES][FRAME_MAX_SIZE];
+	unsigned char sizes[TEST_FRAMES];
+	unsigned char packet[CC110L_MAX_PAYLOAD];
+	unsigned char data[FRAME_MAX_SIZE];
+	unsigned char length, size, f, k;
+	unsigned int sequence = 0xFFFE; // the sequence numbers wrap inside the packet
+
+	CC110LModel_PowerUp();
+	CHECK(CC110L_ApplyPreset(CC110L_PRESET_250K, 0) == 1);
+	CC110L_RC_ClearBatch();
+
+	/* Nothing received yet, the radio starts listening */
+	CHECK(CC110L_RC_ReadBatch() == 0);
+	CHECK(CC110L_MODEL.marcstate == CC110LMODEL_RX);
+
+	for (k = 0; k < sizeof(formats); k = k + 1) {
+		for (f = 0; f < TEST_FRAMES; f = f + 1) {
+			sizes[f] = Test_BuildFrame(frames[f], 0b10000001, 0b00000001, formats[k], sequence + f);
+		}
+		length = Test_PackFrames(packet, frames, sizes, TEST_FRAMES, k);
+		CHECK(length <= CC110L_MAX_PAYLOAD);
+		CHECK(CC110LModel_Receive(packet, length, 1) == 1);
+
+		/* Every frame comes back as the implant queued it */
+		CHECK(CC110L_RC_ReadBatch() == TEST_FRAMES);
+		CHECK(CC110L_MODEL.marcstate == CC110LMODEL_RX);
+		for (f = 0; f < TEST_FRAMES; f = f + 1) {
+			memset(data, 0, sizeof(data));
+			size = CC110L_RC_UnpackFrame(data);
+			CHECK(size == sizes[f]);
+			CHECK(memcmp(data, frames[f], sizes[f]) == 0);
+		}
+		CHECK(CC110L_RC_UnpackFrame(data) == 0);
+		sequence = sequence + TEST_FRAMES;
+	}
+
+	/* A second packet stays in the RX FIFO until the first one is unpacked */
+	for (f = 0; f < TEST_FRAMES; f = f + 1) {
+		sizes[f] = Test_BuildFrame(frames[f], 0b00001111, 0, FRAME_FORMAT_WIDTH_24, sequence + f);
+	}
+	length = Test_PackFrames(packet, frames, sizes, 2, 10);
+	CHECK(CC110LModel_Receive(packet, length, 1) == 1);
+	CHECK(CC110L_RC_ReadBatch() == 2);
+	CHECK(CC110L_RC_UnpackFrame(data) == sizes[0]);
+	length = Test_PackFrames(packet, &frames[2], &sizes[2], 1, 11);
+	CHECK(CC110LModel_Receive(packet, length, 1) == 1);
+	CHECK(CC110L_RC_ReadBatch() == 0);
+	CHECK(CC110L_RC_UnpackFrame(data) == sizes[1]);
+	CHECK(memcmp(data, frames[1], sizes[1]) == 0);
+	CHECK(CC110L_RC_UnpackFrame(data) == 0);
+	CHECK(CC110L_RC_ReadBatch() == 1);
+	CHECK(CC110L_RC_UnpackFrame(data) == sizes[2]);
+	CHECK(memcmp(data, frames[2], sizes[2]) == 0);
+
+	/* A packet cut in the middle of its second frame yields the first only */
+	length = Test_PackFrames(packet, frames, sizes, 2, 12);
+	CHECK(CC110LModel_Receive(packet, length - 1, 1) == 1);
+	CHECK(CC110L_RC_ReadBatch() == 2);
+	CHECK(CC110L_RC_UnpackFrame(data) == sizes[0]);
+	CHECK(CC110L_RC_UnpackFrame(data) == 0);
+
+	/* A packet with a bad CRC is dropped and the radio listens again */
+	length = Test_PackFrames(packet, frames, sizes, 2, 13);
+	CHECK(CC110LModel_Receive(packet, length, 0) == 1);
+	CHECK(CC110L_RC_ReadBatch() == 0);
+	CHECK(CC110L_RC_UnpackFrame(data) == 0);
+	CHECK(CC110L_MODEL.marcstate == CC110LMODEL_RX);
+}
+
+/***************************************************************************//**
+ * @brief Records every acknowledgement the relay sends.
+ *
+ * @param pData - Payload of the packet.
+ * @param length - Size of the payload.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_OnTransmit(unsigned char* pData, unsigned char length) {
+	if ((ackCount < 4) && (length == FRAME_ACK_SIZE)) { memcpy(acks[ackCount], pData, FRAME_ACK_SIZE); }
+	ackCount = ackCount + 1;
+}
+
+/***************************************************************************//**
+ * @brief Receives a packet of one frame over the modelled radio and unpacks
+ *        it.
+ *
+ * @param number - Poll flag and packet number.
+ *
+ * @return Number of frames the relay passed on.
+*******************************************************************************/
+static unsigned char Test_ReceiveNumbered(unsigned char number) {
+	unsigned char frames[1][FRAME_MAX_SIZE];
+	unsigned char sizes[1];
+	unsigned char packet[CC110L_MAX_PAYLOAD];
+	unsigned char data[FRAME_MAX_SIZE];
+	unsigned char length, count = 0;
+
+	sizes[0] = Test_BuildFrame(frames[0], 0b10000000, 0, FRAME_FORMAT_WIDTH_24, number);
+	length = Test_PackFrames(packet, frames, sizes, 1, number);
+	CHECK(CC110L_RC_ReadBatch() == 0); // back in RX after the last acknowledgement
+	CHECK(CC110LModel_Receive(packet, length, 1) == 1);
+	CC110L_RC_ReadBatch();
+	while (CC110L_RC_UnpackFrame(data) != 0) { count = count + 1; }
+
+	return count;
+}
+
+/***************************************************************************//**
+ * @brief Checks that the relay answers only the packets with the poll flag,
+ *        with the packets it holds, and drops duplicates.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Acknowledge() {
+	unsigned char ack[FRAME_ACK_SIZE];
+	unsigned char n;
+
+	CC110LModel_PowerUp();
+	CHECK(CC110L_ApplyPreset(CC110L_PRESET_500K, 0) == 1);
+	CC110L_RC_ClearBatch();
+	CC110L_ARQ_Clear();
+	CC110LModel_onTransmit = Test_OnTransmit;
+	ackCount = 0;
+
+	/* A burst of 0, 2 and 3 (poll): 1 is missing */
+	CHECK(Test_ReceiveNumbered(0) == 1);
+	CHECK(Test_ReceiveNumbered(2) == 1);
+	CHECK(ackCount == 0);
+	CHECK(Test_ReceiveNumbered(3 | FRAME_PACKET_POLL) == 1);
+	CHECK(ackCount == 1);
+	CHECK((acks[0][FRAME_ACK_NEXT] == 1) && (acks[0][FRAME_ACK_BITMAP] == 0x03));
+
+	/* 1 comes again and 3 with it: 3 is a duplicate but answered */
+	CHECK(Test_ReceiveNumbered(1) == 1);
+	CHECK(Test_ReceiveNumbered(3 | FRAME_PACKET_POLL) == 0);
+	CHECK(ackCount == 2);
+	CHECK((acks[1][FRAME_ACK_NEXT] == 4) && (acks[1][FRAME_ACK_BITMAP] == 0));
+	CHECK(CC110L_RC_ReadBatch() == 0);
+	CHECK(CC110L_MODEL.marcstate == CC110LMODEL_RX);
+	CC110LModel_onTransmit = 0;
+
+	/* The numbers wrap at 128 */
+	CC110L_ARQ_Clear();
+	for (n = 0; n < 200; n = n + 1) {
+		CHECK(CC110L_ARQ_Receive(n & FRAME_PACKET_NUMBER_MASK, ack) == 1);
+		CHECK(ack[FRAME_ACK_NEXT] == ((n + 1) & FRAME_PACKET_NUMBER_MASK));
+	}
+}
+
+int main(void) {
+	Test_Presets();
+	Test_Unpack();
+	Test_Acknowledge();
+
+	printf("%u checks, %u failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
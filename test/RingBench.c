@@ -0,0 +1,211 @@
+/***************************************************************************//**
+ *   @file   RingBench.c
+ *   @brief  Host benchmark of the rings against the IncrementIndex rings they
+ *           replaced.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include "RingBuffer.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* Each operation moves BENCH_BYTES bytes through a ring of BENCH_SIZE bytes,
+ * put and get in turn so the ring never fills, and keeps the best of
+ * BENCH_RUNS runs. Build with -O0 like the other tests: gcc then keeps every
+ * call and store, as C18 does, so the ratio of the two rings is the figure to
+ * look at, not the nanoseconds of the host. */
+#define BENCH_BYTES				10000000ul
+#define BENCH_RUNS				5
+#define BENCH_SIZE				64
+#define BENCH_BLOCK				27			// frame of one device (status word and 8 channels)
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+RING_DECLARE(Q, BENCH_SIZE);
+
+/* Ring as it was before RingBuffer.h (Serial.c and CC110L.c) */
+static unsigned char OLD_BUFFER[BENCH_SIZE];
+static unsigned char OLD_HEAD, OLD_TAIL;
+static volatile unsigned char GIEH;			// stands in for INTERRUPT_GLOBAL
+
+static volatile unsigned char sink;			// keeps the bytes read
+static unsigned char block[BENCH_BLOCK];
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Increments the index of the old ring (Serial_IncrementIndex).
+ *
+ * @param idx - Index to increment.
+ * @param max - Size of the buffer.
+ *
+ * @return Incremented index value.
+*******************************************************************************/
+unsigned char Old_IncrementIndex(unsigned char idx, unsigned char max) {
+	if (++idx == max) { idx = 0; }
+	return idx;
+}
+
+/***************************************************************************//**
+ * @brief Puts a byte in the old ring (Serial_TX_WriteBuffer).
+ *
+ * @param data - Byte to put.
+ *
+ * @return None.
+*******************************************************************************/
+void Old_Put(unsigned char data) {
+	GIEH = 0;
+	OLD_BUFFER[OLD_HEAD] = data;
+	OLD_HEAD = Old_IncrementIndex(OLD_HEAD, BENCH_SIZE);
+	if (OLD_HEAD == OLD_TAIL) { OLD_TAIL = Old_IncrementIndex(OLD_TAIL, BENCH_SIZE); }
+	GIEH = 1;
+}
+
+/***************************************************************************//**
+ * @brief Takes a byte from the old ring (Serial_RC_ReadBuffer).
+ *
+ * @param None.
+ *
+ * @return Oldest byte.
+*******************************************************************************/
+unsigned char Old_Get() {
+	unsigned char data;
+
+	GIEH = 0;
+	data = OLD_BUFFER[OLD_TAIL];
+	OLD_TAIL = Old_IncrementIndex(OLD_TAIL, BENCH_SIZE);
+	GIEH = 1;
+
+	return data;
+}
+
+/***************************************************************************//**
+ * @brief Reads the monotonic clock.
+ *
+ * @param None.
+ *
+ * @return Nanoseconds.
+*******************************************************************************/
+static double Bench_Now() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/***************************************************************************//**
+ * @brief Times one of the operations below.
+ *
+ * @param pRun - Operation, moving BENCH_BYTES bytes.
+ *
+ * @return Best time per byte over BENCH_RUNS runs, in ns.
+*******************************************************************************/
+static double Bench_Time(void (*pRun)()) {
+	double best = 0;
+	double start, ns;
+	unsigned char run;
+
+	for (run = 0; run < BENCH_RUNS; run = run + 1) {
+		start = Bench_Now();
+		pRun();
+		ns = (Bench_Now() - start) / BENCH_BYTES;
+		if ((run == 0) || (ns < best)) { best = ns; }
+	}
+
+	return best;
+}
+
+/***************************************************************************//**
+ * @brief Puts and gets one byte at a time through the old ring.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Bench_OldByte() {
+	unsigned long n;
+
+	for (n = 0; n < BENCH_BYTES; n = n + 1) {
+		Old_Put((unsigned char) n);
+		sink = Old_Get();
+	}
+}
+
+/***************************************************************************//**
+ * @brief Puts and gets one byte at a time through the ring.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Bench_RingByte() {
+	unsigned long n;
+	unsigned char data;
+
+	for (n = 0; n < BENCH_BYTES; n = n + 1) {
+		RING_PUT(Q, (unsigned char) n);
+		RING_GET(Q, data);
+		sink = data;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Writes and reads BENCH_BLOCK bytes at a time through the old ring,
+ *        one byte per call as the old frame copies did.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Bench_OldBlock() {
+	unsigned long n;
+	unsigned char i;
+
+	for (n = 0; n < BENCH_BYTES; n = n + BENCH_BLOCK) {
+		for (i = 0; i < BENCH_BLOCK; i = i + 1) { Old_Put(block[i]); }
+		for (i = 0; i < BENCH_BLOCK; i = i + 1) { block[i] = Old_Get(); }
+	}
+}
+
+/***************************************************************************//**
+ * @brief Writes and reads BENCH_BLOCK bytes at a time through the ring.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Bench_RingBlock() {
+	unsigned long n;
+
+	for (n = 0; n < BENCH_BYTES; n = n + BENCH_BLOCK) {
+		RING_WRITE(Q, block, BENCH_BLOCK);
+		RING_READ(Q, block, BENCH_BLOCK);
+	}
+}
+
+int main(void) {
+	double oldByte, ringByte, oldBlock, ringBlock;
+
+	oldByte = Bench_Time(Bench_OldByte);
+	ringByte = Bench_Time(Bench_RingByte);
+	oldBlock = Bench_Time(Bench_OldBlock);
+	ringBlock = Bench_Time(Bench_RingBlock);
+
+	printf("put and get one byte:   IncrementIndex %5.2f ns, ring %5.2f ns (%.1fx)\n",
+		   oldByte, ringByte, oldByte / ringByte);
+	printf("%u byte block per byte: IncrementIndex %5.2f ns, ring %5.2f ns (%.1fx)\n",
+		   BENCH_BLOCK, oldBlock, ringBlock, oldBlock / ringBlock);
+
+	return ((ringByte < oldByte) && (ringBlock < oldBlock)) ? 0 : 1;
+}
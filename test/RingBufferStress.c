@@ -0,0 +1,184 @@
+/***************************************************************************//**
+ *   @file   RingBufferStress.c
+ *   @brief  Host stress test of the single-producer/single-consumer rings.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "RingBuffer.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+
+/* A timer signal plays the interrupt: it lands at any instruction of the main
+ * loop, including the middle of a ring macro, and runs to completion before
+ * the main loop goes on, as an interrupt does on the PIC. Each run moves
+ * STRESS_BYTES bytes numbered in sequence through a ring, with the main loop
+ * on one side and the handler on the other, and checks that every byte comes
+ * out once and in order. Build with -O0 so that the stores stay in program
+ * order, as C18 emits them. */
+#define STRESS_BYTES			2000000ul
+#define STRESS_TICK_US			20			// interval of the interrupt timer
+#define STRESS_MAX_BLOCK		27			// largest block written or read at once
+
+/* Byte number n of the sequence (not periodic in the ring size, so a stale 
+ * byte from the previous lap does not pass for the right one) */
+#define STRESS_BYTE(n)			((unsigned char) ((n) ^ ((n) >> 6)))
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+RING_DECLARE(Q, 64);
+
+static volatile unsigned long putCount;		// bytes written by the producer
+static volatile unsigned long getCount;		// bytes read by the consumer
+static volatile unsigned long errors;		// bytes out of sequence
+static volatile unsigned char mainProduces;	// 1 - main loop produces, 0 - handler produces
+static unsigned long mainSeed = 1;			// random state of the main loop
+static unsigned long isrSeed = 2;			// random state of the handler (rand is not signal safe)
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Draws a random number from 0 to 32767 (linear congruential).
+ *
+ * @param pSeed - Pointer to the random state of the caller.
+ *
+ * @return Random number.
+*******************************************************************************/
+static unsigned int Stress_Random(unsigned long* pSeed) {
+	*pSeed = (*pSeed * 1103515245ul) + 12345ul;
+
+	return (unsigned int) ((*pSeed >> 16) & 0x7FFF);
+}
+
+/***************************************************************************//**
+ * @brief Writes a random mix of single bytes and blocks, as far as the ring
+ *        has space.
+ *
+ * @param pSeed - Pointer to the random state of the caller.
+ * @param budget - Maximum number of bytes to write.
+ *
+ * @return None.
+*******************************************************************************/
+static void Stress_Produce(unsigned long* pSeed, unsigned char budget) {
+	unsigned char block[STRESS_MAX_BLOCK];
+	unsigned char n, i;
+
+	while ((budget != 0) && (putCount < STRESS_BYTES)) {
+		n = (unsigned char) (1 + (Stress_Random(pSeed) % STRESS_MAX_BLOCK));
+		if (n > budget) { n = budget; }
+		if (n > STRESS_BYTES - putCount) { n = (unsigned char) (STRESS_BYTES - putCount); }
+		if (n > RING_SPACE(Q)) { return; }
+
+		if (n == 1) {
+			RING_PUT(Q, STRESS_BYTE(putCount));
+		} else {
+			for (i = 0; i < n; i = i + 1) { block[i] = STRESS_BYTE(putCount + i); }
+			RING_WRITE(Q, block, n);
+		}
+		putCount = putCount + n;
+		budget = budget - n;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Reads a random mix of single bytes, peeks and blocks, as far as the
+ *        ring has data, and checks the sequence.
+ *
+ * @param pSeed - Pointer to the random state of the caller.
+ * @param budget - Maximum number of bytes to read.
+ *
+ * @return None.
+*******************************************************************************/
+static void Stress_Consume(unsigned long* pSeed, unsigned char budget) {
+	unsigned char block[STRESS_MAX_BLOCK];
+	unsigned char n, i, data;
+
+	while (budget != 0) {
+		n = (unsigned char) (1 + (Stress_Random(pSeed) % STRESS_MAX_BLOCK));
+		if (n > budget) { n = budget; }
+		if (n > RING_COUNT(Q)) { return; }
+
+		if (n == 1) {
+			RING_GET(Q, data);
+			if (data != STRESS_BYTE(getCount)) { errors = errors + 1; }
+		} else {
+			if (RING_PEEK(Q, n - 1) != STRESS_BYTE(getCount + n - 1)) { errors = errors + 1; }
+			RING_READ(Q, block, n);
+			for (i = 0; i < n; i = i + 1) {
+				if (block[i] != STRESS_BYTE(getCount + i)) { errors = errors + 1; }
+			}
+		}
+		getCount = getCount + n;
+		budget = budget - n;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Timer signal handler, the interrupt side of the ring.
+ *
+ * @param signal - Signal number.
+ *
+ * @return None.
+*******************************************************************************/
+static void Stress_ISR(int signal) {
+	unsigned char budget = (unsigned char) (1 + (Stress_Random(&isrSeed) % (2 * STRESS_MAX_BLOCK)));
+
+	if (mainProduces) {
+		Stress_Consume(&isrSeed, budget);
+	} else {
+		Stress_Produce(&isrSeed, budget);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Moves STRESS_BYTES through the ring with the main loop as the
+ *        producer or as the consumer.
+ *
+ * @param produce - 1 - the main loop produces, 0 - the main loop consumes.
+ *
+ * @return Number of bytes out of sequence.
+*******************************************************************************/
+static unsigned long Stress_Run(unsigned char produce) {
+	struct itimerval timer = { { 0, STRESS_TICK_US }, { 0, STRESS_TICK_US } };
+	struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+
+	RING_CLEAR(Q);
+	putCount = getCount = errors = 0;
+	mainProduces = produce;
+
+	signal(SIGALRM, Stress_ISR);
+	setitimer(ITIMER_REAL, &timer, 0);
+	while (getCount < STRESS_BYTES) {
+		if (produce) {
+			Stress_Produce(&mainSeed, (unsigned char) (1 + (Stress_Random(&mainSeed) % 255)));
+		} else {
+			Stress_Consume(&mainSeed, (unsigned char) (1 + (Stress_Random(&mainSeed) % 255)));
+		}
+	}
+	setitimer(ITIMER_REAL, &stop, 0);
+
+	printf("%-28s %lu bytes, %lu out of sequence\n",
+		   produce ? "main loop -> interrupt:" : "interrupt -> main loop:",
+		   getCount, errors);
+
+	return errors;
+}
+
+int main(void) {
+	unsigned long failures = 0;
+
+	failures = failures + Stress_Run(1);
+	failures = failures + Stress_Run(0);
+
+	return (failures == 0) ? 0 : 1;
+}
\ No newline at end of file
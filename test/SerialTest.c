@@ -0,0 +1,116 @@
+/***************************************************************************//**
+ *   @file   SerialTest.c
+ *   @brief  Host test of the relay EUSART transmit interrupt.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include "Serial.h"
+#include "Frame.h"
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define CHECK(condition)	Test_Check((condition), #condition, __LINE__)
+
+#define TEST_MAX_CALLS		200		// interrupts after which a drain is given up
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static unsigned int checks;
+static unsigned int failures;
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a check and reports it when it fails.
+ *
+ * @param condition - Result of the check.
+ * @param pText - Text of the check.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* pText, int line) {
+	checks = checks + 1;
+	if (!condition) {
+		failures = failures + 1;
+		printf("SerialTest.c:%d: failed: %s\n", line, pText);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Runs the high priority interrupt as the EUSART raises it: TX1IF is
+ *        set whenever TXREG1 is empty (the stand-in register never fills),
+ *        until the ISR turns the TX interrupt off.
+ *
+ * @param None.
+ *
+ * @return Number of interrupts taken.
+*******************************************************************************/
+static unsigned int Test_Drain() {
+	unsigned int calls = 0;
+
+	while (Serial_TXINT_ENABLE && (calls < TEST_MAX_CALLS)) {
+		Serial_TX_EMPTY = 1;
+		Serial_ISR();
+		calls = calls + 1;
+	}
+
+	return calls;
+}
+
+/***************************************************************************//**
+ * @brief Checks that queued frames go out through Serial_ISR, two bytes per
+ *        interrupt, that the TX interrupt turns off once the buffer is empty
+ *        and that an odd byte count does not run the buffer past empty.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Transmit() {
+	unsigned char frame[FRAME_MAX_SIZE];
+	unsigned char i;
+
+	for (i = 0; i < FRAME_MAX_SIZE; i = i + 1) { frame[i] = (unsigned char) (i + 1); }
+	CHECK(Serial_Initialize() == 1);
+	Serial_SetOverflowPolicy(FRAME_POLICY_BACKPRESSURE);
+
+	/* One byte: the second send of the interrupt finds the buffer empty */
+	CHECK(Serial_TX_WriteFrame(frame, 1) == 1);
+	CHECK(Test_Drain() == 2);
+	CHECK(Serial_TX_REGISTER == 1);
+	CHECK(Serial_TX_isDataAvailable() == 0);
+	CHECK(Serial_TXINT_ENABLE == 0);
+
+	/* Seven bytes take four interrupts and one more that finds nothing */
+	CHECK(Serial_TX_WriteFrame(frame, 7) == 1);
+	CHECK(Serial_TXINT_ENABLE == 1);
+	CHECK(Test_Drain() == 5);
+	CHECK(Serial_TX_REGISTER == 7);
+	CHECK(Serial_TX_isDataAvailable() == 0);
+
+	/* The buffer is whole again: two frames fit, a third does not */
+	CHECK(Serial_TX_isFrameSpace() == 1);
+	CHECK(Serial_TX_WriteFrame(frame, FRAME_MAX_SIZE) == 1);
+	CHECK(Serial_TX_WriteFrame(frame, FRAME_MAX_SIZE) == 1);
+	CHECK(Serial_TX_isFrameSpace() == 0);
+	CHECK(Test_Drain() == FRAME_MAX_SIZE + 1);
+	CHECK(Serial_TX_REGISTER == FRAME_MAX_SIZE);
+	CHECK(Serial_TX_isFrameSpace() == 1);
+}
+
+int main(void) {
+	Test_Transmit();
+
+	printf("%u checks, %u failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
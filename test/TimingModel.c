@@ -0,0 +1,159 @@
+/***************************************************************************//**
+ *   @file   TimingModel.c
+ *   @brief  Host program working out the acquisition timing tables of
+ *           ADS1298.h from its ADS1298_TCY_* macros.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "ADS1298.h"		// implant: ADS1298_TCY_*, ADS1298_HR_RATE
+
+/******************************************************************************/
+/* DEFINITIONS																  */
+/******************************************************************************/
+#define CHECK(condition)	Test_Check((condition), #condition, __LINE__)
+
+/* The tables are printed as they stand in the timing model comment of
+ * ADS1298.h, and every printed line must be found there word for word, so
+ * the comment cannot drift from the macros. */
+#define MODEL_HEADER			"implant/ADS1298.h"
+#define MODEL_BYTES_8CH			27			// status word and 8 channels of one device
+#define MODEL_BYTES_16CH		54			// both devices
+#define MODEL_RATES				7			// ADS1298_CONFIG1_DR_32K to ADS1298_CONFIG1_DR_500
+
+/* TCY per frame without the PLL (HFINTOSC only) */
+#define MODEL_TCY_PER_FRAME_NOPLL(dr)	((ADS1298_TCY_PER_FRAME(dr) * CLOCK_HFINTOSC) / CLOCK_FOSC)
+
+/******************************************************************************/
+/* VARIABLES																  */
+/******************************************************************************/
+static unsigned int checks;
+static unsigned int failures;
+
+static const char* RATE_NAMES[MODEL_RATES] = {
+	"DR_32K", "DR_16K", "DR_8K", "DR_4K", "DR_2K", "DR_1K", "DR_500"
+};
+
+/******************************************************************************/
+/* FUNCTIONS																  */
+/******************************************************************************/
+
+/***************************************************************************//**
+ * @brief Counts a check and reports it when it fails.
+ *
+ * @param condition - Result of the check.
+ * @param pText - Text of the check.
+ * @param line - Line of the check.
+ *
+ * @return None.
+*******************************************************************************/
+static void Test_Check(int condition, const char* pText, int line) {
+	checks = checks + 1;
+	if (!condition) {
+		failures = failures + 1;
+		printf("TimingModel.c:%d: failed: %s\n", line, pText);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Prints a line of a table and checks that ADS1298.h has it.
+ *
+ * @param pLine - Line, without the " *" of the comment.
+ *
+ * @return None.
+*******************************************************************************/
+static void Model_Line(const char* pLine) {
+	FILE* pFile;
+	char text[256];
+	char wanted[256];
+	unsigned char found = 0;
+
+	printf("%s\n", pLine);
+	snprintf(wanted, sizeof(wanted), " *%s\n", pLine);
+	pFile = fopen(MODEL_HEADER, "r");
+	if (pFile != 0) {
+		while (!found && (fgets(text, sizeof(text), pFile) != 0)) {
+			found = (strcmp(text, wanted) == 0);
+		}
+		fclose(pFile);
+	}
+	if (!found) { printf("  not in " MODEL_HEADER "\n"); }
+	CHECK(found);
+}
+
+/***************************************************************************//**
+ * @brief Prints the TCY per frame and the TCY the ISR leaves free at each
+ *        data rate, for the 8 channel frame of one device.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Model_Freed() {
+	char line[256];
+	unsigned char dr;
+	unsigned long perFrame, perFrameNoPll, isr;
+	long freed;
+
+	Model_Line("\tDR (HR mode)\tTCY/frame (16 / 64 MHz)\t\tISR TCY (8 ch)\tTCY freed/frame at 64 MHz");
+	for (dr = 0; dr < MODEL_RATES; dr = dr + 1) {
+		perFrame = ADS1298_TCY_PER_FRAME(dr);
+		perFrameNoPll = MODEL_TCY_PER_FRAME_NOPLL(dr);
+		isr = ADS1298_TCY_ISR(MODEL_BYTES_8CH);
+		freed = (long) perFrame - (long) isr;
+		CHECK(freed == (long) ADS1298_TCY_FREED(dr, MODEL_BYTES_8CH));
+		snprintf(line, sizeof(line), "\t%-8s\t\t%5lu / %-5lu\t\t\t\t%3lu\t\t\t\t%5ld (%2ld%%)%s",
+				 RATE_NAMES[dr], perFrameNoPll, perFrame, isr, freed,
+				 ((freed * 100) + ((long) perFrame / 2)) / (long) perFrame,
+				 (perFrameNoPll < isr) ? ", not sustainable at 16 MHz" : "");
+		Model_Line(line);
+	}
+}
+
+/***************************************************************************//**
+ * @brief Prints the DRDY deadline and its slack at each data rate, for one
+ *        and for both devices. A rate is refused by ADS1298_isDeadlineMet
+ *        when the deadline is longer than the DRDY period.
+ *
+ * @param None.
+ *
+ * @return None.
+*******************************************************************************/
+static void Model_Deadline() {
+	char line[256];
+	unsigned char dr;
+	unsigned long perFrame, deadline8, deadline16;
+	long slack8, slack16;
+
+	Model_Line("\tDR (HR mode)\tTCY/frame\tDeadline, slack 8 ch\tDeadline, slack 16 ch");
+	for (dr = 0; dr < MODEL_RATES; dr = dr + 1) {
+		perFrame = ADS1298_TCY_PER_FRAME(dr);
+		deadline8 = ADS1298_TCY_DEADLINE((unsigned long) MODEL_BYTES_8CH);
+		deadline16 = ADS1298_TCY_DEADLINE((unsigned long) MODEL_BYTES_16CH);
+		slack8 = (long) perFrame - (long) deadline8;
+		slack16 = (long) perFrame - (long) deadline16;
+		snprintf(line, sizeof(line), "\t%-8s\t\t%5lu\t\t%4lu, %6ld%s%4lu, %6ld%s",
+				 RATE_NAMES[dr], perFrame,
+				 deadline8, slack8, (slack8 < 0) ? " refused\t" : "\t\t\t",
+				 deadline16, slack16, (slack16 < 0) ? " refused" : "");
+		Model_Line(line);
+	}
+
+	/* The DR_8K 16 channel frame is the tightest one that is accepted */
+	CHECK(ADS1298_TCY_DEADLINE((unsigned long) MODEL_BYTES_16CH) <= ADS1298_TCY_PER_FRAME(ADS1298_CONFIG1_DR_8K));
+	CHECK(ADS1298_TCY_DEADLINE((unsigned long) MODEL_BYTES_16CH) > ADS1298_TCY_PER_FRAME(ADS1298_CONFIG1_DR_16K));
+}
+
+int main(void) {
+	Model_Freed();
+	printf("\n");
+	Model_Deadline();
+
+	printf("%u checks, %u failed\n", checks, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+/***************************************************************************//**
+ *   @file   delays.h
+ *   @brief  Host stand-in for the C18 delay functions, for the gcc tests only.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+#ifndef DELAYS_H
+#define DELAYS_H
+
+void Delay10TCYx(unsigned char unit);
+void Delay1KTCYx(unsigned char unit);
+
+#endif	/* DELAYS_H */
\ No newline at end of file
@@ -0,0 +1,96 @@
+/***************************************************************************//**
+ *   @file   p18f46k22.c
+ *   @brief  Storage for the host stand-in of the special function registers.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+/******************************************************************************/
+/* INCLUDE FILES															  */
+/******************************************************************************/
+#include <p18f46k22.h>
+#include <delays.h>
+
+/******************************************************************************/
+/* SPECIAL FUNCTION REGISTERS												  */
+/******************************************************************************/
+
+volatile PIC_BITS ANSELAbits;
+volatile PIC_BITS ANSELBbits;
+volatile PIC_BITS ANSELCbits;
+volatile PIC_BITS ANSELDbits;
+volatile PIC_BITS BAUDCON1bits;
+volatile PIC_BITS INTCON2bits;
+volatile PIC_BITS INTCON3bits;
+volatile PIC_BITS INTCONbits;
+volatile PIC_BITS IPR1bits;
+volatile PIC_BITS IPR3bits;
+volatile PIC_BITS IPR5bits;
+volatile PIC_BITS LATAbits;
+volatile PIC_BITS LATBbits;
+volatile PIC_BITS LATCbits;
+volatile PIC_BITS LATDbits;
+volatile PIC_BITS LATEbits;
+volatile PIC_BITS OSCCON2bits;
+volatile PIC_BITS OSCTUNEbits;
+volatile PIC_BITS PIE1bits;
+volatile PIC_BITS PIE3bits;
+volatile PIC_BITS PIE5bits;
+volatile PIC_BITS PIR1bits;
+volatile PIC_BITS PIR3bits;
+volatile PIC_BITS PIR5bits;
+volatile PIC_BITS PORTAbits;
+volatile PIC_BITS PORTBbits;
+volatile PIC_BITS PORTCbits;
+volatile PIC_BITS PORTDbits;
+volatile PIC_BITS RCONbits;
+volatile PIC_BITS RCSTA1bits;
+volatile PIC_BITS SSP1CON1bits;
+volatile PIC_BITS SSP1STATbits;
+volatile PIC_BITS SSP2CON1bits;
+volatile PIC_BITS SSP2STATbits;
+volatile PIC_BITS T1CONbits;
+volatile PIC_BITS TRISAbits;
+volatile PIC_BITS TRISBbits;
+volatile PIC_BITS TRISCbits;
+volatile PIC_BITS TRISDbits;
+volatile PIC_BITS TRISEbits;
+volatile PIC_BITS TXSTA1bits;
+
+volatile unsigned char OSCCON;
+volatile unsigned char OSCTUNE;
+volatile unsigned char SSP1CON1;
+volatile unsigned char SSP1STAT;
+volatile unsigned char SSP1BUF;
+volatile unsigned char SSP1ADD;
+volatile unsigned char SSP2CON1;
+volatile unsigned char SSP2STAT;
+volatile unsigned char SSP2BUF;
+volatile unsigned char SSP2ADD;
+volatile unsigned char SPBRGH1;
+volatile unsigned char SPBRG;
+volatile unsigned char SPBRG1;
+volatile unsigned char TXREG1;
+volatile unsigned char RCREG1;
+volatile unsigned char TMR1H;
+volatile unsigned char TMR1L;
+volatile unsigned char FSR0L;
+volatile unsigned char FSR0H;
+volatile unsigned char POSTINC0;
+volatile unsigned char TMR3H;
+volatile unsigned char TMR3L;
+volatile unsigned char T1CON;
+volatile unsigned char T3CON;
+volatile unsigned char WREG;
+volatile unsigned char PORTA;
+volatile unsigned char PORTB;
+volatile unsigned char LATA;
+volatile unsigned char LATB;
+volatile unsigned char INTCON;
+
+/******************************************************************************/
+/* DELAYS																	  */
+/******************************************************************************/
+
+/* The busy-wait delays return at once on the host */
+void Delay10TCYx(unsigned char unit) { }
+void Delay1KTCYx(unsigned char unit) { }
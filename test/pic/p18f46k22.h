@@ -0,0 +1,207 @@
+/***************************************************************************//**
+ *   @file   p18f46k22.h
+ *   @brief  Host stand-in for the C18 device header, for the gcc tests only.
+ *   @author Suzhou Li (suzhou.li@duke.edu)
+*******************************************************************************/
+
+#ifndef P18F46K22_H
+#define P18F46K22_H
+
+/******************************************************************************/
+/* C18 KEYWORDS																  */
+/******************************************************************************/
+#define rom
+#define near
+#define far
+#define Nop()		((void) 0)
+#define ClrWdt()	((void) 0)
+
+/******************************************************************************/
+/* SPECIAL FUNCTION REGISTERS												  */
+/******************************************************************************/
+
+/* Every bit register has every bit field used by the firmware, so the tests
+ * only need one type. A new bit name used in the firmware goes here too. */
+typedef struct {
+	unsigned SSPM:4;
+	unsigned IRCF:3;
+	unsigned SCS:2;
+	unsigned T1CKPS:2;
+	unsigned T3CKPS:2;
+	unsigned TMR1CS:2;
+	unsigned TMR3CS:2;
+	unsigned T0PS:3;
+	unsigned ABDEN:1;
+	unsigned ANSA0:1;
+	unsigned ANSA1:1;
+	unsigned ANSB0:1;
+	unsigned ANSB1:1;
+	unsigned ANSC4:1;
+	unsigned ANSC6:1;
+	unsigned ANSC7:1;
+	unsigned ANSD0:1;
+	unsigned ANSD1:1;
+	unsigned ANSD3:1;
+	unsigned BF:1;
+	unsigned BRG16:1;
+	unsigned BRGH:1;
+	unsigned CKE:1;
+	unsigned CKP:1;
+	unsigned CKTXP:1;
+	unsigned CREN:1;
+	unsigned DTRXP:1;
+	unsigned GIEH:1;
+	unsigned INT0IE:1;
+	unsigned INT0IF:1;
+	unsigned INT1IE:1;
+	unsigned INT1IF:1;
+	unsigned INT1IP:1;
+	unsigned INTEDG0:1;
+	unsigned INTEDG1:1;
+	unsigned IPEN:1;
+	unsigned LATA2:1;
+	unsigned LATA3:1;
+	unsigned LATA4:1;
+	unsigned LATA5:1;
+	unsigned LATB2:1;
+	unsigned LATB3:1;
+	unsigned LATB4:1;
+	unsigned LATB5:1;
+	unsigned LATB6:1;
+	unsigned LATB7:1;
+	unsigned LATC3:1;
+	unsigned LATC6:1;
+	unsigned LATD3:1;
+	unsigned LATD7:1;
+	unsigned LATE0:1;
+	unsigned LATE1:1;
+	unsigned LATE2:1;
+	unsigned PEIE:1;
+	unsigned PLLEN:1;
+	unsigned PLLRDY:1;
+	unsigned RA0:1;
+	unsigned RA1:1;
+	unsigned RA2:1;
+	unsigned RA3:1;
+	unsigned RA4:1;
+	unsigned RA5:1;
+	unsigned RB0:1;
+	unsigned RB1:1;
+	unsigned RB2:1;
+	unsigned RB3:1;
+	unsigned RB4:1;
+	unsigned RB5:1;
+	unsigned RB6:1;
+	unsigned RB7:1;
+	unsigned RC1IE:1;
+	unsigned RC1IF:1;
+	unsigned RC1IP:1;
+	unsigned RC3:1;
+	unsigned RC4:1;
+	unsigned RC5:1;
+	unsigned RC6:1;
+	unsigned RC7:1;
+	unsigned RD0:1;
+	unsigned RD1:1;
+	unsigned RD3:1;
+	unsigned RD4:1;
+	unsigned RD7:1;
+	unsigned RE0:1;
+	unsigned RE1:1;
+	unsigned RE2:1;
+	unsigned SMP:1;
+	unsigned SPEN:1;
+	unsigned SSP1IE:1;
+	unsigned SSP1IF:1;
+	unsigned SSP1IP:1;
+	unsigned SSP2IE:1;
+	unsigned SSP2IF:1;
+	unsigned SSP2IP:1;
+	unsigned SSPEN:1;
+	unsigned SYNC:1;
+	unsigned T1RD16:1;
+	unsigned TMR1ON:1;
+	unsigned TMR5IE:1;
+	unsigned TMR5IF:1;
+	unsigned TMR5IP:1;
+	unsigned TRMT:1;
+	unsigned TX1IE:1;
+	unsigned TX1IF:1;
+	unsigned TX1IP:1;
+	unsigned TXEN:1;
+} PIC_BITS;
+
+extern volatile PIC_BITS ANSELAbits;
+extern volatile PIC_BITS ANSELBbits;
+extern volatile PIC_BITS ANSELCbits;
+extern volatile PIC_BITS ANSELDbits;
+extern volatile PIC_BITS BAUDCON1bits;
+extern volatile PIC_BITS INTCON2bits;
+extern volatile PIC_BITS INTCON3bits;
+extern volatile PIC_BITS INTCONbits;
+extern volatile PIC_BITS IPR1bits;
+extern volatile PIC_BITS IPR3bits;
+extern volatile PIC_BITS IPR5bits;
+extern volatile PIC_BITS LATAbits;
+extern volatile PIC_BITS LATBbits;
+extern volatile PIC_BITS LATCbits;
+extern volatile PIC_BITS LATDbits;
+extern volatile PIC_BITS LATEbits;
+extern volatile PIC_BITS OSCCON2bits;
+extern volatile PIC_BITS OSCTUNEbits;
+extern volatile PIC_BITS PIE1bits;
+extern volatile PIC_BITS PIE3bits;
+extern volatile PIC_BITS PIE5bits;
+extern volatile PIC_BITS PIR1bits;
+extern volatile PIC_BITS PIR3bits;
+extern volatile PIC_BITS PIR5bits;
+extern volatile PIC_BITS PORTAbits;
+extern volatile PIC_BITS PORTBbits;
+extern volatile PIC_BITS PORTCbits;
+extern volatile PIC_BITS PORTDbits;
+extern volatile PIC_BITS RCONbits;
+extern volatile PIC_BITS RCSTA1bits;
+extern volatile PIC_BITS SSP1CON1bits;
+extern volatile PIC_BITS SSP1STATbits;
+extern volatile PIC_BITS SSP2CON1bits;
+extern volatile PIC_BITS SSP2STATbits;
+extern volatile PIC_BITS T1CONbits;
+extern volatile PIC_BITS TRISAbits;
+extern volatile PIC_BITS TRISBbits;
+extern volatile PIC_BITS TRISCbits;
+extern volatile PIC_BITS TRISDbits;
+extern volatile PIC_BITS TRISEbits;
+extern volatile PIC_BITS TXSTA1bits;
+
+extern volatile unsigned char OSCCON;
+extern volatile unsigned char OSCTUNE;
+extern volatile unsigned char SSP1CON1;
+extern volatile unsigned char SSP1STAT;
+extern volatile unsigned char SSP1BUF;
+extern volatile unsigned char SSP1ADD;
+extern volatile unsigned char SSP2CON1;
+extern volatile unsigned char SSP2STAT;
+extern volatile unsigned char SSP2BUF;
+extern volatile unsigned char SSP2ADD;
+extern volatile unsigned char SPBRGH1;
+extern volatile unsigned char SPBRG;
+extern volatile unsigned char SPBRG1;
+extern volatile unsigned char TXREG1;
+extern volatile unsigned char RCREG1;
+extern volatile unsigned char TMR1H;
+extern volatile unsigned char TMR1L;
+extern volatile unsigned char FSR0L;
+extern volatile unsigned char FSR0H;
+extern volatile unsigned char POSTINC0;
+extern volatile unsigned char TMR3H;
+extern volatile unsigned char TMR3L;
+extern volatile unsigned char T1CON;
+extern volatile unsigned char T3CON;
+extern volatile unsigned char WREG;
+extern volatile unsigned char PORTA;
+extern volatile unsigned char PORTB;
+extern volatile unsigned char LATA;
+extern volatile unsigned char LATB;
+extern volatile unsigned char INTCON;
+
+#endif	/* P18F46K22_H */
\ No newline at end of file
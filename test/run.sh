@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# Host tests of the firmware modules, built with gcc. The PIC registers and 
+# the C18 delays are stood in for by test/pic. Run from the repository root:
+#
+#	sh test/run.sh
+#
+# Every test prints what it checked and exits non-zero on a failure.
+
+set -e
+cd "$(dirname "$0")/.."
+OUT="${TMPDIR:-/tmp}/wolfinator-test"
+mkdir -p "$OUT"
+CC="${CC:-gcc} -std=gnu99 -O0 -Wall -Wno-unknown-pragmas"
+PIC="-Itest/pic test/pic/p18f46k22.c"
+
+# Rings of both firmwares, interrupt and main loop interleaved at random points
+for tree in implant relay; do
+	echo "RingBufferStress ($tree)"
+	$CC -I$tree test/RingBufferStress.c -o "$OUT/RingBufferStress-$tree"
+	"$OUT/RingBufferStress-$tree"
+done
+
+# Rings against the IncrementIndex rings they replaced (per byte time)
+echo "RingBench"
+$CC -Irelay test/RingBench.c -o "$OUT/RingBench"
+"$OUT/RingBench"
+
+# Implant radio driver against the CC110L register model
+echo "CC110LTest"
+$CC -Itest -Iimplant $PIC test/CC110LTest.c test/CC110LModel.c implant/CC110L.c -o "$OUT/CC110LTest"
+"$OUT/CC110LTest"
+
+# Relay radio receive path and depacketiser against the same model
+echo "RelayRadioTest"
+$CC -Itest -Irelay $PIC test/RelayRadioTest.c test/CC110LModel.c relay/CC110L.c -o "$OUT/RelayRadioTest"
+"$OUT/RelayRadioTest"
+
+# Relay EUSART transmit interrupt
+echo "SerialTest"
+$CC -Irelay $PIC test/SerialTest.c relay/Serial.c -o "$OUT/SerialTest"
+"$OUT/SerialTest"
+
+# Assembly loop of the ADS1298 frame reader, run from implant/CommADS1298.c
+echo "ReaderSim"
+$CC -Iimplant -Itest/pic test/ReaderSim.c -o "$OUT/ReaderSim"
+"$OUT/ReaderSim"
+
+# Acquisition timing tables of ADS1298.h, from its ADS1298_TCY_* macros
+echo "TimingModel"
+$CC -Iimplant -Itest/pic test/TimingModel.c -o "$OUT/TimingModel"
+"$OUT/TimingModel"
+
+# Wired link between the two PICs and both SPI ports of the implant while
+# streaming, stepped one TCY at a time
+echo "LinkSim"
+$CC -Irelay -Iimplant -Itest/pic test/LinkSim.c -o "$OUT/LinkSim"
+"$OUT/LinkSim"
+
+echo "All tests passed"